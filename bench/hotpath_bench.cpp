@@ -0,0 +1,494 @@
+// Host benchmark for the work the firmware repeats every tick or on every request:
+//
+//   humidity_rate     DryerZone::setReading + recordHumidity on a full 30-minute window
+//   readings_json     TelemetryText::format + TelemetrySnapshot::publish, once per tick
+//   readings_serve    What a /readings request costs: TelemetrySnapshot::copy plus the
+//                     String the response keeps
+//   readings_legacy   The /readings handler before the snapshot: the body concatenated
+//                     from Arduino Strings on every request (see LegacyString)
+//   telemetry_delta   TelemetryDelta::build after a tick that moved a few fields (WebSocket)
+//   log_line          formatLogLine + encodeLogFrame, as sendLog() does for each record
+//   presets_load      PresetReader into a new PresetTable, as loadPresets() at boot
+//   presets_save      PresetTable through PresetWriter, as a presets.json compaction
+//
+//   pio run -e bench -t exec                      (or, without PlatformIO:)
+//   g++ -std=gnu++17 -O2 -Ilib/DryerCore bench/hotpath_bench.cpp lib/DryerCore/*.cpp -o hotpath_bench
+//   ./hotpath_bench [--json] [name ...]
+//
+// Each benchmark is calibrated to run for about 100 ms per batch; the fastest of five
+// batches is reported. Output is one line per benchmark in the format of Go's testing
+// package, so two runs can be compared with benchstat; --json writes the same numbers as
+// one JSON object.
+//
+// Heap use is counted by replacing malloc, which catches operator new as well as the
+// malloc that PresetTable uses. That relies on glibc's __libc_ entry points, so this
+// builds on Linux only.
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "DryerZone.h"
+#include "LogFrame.h"
+#include "PresetCodec.h"
+#include "PresetTable.h"
+#include "TelemetrySnapshot.h"
+
+static size_t heapAllocs = 0, heapBytes = 0;
+static bool counting = false;
+
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+
+void* malloc(size_t size) {
+  if (counting) {
+    heapAllocs++;
+    heapBytes += size;
+  }
+  return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) {
+  if (counting) {
+    heapAllocs++;
+    heapBytes += count * size;
+  }
+  return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+  if (counting) {
+    heapAllocs++;
+    heapBytes += size;
+  }
+  return __libc_realloc(ptr, size);
+}
+}
+
+// Arduino's String as the ESP32 core implements it, for the legacy benchmark: up to
+// 10 characters are stored inline, anything longer lives in a heap buffer that
+// concatenation reallocs to the exact new length.
+class LegacyString {
+public:
+  LegacyString(const char* s = "") { assign(s, strlen(s)); }
+  LegacyString(const LegacyString& other) { assign(other.c_str(), other.len); }
+  LegacyString(float value, int decimals) { // dtostrf
+    char buf[33];
+    assign(buf, snprintf(buf, sizeof(buf), "%.*f", decimals, value));
+  }
+  LegacyString(unsigned long value) {
+    char buf[12];
+    assign(buf, snprintf(buf, sizeof(buf), "%lu", value));
+  }
+  ~LegacyString() {
+    if (heap) free(heap);
+  }
+  LegacyString& operator=(const LegacyString&) = delete;
+
+  LegacyString& operator+=(const char* s) { return concat(s, strlen(s)); }
+  LegacyString& operator+=(const LegacyString& s) { return concat(s.c_str(), s.len); }
+  const char* c_str() const { return heap ? heap : sso; }
+  size_t length() const { return len; }
+
+private:
+  static const size_t SSO_SIZE = 11;
+
+  void assign(const char* s, size_t n) {
+    heap = nullptr;
+    len = 0;
+    sso[0] = 0;
+    concat(s, n);
+  }
+
+  LegacyString& concat(const char* s, size_t n) {
+    size_t total = len + n;
+    if (total >= SSO_SIZE) {
+      if (!heap) {
+        heap = (char*)malloc(total + 1);
+        memcpy(heap, sso, len + 1);
+      } else {
+        heap = (char*)realloc(heap, total + 1);
+      }
+    }
+    char* buf = heap ? heap : sso;
+    memcpy(buf + len, s, n);
+    len = total;
+    buf[len] = 0;
+    return *this;
+  }
+
+  char* heap;
+  char sso[SSO_SIZE];
+  size_t len;
+};
+
+static LegacyString operator+(const char* a, const LegacyString& b) {
+  LegacyString sum(a);
+  sum += b;
+  return sum;
+}
+
+static LegacyString operator+(const LegacyString& a, const char* b) {
+  LegacyString sum(a);
+  sum += b;
+  return sum;
+}
+
+struct Result {
+  const char* name;
+  uint64_t iterations; // In the reported batch
+  double nsPerOp;
+  double allocsPerOp;
+  double bytesPerOp;
+};
+
+static double elapsedNs(std::chrono::steady_clock::time_point since) {
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - since).count();
+}
+
+template <typename Op>
+static Result measure(const char* name, Op op) {
+  const double batchNs = 100e6;
+  const int batches = 5;
+
+  // Warm up and find how many iterations fill a batch
+  uint64_t n = 1;
+  for (;;) {
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < n; i++) op();
+    double ns = elapsedNs(start);
+    if (ns >= batchNs / 4) {
+      n = (uint64_t)(n * batchNs / ns) + 1;
+      break;
+    }
+    n *= 4;
+  }
+
+  Result r = {name, n, INFINITY, 0.0, 0.0};
+  heapAllocs = heapBytes = 0;
+  for (int b = 0; b < batches; b++) {
+    counting = true;
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < n; i++) op();
+    double ns = elapsedNs(start);
+    counting = false;
+    if (ns / n < r.nsPerOp) r.nsPerOp = ns / n;
+  }
+  r.allocsPerOp = (double)heapAllocs / (n * batches);
+  r.bytesPerOp = (double)heapBytes / (n * batches);
+  return r;
+}
+
+// Keeps results alive so the compiler cannot drop the work
+static volatile uint32_t sink;
+
+// A tick's worth of telemetry, as publishTelemetry() fills it
+static TelemetryValues telemetryValues(uint32_t tick) {
+  TelemetryValues v;
+  v.zone = 0;
+  v.temperature = 55.0f + (tick % 50) * 0.01f;
+  v.humidity = 18.0f - (tick % 30) * 0.01f;
+  v.humidityRate = -1.25f;
+  v.dryingTemp = 55.0f;
+  v.setpointHum = 15.0f;
+  v.warmTemp = 40.0f;
+  v.processState = processStatusText(STATUS_DRY_DRYING);
+  v.heaterOn = tick % 10 < 4;
+  v.isEnabled = true;
+  v.humHyst = 3.0f;
+  v.stallInterval = 60 * 60000U;
+  v.stallDelta = 0.2f;
+  v.heatDuration = 8 * 3600000U;
+  v.heatRemaining = 0;
+  v.logIntervalMin = 5.0f;
+  v.isStalled = false;
+  v.selectedMode = MODE_DRY;
+  v.heatAction = "Warm";
+  v.heaterDuty = 0.4f;
+  v.pidP = 12.5f;
+  v.pidI = 26.25f + tick * 0.001f;
+  v.pidD = -1.5f;
+  v.kp = 8.0f;
+  v.ki = 0.02f;
+  v.kd = 60.0f;
+  v.modelGain = 0.667f;
+  v.modelTau = 1222.0f;
+  v.modelDeadTime = 20.0f;
+  v.control = 0;
+  v.runSetpoint = 55.0f;
+  v.runReached = true;
+  v.runTimeToSetpoint = 1312;
+  v.runOvershoot = 0.42f;
+  v.temperatureSigma = 0.03f;
+  v.humiditySigma = 0.08f;
+  v.controlPoint = 0;
+  v.probeCount = 2;
+  v.temperatureGradient = 0.9f;
+  return v;
+}
+
+// The /readings handler before the snapshot, field for field
+static LegacyString legacyReadingsJson(const TelemetryValues& v) {
+  LegacyString json = "{";
+  json += "\"temperature\":" + (isnan(v.temperature) ? LegacyString("null") : LegacyString(v.temperature, 1));
+  json += ",\"humidity\":" + (isnan(v.humidity) ? LegacyString("null") : LegacyString(v.humidity, 1));
+  json += ",\"humidity_rate\":" + LegacyString(v.humidityRate, 2);
+  json += ",\"drying_temp\":";
+  json += LegacyString(v.dryingTemp, 1);
+  json += ",\"setpoint_hum\":";
+  json += LegacyString(v.setpointHum, 1);
+  json += ",\"warm_temp\":";
+  json += LegacyString(v.warmTemp, 1);
+  json += ",\"process_state\":\"" + LegacyString(v.processState) + "\"";
+  json += ",\"heater_on\":";
+  json += v.heaterOn ? "true" : "false";
+  json += ",\"is_enabled\":";
+  json += v.isEnabled ? "true" : "false";
+  json += ",\"hum_hyst\":";
+  json += LegacyString(v.humHyst, 1);
+  json += ",\"stall_interval\":";
+  json += LegacyString((unsigned long)v.stallInterval);
+  json += ",\"stall_delta\":";
+  json += LegacyString(v.stallDelta, 1);
+  json += ",\"heat_duration\":";
+  json += LegacyString((unsigned long)v.heatDuration);
+  json += ",\"heat_remaining\":";
+  json += LegacyString((unsigned long)v.heatRemaining);
+  json += ",\"log_interval\":";
+  json += LegacyString(v.logIntervalMin, 1);
+  json += ",\"is_stalled\":";
+  json += v.isStalled ? "true" : "false";
+  json += ",\"selected_mode\":";
+  json += LegacyString((unsigned long)v.selectedMode);
+  json += ",\"heat_action\":\"" + LegacyString(v.heatAction) + "\"";
+  json += ",\"heater_duty\":";
+  json += LegacyString(v.heaterDuty, 1);
+  json += ",\"pid_p\":";
+  json += LegacyString(v.pidP, 2);
+  json += ",\"pid_i\":";
+  json += LegacyString(v.pidI, 2);
+  json += ",\"pid_d\":";
+  json += LegacyString(v.pidD, 2);
+  json += ",\"kp\":";
+  json += LegacyString(v.kp, 3);
+  json += ",\"ki\":";
+  json += LegacyString(v.ki, 4);
+  json += ",\"kd\":";
+  json += LegacyString(v.kd, 1);
+  json += ",\"model_gain\":";
+  json += LegacyString(v.modelGain, 3);
+  json += ",\"model_tau\":";
+  json += LegacyString(v.modelTau, 0);
+  json += ",\"model_dead_time\":";
+  json += LegacyString(v.modelDeadTime, 0);
+  json += ",\"control\":";
+  json += LegacyString((unsigned long)v.control);
+  json += ",\"run_setpoint\":";
+  json += LegacyString(v.runSetpoint, 1);
+  json += ",\"run_time_to_setpoint\":";
+  json += v.runReached ? LegacyString((unsigned long)v.runTimeToSetpoint) : LegacyString("null");
+  json += ",\"run_overshoot\":";
+  json += LegacyString(v.runOvershoot, 2);
+  json += "}";
+  return json;
+}
+
+// Presets as the shipped presets.json has them, plus user-made ones
+static void fillPresets(PresetTable& table, int count) {
+  for (int i = 0; i < count; i++) {
+    char name[32], notes[160];
+    snprintf(name, sizeof(name), "Material %02d", i);
+    snprintf(notes, sizeof(notes), "Batch %d: dry \"hot\" for 4 h,\nthen hold at 35 C. Keep the spool sealed.", i);
+    PresetValues v;
+    v.setDefaults();
+    v.isDefault = i == 0;
+    v.dryingTemp = 45.0f + i % 30;
+    v.setpointHum = 15.0f;
+    v.warmTemp = 35.0f;
+    v.humHyst = 3.0f;
+    v.stallInterval = 30 * 60000U;
+    v.stallDelta = 0.5f;
+    v.heatDur = 4 * 3600000U;
+    v.logInt = 60000U;
+    v.mode = i % 3;
+    table.put(name, notes, v);
+  }
+}
+
+static void writePresets(const PresetTable& table, PresetWriter& writer) {
+  writer.beginArray();
+  for (size_t i = 0; i < table.size(); i++) writer.writePreset(table.name(i), table.notes(i), table.values(i));
+  writer.endArray();
+}
+
+struct MemoryFile {
+  std::string data;
+  size_t pos = 0;
+};
+
+static size_t readMemory(void* ctx, char* buf, size_t len) {
+  MemoryFile* f = (MemoryFile*)ctx;
+  size_t n = f->data.size() - f->pos < len ? f->data.size() - f->pos : len;
+  memcpy(buf, f->data.data() + f->pos, n);
+  f->pos += n;
+  return n;
+}
+
+static size_t appendMemory(void* ctx, const char* data, size_t len) {
+  ((MemoryFile*)ctx)->data.append(data, len);
+  return len;
+}
+
+static size_t discard(void*, const char*, size_t len) {
+  sink = sink + (uint32_t)len;
+  return len;
+}
+
+int main(int argc, char** argv) {
+  bool json = false;
+  std::vector<const char*> names;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--json") == 0) json = true;
+    else names.push_back(argv[i]);
+  }
+  auto selected = [&names](const char* name) {
+    if (names.empty()) return true;
+    for (const char* n : names) {
+      if (strcmp(n, name) == 0) return true;
+    }
+    return false;
+  };
+  std::vector<Result> results;
+
+  if (selected("humidity_rate")) {
+    DryerZone zone;
+    ChamberReading reading = {};
+    reading.probes = 2;
+    uint32_t nowMs = 0;
+    auto record = [&]() {
+      reading.meanHumidity = reading.wettestHumidity = 30.0f - nowMs * 1e-6f;
+      zone.setReading(reading);
+      zone.recordHumidity(nowMs);
+      nowMs += 2000;
+    };
+    for (int i = 0; i < 1000; i++) record(); // Fill the window, so every add also evicts
+    results.push_back(measure("humidity_rate", [&]() {
+      record();
+      sink = sink + (uint32_t)zone.getHumidityRate();
+    }));
+  }
+
+  static TelemetrySnapshot<1024> snapshot; // ReadingsSnapshot in main.cpp
+  if (selected("readings_json")) {
+    TelemetryText text;
+    uint32_t tick = 0;
+    results.push_back(measure("readings_json", [&]() {
+      text.format(telemetryValues(tick++));
+      snapshot.publish(text);
+    }));
+  }
+
+  if (selected("readings_serve")) {
+    TelemetryText text;
+    text.format(telemetryValues(0));
+    snapshot.publish(text);
+    results.push_back(measure("readings_serve", [&]() {
+      char body[TelemetrySnapshot<1024>::BUFFER_SIZE];
+      snapshot.copy(body);
+      LegacyString response(body); // request->send(200, type, body)
+      sink = sink + (uint32_t)response.length();
+    }));
+  }
+
+  if (selected("readings_legacy")) {
+    uint32_t tick = 0;
+    results.push_back(measure("readings_legacy", [&]() {
+      LegacyString json = legacyReadingsJson(telemetryValues(tick++));
+      LegacyString response(json); // request->send(200, type, json)
+      sink = sink + (uint32_t)response.length();
+    }));
+  }
+
+  if (selected("telemetry_delta")) {
+    TelemetryText text;
+    TelemetryDelta delta;
+    char frame[1024]; // telemetryFrame in main.cpp
+    uint32_t tick = 0;
+    text.format(telemetryValues(tick));
+    delta.build(text, frame, sizeof(frame));
+    results.push_back(measure("telemetry_delta", [&]() {
+      text.format(telemetryValues(++tick));
+      sink = sink + (uint32_t)delta.build(text, frame, sizeof(frame));
+    }));
+  }
+
+  if (selected("log_line")) {
+    LogRecord record = {LOG_TIMED, 0, 0, 0, 0, 55.02f, 17.85f, -1.25f};
+    char line[96]; // As in sendLog()
+    uint8_t frame[LOG_FRAME_SIZE];
+    results.push_back(measure("log_line", [&]() {
+      record.sequence++;
+      record.elapsedMs += 60000;
+      sink = sink + (uint32_t)formatLogLine(record, line, sizeof(line));
+      sink = sink + (uint32_t)encodeLogFrame(record, frame);
+    }));
+  }
+
+  const int presetCount = 16;
+  if (selected("presets_load") || selected("presets_save")) {
+    PresetTable table;
+    fillPresets(table, presetCount);
+    MemoryFile file;
+    {
+      PresetWriter writer(appendMemory, &file);
+      writePresets(table, writer);
+    }
+
+    if (selected("presets_load")) {
+      char name[PRESET_NAME_MAX + 1];
+      char notes[PRESET_NOTES_MAX + 1];
+      PresetValues values;
+      results.push_back(measure("presets_load", [&]() {
+        PresetTable loaded;
+        file.pos = 0;
+        PresetReader reader(readMemory, &file);
+        while (reader.next(name, notes, values)) loaded.put(name, notes, values);
+        sink = sink + (uint32_t)loaded.size();
+      }));
+    }
+
+    if (selected("presets_save")) {
+      results.push_back(measure("presets_save", [&]() {
+        PresetWriter writer(discard, nullptr);
+        writePresets(table, writer);
+      }));
+    }
+  }
+
+  if (results.empty()) {
+    printf("No such benchmark\n");
+    return 2;
+  }
+
+  if (json) {
+    printf("{\"unit\":\"ns\",\"presets\":%d,\"benchmarks\":[", presetCount);
+    for (size_t i = 0; i < results.size(); i++) {
+      const Result& r = results[i];
+      printf("%s\n  {\"name\":\"%s\",\"iterations\":%llu,\"nsPerOp\":%.2f,\"allocsPerOp\":%.3f,\"bytesPerOp\":%.1f}",
+             i > 0 ? "," : "", r.name, (unsigned long long)r.iterations, r.nsPerOp, r.allocsPerOp, r.bytesPerOp);
+    }
+    printf("\n]}\n");
+  } else {
+    for (const Result& r : results) {
+      printf("Benchmark_%-16s %10llu %12.1f ns/op %10.1f B/op %8.2f allocs/op\n", r.name,
+             (unsigned long long)r.iterations, r.nsPerOp, r.bytesPerOp, r.allocsPerOp);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,203 @@
+// Host benchmark for the preset codec and table: writes and parses 1000 presets, then
+// compares the RAM they take in PresetTable with the vector of string-holding structs
+// the firmware used before.
+//
+//   g++ -std=gnu++17 -O2 -Ilib/DryerCore bench/preset_bench.cpp lib/DryerCore/PresetCodec.cpp lib/DryerCore/PresetTable.cpp -o preset_bench
+//   ./preset_bench [count]
+//
+// Heap use is counted through operator new; the codec itself should not allocate.
+// PresetTable allocates with malloc and reports its own block size.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "PresetCodec.h"
+#include "PresetTable.h"
+
+static size_t heapBytes = 0, heapPeak = 0, heapAllocs = 0;
+static bool counting = false;
+
+void* operator new(size_t size) {
+  size_t* p = (size_t*)malloc(size + sizeof(size_t));
+  if (!p) throw std::bad_alloc();
+  *p = size;
+  if (counting) {
+    heapAllocs++;
+    heapBytes += size;
+    if (heapBytes > heapPeak) heapPeak = heapBytes;
+  }
+  return p + 1;
+}
+
+void operator delete(void* ptr) noexcept {
+  if (!ptr) return;
+  size_t* p = (size_t*)ptr - 1;
+  if (counting) heapBytes -= *p;
+  free(p);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+  operator delete(ptr);
+}
+
+struct MemoryFile {
+  std::string data;
+  size_t pos = 0;
+};
+
+static size_t readMemory(void* ctx, char* buf, size_t len) {
+  MemoryFile* f = (MemoryFile*)ctx;
+  size_t n = f->data.size() - f->pos < len ? f->data.size() - f->pos : len;
+  memcpy(buf, f->data.data() + f->pos, n);
+  f->pos += n;
+  return n;
+}
+
+static size_t appendMemory(void* ctx, const char* data, size_t len) {
+  ((MemoryFile*)ctx)->data.append(data, len);
+  return len;
+}
+
+// The in-RAM preset before PresetTable: two strings and the settings, in a std::vector
+struct LegacyPreset {
+  std::string name;
+  std::string notes;
+  PresetValues values;
+};
+
+static size_t discard(void*, const char*, size_t len) {
+  return len;
+}
+
+static double elapsedMs(std::chrono::steady_clock::time_point since) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+}
+
+int main(int argc, char** argv) {
+  int count = argc > 1 ? atoi(argv[1]) : 1000;
+
+  // Build a presets.json with `count` presets
+  MemoryFile file;
+  file.data.reserve(count * 520);
+  {
+    PresetWriter writer(appendMemory, &file);
+    writer.beginArray();
+    for (int i = 0; i < count; i++) {
+      char name[32], notes[160];
+      snprintf(name, sizeof(name), "Material %04d", i);
+      snprintf(notes, sizeof(notes), "Batch %d: dry \"hot\" for 4 h,\nthen hold at 35 C. Keep the spool sealed.", i);
+      PresetValues v;
+      v.setDefaults();
+      v.isDefault = i == 0;
+      v.dryingTemp = 45.0f + i % 30;
+      v.setpointHum = 15.0f;
+      v.warmTemp = 35.0f;
+      v.humHyst = 3.0f;
+      v.stallInterval = 30 * 60000U;
+      v.stallDelta = 0.5f;
+      v.heatDur = 4 * 3600000U;
+      v.logInt = 60000U;
+      v.mode = i % 3;
+      writer.writePreset(name, notes, v);
+    }
+    writer.endArray();
+  }
+
+  const int rounds = 20;
+  char name[PRESET_NAME_MAX + 1];
+  char notes[PRESET_NOTES_MAX + 1];
+  PresetValues values;
+
+  // Parse
+  counting = true;
+  auto start = std::chrono::steady_clock::now();
+  int parsed = 0;
+  double checksum = 0.0;
+  for (int r = 0; r < rounds; r++) {
+    file.pos = 0;
+    PresetReader reader(readMemory, &file);
+    while (reader.next(name, notes, values)) {
+      parsed++;
+      checksum += values.dryingTemp + strlen(name) + strlen(notes);
+    }
+    if (reader.failed()) {
+      printf("parse error\n");
+      return 1;
+    }
+  }
+  double parseMs = elapsedMs(start) / rounds;
+  size_t parseAllocs = heapAllocs, parsePeak = heapPeak;
+
+  // Serialize
+  heapAllocs = heapPeak = 0;
+  start = std::chrono::steady_clock::now();
+  for (int r = 0; r < rounds; r++) {
+    PresetWriter writer(discard, nullptr);
+    writer.beginArray();
+    for (int i = 0; i < count; i++) writer.writePreset(name, notes, values);
+    writer.endArray();
+  }
+  double writeMs = elapsedMs(start) / rounds;
+  counting = false;
+  size_t writeAllocs = heapAllocs, writePeak = heapPeak;
+
+  // Resident size of the loaded presets
+  std::vector<LegacyPreset> legacy;
+  heapBytes = heapAllocs = 0;
+  counting = true;
+  file.pos = 0;
+  {
+    PresetReader reader(readMemory, &file);
+    while (reader.next(name, notes, values)) legacy.push_back(LegacyPreset{name, notes, values});
+  }
+  counting = false;
+  size_t legacyBytes = heapBytes, legacyAllocs = heapAllocs;
+
+  PresetTable table;
+  file.pos = 0;
+  {
+    PresetReader reader(readMemory, &file);
+    while (reader.next(name, notes, values)) table.put(name, notes, values);
+  }
+
+  // Lookup by name: linear scan against the hashed index
+  const int lookups = 100000;
+  volatile size_t found = 0;
+  start = std::chrono::steady_clock::now();
+  for (int k = 0; k < lookups; k++) {
+    snprintf(name, sizeof(name), "Material %04d", (k * 7919) % count);
+    for (size_t i = 0; i < legacy.size(); i++) {
+      if (legacy[i].name == name) {
+        found = found + i;
+        break;
+      }
+    }
+  }
+  double scanNs = elapsedMs(start) * 1e6 / lookups;
+  start = std::chrono::steady_clock::now();
+  for (int k = 0; k < lookups; k++) {
+    snprintf(name, sizeof(name), "Material %04d", (k * 7919) % count);
+    found = found + table.find(name);
+  }
+  double hashNs = elapsedMs(start) * 1e6 / lookups;
+
+  size_t working = sizeof(PresetReader) + sizeof(name) + sizeof(notes) + sizeof(values);
+  printf("presets:          %d (%zu bytes of JSON)\n", count, file.data.size());
+  printf("load:             %.3f ms (%.2f us/preset)\n", parseMs, parseMs * 1000.0 / count);
+  printf("save:             %.3f ms (%.2f us/preset)\n", writeMs, writeMs * 1000.0 / count);
+  printf("heap during load: %zu allocations, %zu bytes peak\n", parseAllocs, parsePeak);
+  printf("heap during save: %zu allocations, %zu bytes peak\n", writeAllocs, writePeak);
+  printf("load working set: %zu bytes (reader + name + notes + values), independent of count\n", working);
+  printf("in RAM, before:   %zu bytes, %zu allocations (%.1f bytes/preset, vector<{string, string, values}>)\n",
+         legacyBytes, legacyAllocs, (double)legacyBytes / count);
+  printf("in RAM, after:    %zu bytes, 1 allocation (%.1f bytes/preset, PresetTable; %zu in use)\n",
+         table.capacityBytes(), (double)table.capacityBytes() / count, table.usedBytes());
+  printf("find by name:     %.0f ns linear scan, %.0f ns hashed\n", scanNs, hashNs);
+  printf("checksum:         %.1f (%d presets parsed)\n", checksum, parsed);
+  return 0;
+}
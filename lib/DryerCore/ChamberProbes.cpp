@@ -0,0 +1,158 @@
+#include "ChamberProbes.h"
+
+#include <math.h>
+
+ChamberProbes::ChamberProbes() : mux(nullptr), configs(nullptr), probeCount(0), lastServiceMs(0), serviced(false) {}
+
+ChamberProbes::ChamberProbes(I2cWriteFn write, I2cReadFn read, void* ctx, I2cMux* mux, const ProbeConfig* configs,
+                             size_t count, const SensorFilterConfig& temperatureFilter,
+                             const SensorFilterConfig& humidityFilter) {
+  configure(write, read, ctx, mux, configs, count, temperatureFilter, humidityFilter);
+}
+
+void ChamberProbes::configure(I2cWriteFn write, I2cReadFn read, void* ctx, I2cMux* mux, const ProbeConfig* configs,
+                              size_t count, const SensorFilterConfig& temperatureFilter,
+                              const SensorFilterConfig& humidityFilter) {
+  this->mux = mux;
+  this->configs = configs;
+  probeCount = count < MAX_PROBES ? count : MAX_PROBES;
+  lastServiceMs = 0;
+  serviced = false;
+  for (size_t i = 0; i < probeCount; i++) {
+    sensors[i] = Sht31Sensor(write, read, ctx, configs[i].address);
+    temperatureFilters[i].configure(temperatureFilter);
+    humidityFilters[i].configure(humidityFilter);
+    present[i] = false;
+    pendingDt[i] = 0.0f;
+
+    // Insertion sort by channel; the main bus (-1) comes first
+    size_t j = i;
+    for (; j > 0 && configs[order[j - 1]].muxChannel > configs[i].muxChannel; j--) order[j] = order[j - 1];
+    order[j] = (uint8_t)i;
+  }
+}
+
+// Routes the bus to a probe's mux channel
+bool ChamberProbes::select(int8_t channel) {
+  if (!mux) return channel < 0;
+  return mux->select(channel);
+}
+
+size_t ChamberProbes::begin() {
+  if (mux) mux->invalidate();
+  size_t found = 0;
+  for (size_t k = 0; k < probeCount; k++) {
+    size_t i = order[k];
+    present[i] = select(configs[i].muxChannel) && sensors[i].begin();
+    temperatureFilters[i].reset();
+    humidityFilters[i].reset();
+    pendingDt[i] = 0.0f;
+    if (present[i]) found++;
+  }
+  serviced = false;
+  return found;
+}
+
+size_t ChamberProbes::service(uint32_t nowMs) {
+  float dt = serviced ? (nowMs - lastServiceMs) / 1000.0f : 0.0f;
+  lastServiceMs = nowMs;
+  serviced = true;
+  size_t failed = 0;
+
+  for (size_t k = 0; k < probeCount; k++) {
+    size_t i = order[k];
+    if (!present[i]) continue;
+    pendingDt[i] += dt;
+    bool sampleFailed = !select(configs[i].muxChannel);
+    if (!sampleFailed) {
+      Sht31Sensor::Status status = sensors[i].poll(nowMs);
+      if (status == Sht31Sensor::READY) {
+        temperatureFilters[i].add(sensors[i].temperature(), pendingDt[i]);
+        humidityFilters[i].add(sensors[i].humidity(), pendingDt[i]);
+        pendingDt[i] = 0.0f;
+      }
+      sampleFailed = status == Sht31Sensor::FAILED;
+      // A probe that does not take the next command counts as a failed sample too. One
+      // still measuring (a tick shorter than its conversion) is polled again next tick.
+      if (!sensors[i].isMeasuring() && !sensors[i].start(nowMs)) sampleFailed = true;
+    }
+    if (sampleFailed) {
+      temperatureFilters[i].add(NAN, pendingDt[i]);
+      humidityFilters[i].add(NAN, pendingDt[i]);
+      pendingDt[i] = 0.0f;
+      failed++;
+    }
+  }
+  return failed;
+}
+
+size_t ChamberProbes::presentCount() const {
+  size_t n = 0;
+  for (size_t i = 0; i < probeCount; i++) {
+    if (present[i]) n++;
+  }
+  return n;
+}
+
+ProbeReading ChamberProbes::reading(size_t i) const {
+  ProbeReading r;
+  r.present = present[i];
+  r.valid = present[i] && temperatureFilters[i].isValid() && humidityFilters[i].isValid();
+  r.temperature = r.valid ? temperatureFilters[i].value() : NAN;
+  r.humidity = r.valid ? humidityFilters[i].value() : NAN;
+  r.temperatureSigma = r.valid ? temperatureFilters[i].uncertainty() : NAN;
+  r.humiditySigma = r.valid ? humidityFilters[i].uncertainty() : NAN;
+  r.errors = sensors[i].getBusErrors() + sensors[i].getCrcErrors();
+  return r;
+}
+
+ChamberReading ChamberProbes::fused() const {
+  ChamberReading c;
+  c.probes = 0;
+  c.meanTemperature = c.meanHumidity = NAN;
+  c.meanTemperatureSigma = c.meanHumiditySigma = NAN;
+  c.coldestTemperature = c.coldestSigma = NAN;
+  c.hottestTemperature = NAN;
+  c.wettestHumidity = c.wettestSigma = NAN;
+  c.coldestProbe = c.hottestProbe = c.wettestProbe = -1;
+  c.temperatureGradient = c.humidityGradient = NAN;
+
+  float sumT = 0, sumH = 0, varT = 0, varH = 0;
+  int bottom = -1, top = -1;
+  ProbeReading readings[MAX_PROBES];
+  for (size_t i = 0; i < probeCount; i++) {
+    ProbeReading& r = readings[i];
+    r = reading(i);
+    if (!r.valid) continue;
+    c.probes++;
+    sumT += r.temperature;
+    sumH += r.humidity;
+    varT += r.temperatureSigma * r.temperatureSigma;
+    varH += r.humiditySigma * r.humiditySigma;
+    if (c.coldestProbe < 0 || r.temperature < c.coldestTemperature) {
+      c.coldestTemperature = r.temperature;
+      c.coldestSigma = r.temperatureSigma;
+      c.coldestProbe = (int8_t)i;
+    }
+    if (c.hottestProbe < 0 || r.temperature > c.hottestTemperature) {
+      c.hottestTemperature = r.temperature;
+      c.hottestProbe = (int8_t)i;
+    }
+    if (c.wettestProbe < 0 || r.humidity > c.wettestHumidity) {
+      c.wettestHumidity = r.humidity;
+      c.wettestSigma = r.humiditySigma;
+      c.wettestProbe = (int8_t)i;
+    }
+    if (bottom < 0 || configs[i].height < configs[bottom].height) bottom = (int)i;
+    if (top < 0 || configs[i].height > configs[top].height) top = (int)i;
+  }
+  if (c.probes == 0) return c;
+
+  c.meanTemperature = sumT / c.probes;
+  c.meanHumidity = sumH / c.probes;
+  c.meanTemperatureSigma = sqrtf(varT) / c.probes;
+  c.meanHumiditySigma = sqrtf(varH) / c.probes;
+  c.temperatureGradient = readings[top].temperature - readings[bottom].temperature;
+  c.humidityGradient = readings[top].humidity - readings[bottom].humidity;
+  return c;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "I2cMux.h"
+#include "SensorFilter.h"
+#include "Sht31Sensor.h"
+
+// Where one SHT31 sits: on the main bus or behind a TCA9548A mux channel, and how high
+// in the chamber, so the fusion can tell top from bottom.
+struct ProbeConfig {
+  int8_t muxChannel; // 0-7, or -1 for the main bus
+  uint8_t address;   // 0x44 or 0x45
+  float height;      // cm above the chamber floor
+};
+
+// One probe's filtered reading
+struct ProbeReading {
+  bool present;           // Answered at begin()
+  bool valid;             // Both filters have an estimate
+  float temperature;      // NAN while invalid
+  float humidity;
+  float temperatureSigma;
+  float humiditySigma;
+  uint32_t errors;        // Bus and CRC errors so far
+};
+
+// Filter settings for the firmware's probes, sampled every control tick (250 ms): median
+// of the last 5 samples (1.25 s) to drop spikes, then a Kalman filter that follows
+// warm-up ramps. Noise figures suit an SHT31 in a stirred chamber; 8 failed samples in
+// a row (2 s) and the probe's reading is given up.
+static const SensorFilterConfig PROBE_TEMPERATURE_FILTER = {5, 0.0005f, 0.15f, 8};
+static const SensorFilterConfig PROBE_HUMIDITY_FILTER = {5, 0.0005f, 0.3f, 8};
+
+// The chamber as a whole, fused from every valid probe
+struct ChamberReading {
+  uint8_t probes;              // Probes that contributed; the rest are NAN when 0
+  float meanTemperature;
+  float meanHumidity;
+  float meanTemperatureSigma;  // Of the mean, from the probes' own uncertainties
+  float meanHumiditySigma;
+  float coldestTemperature;
+  float coldestSigma;
+  int8_t coldestProbe;
+  float hottestTemperature;
+  int8_t hottestProbe;
+  float wettestHumidity;
+  float wettestSigma;
+  int8_t wettestProbe;
+  float temperatureGradient;   // Top probe minus bottom probe; 0 with a single height
+  float humidityGradient;
+};
+
+// Several SHT31s read as one chamber.
+//
+// Each control tick service() collects the measurements started on the previous tick
+// and starts the next ones. Probes are visited grouped by mux channel, so the mux is
+// switched once per channel per tick and all probes on a channel are read back to back.
+// Every probe has its own median/Kalman filters; fused() combines their estimates.
+//
+// Without a mux only main-bus probes (channel -1) can answer. With one, the main bus
+// is read with every channel closed, so a probe behind the mux cannot answer for one
+// on the main bus at the same address. Several ChamberProbes may share one mux.
+class ChamberProbes {
+public:
+  static const size_t MAX_PROBES = 8;
+
+  ChamberProbes(); // No probes until configure()
+  ChamberProbes(I2cWriteFn write, I2cReadFn read, void* ctx, I2cMux* mux, const ProbeConfig* configs,
+                size_t count, const SensorFilterConfig& temperatureFilter, const SensorFilterConfig& humidityFilter);
+
+  // Replaces the probe table; begin() has to be called again
+  void configure(I2cWriteFn write, I2cReadFn read, void* ctx, I2cMux* mux, const ProbeConfig* configs,
+                 size_t count, const SensorFilterConfig& temperatureFilter, const SensorFilterConfig& humidityFilter);
+
+  // Resets every configured probe. Probes that do not answer are left out from then on.
+  // Returns the number present.
+  size_t begin();
+
+  // Collects and restarts all present probes. A probe still measuring is left to finish;
+  // the time is carried to its filters with its next sample. Returns how many failed
+  // this tick.
+  size_t service(uint32_t nowMs);
+
+  size_t count() const { return probeCount; }
+  size_t presentCount() const;
+  const ProbeConfig& config(size_t i) const { return configs[i]; }
+  ProbeReading reading(size_t i) const;
+  ChamberReading fused() const;
+
+private:
+  bool select(int8_t channel);
+
+  I2cMux* mux;
+  const ProbeConfig* configs;
+  size_t probeCount;
+  uint8_t order[MAX_PROBES]; // Probe indices sorted by mux channel
+  Sht31Sensor sensors[MAX_PROBES];
+  SensorFilter temperatureFilters[MAX_PROBES];
+  SensorFilter humidityFilters[MAX_PROBES];
+  bool present[MAX_PROBES];
+  float pendingDt[MAX_PROBES]; // s since the probe's filters were last fed
+  uint32_t lastServiceMs;
+  bool serviced;               // lastServiceMs is set, since begin()
+};
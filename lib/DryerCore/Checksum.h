@@ -0,0 +1,11 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// CRC-8 used by Sensirion: polynomial 0x31, initial value 0xFF. The SHT31 checks its
+// words with it, and the on-flash log its records.
+uint8_t crc8(const uint8_t* data, size_t len);
+
+// FNV-1a over a NUL-terminated string
+uint32_t fnv1a(const char* s);
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// Bounded queue of plain-data commands from any number of tasks to one consumer.
+// Each cell carries a sequence number that says whether it is free for the producer
+// holding a given ticket or holds a command for the consumer, so neither side takes
+// a lock; a producer that finds the queue full gets false back instead of waiting.
+// (D. Vyukov's bounded MPMC queue, with a single consumer.)
+template <typename T, size_t Capacity>
+class CommandQueue {
+  static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+  CommandQueue() : head(0), tail(0), rejected(0) {
+    for (size_t i = 0; i < Capacity; i++) cells[i].sequence.store(i, std::memory_order_relaxed);
+  }
+
+  // Producer side (any task). Returns false if the queue is full.
+  bool push(const T& command) {
+    size_t pos = tail.load(std::memory_order_relaxed);
+    for (;;) {
+      Cell& cell = cells[pos & (Capacity - 1)];
+      size_t seq = cell.sequence.load(std::memory_order_acquire);
+      intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+      if (diff == 0) {
+        if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          cell.command = command;
+          cell.sequence.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        rejected.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      } else {
+        pos = tail.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // Producer side: true if a push() now would succeed. Only a promise when the caller
+  // is the sole producer; the consumer can only make more room meanwhile.
+  bool hasRoom() const {
+    size_t pos = tail.load(std::memory_order_relaxed);
+    return cells[pos & (Capacity - 1)].sequence.load(std::memory_order_acquire) == pos;
+  }
+
+  // Consumer side (one task). Returns false if the queue is empty.
+  bool pop(T& command) {
+    Cell& cell = cells[head & (Capacity - 1)];
+    size_t seq = cell.sequence.load(std::memory_order_acquire);
+    if ((intptr_t)seq - (intptr_t)(head + 1) < 0) return false;
+    command = cell.command;
+    cell.sequence.store(head + Capacity, std::memory_order_release);
+    head++;
+    return true;
+  }
+
+  // Commands turned away because the queue was full
+  uint32_t getRejected() const { return rejected.load(std::memory_order_relaxed); }
+
+private:
+  struct Cell {
+    std::atomic<size_t> sequence;
+    T command;
+  };
+
+  Cell cells[Capacity];
+  size_t head; // Consumer only
+  std::atomic<size_t> tail;
+  std::atomic<uint32_t> rejected;
+};
@@ -0,0 +1,344 @@
+#include "DryerZone.h"
+
+#include <math.h>
+#include <stdio.h>
+
+DryerZone::DryerZone()
+  : hooks{nullptr, nullptr, nullptr, nullptr}, index(0), chamberModel{0.0f, 0.0f, 0.0f, 0.0f},
+    controlPoint(POINT_MEAN), currentTemperature(0.0f), currentHumidity(0.0f), temperatureSigma(0.0f),
+    humiditySigma(0.0f), hottestTemperature(0.0f), humidityRate(0.0f),
+    humidityHistory(HUMIDITY_HISTORY_DURATION), currentState(STATE_IDLE), currentStatus(STATUS_IDLE),
+    lastTransitionReason(REASON_NONE), enabled(false), stalled(false), heatStartTime(0), heaterDuty(0.0f),
+    targetTemperature(0.0f), lastPidUpdateTime(0), modelOwnsHeater(false), ambientTemperature(20.0f) {
+  settings.setDefaults();
+  settings.dryingTemp = 50.0f;
+  settings.setpointHum = 30.0f;
+  settings.warmTemp = 35.0f;
+  settings.humHyst = 5.0f; // %RH to allow humidity to rise before re-engaging drying
+  // Stall settings are no longer used for process control but are kept for UI reporting.
+  settings.stallInterval = 1800000; // 30 minutes
+  settings.stallDelta = 0.5f;       // %RH drop
+  settings.heatDur = 240 * 60000;   // 4 hours
+  settings.logInt = 60000;          // 1 minute
+  chamber = ChamberReading{};
+  chamber.probes = 0;
+}
+
+void DryerZone::log(LogEvent event, uint8_t detail) {
+  if (hooks.log) hooks.log(hooks.ctx, *this, event, detail);
+}
+
+void DryerZone::message(ZoneMessage type, const char* text) {
+  if (hooks.message) hooks.message(hooks.ctx, *this, type, text);
+}
+
+void DryerZone::setSettings(const PresetValues& values) {
+  settings = values;
+  settings.isDefault = false;
+  FopdtModel model = {values.modelGain, values.modelTau, values.modelDeadTime, 0.0f};
+  if (model.gain != chamberModel.gain || model.timeConstant != chamberModel.timeConstant ||
+      model.deadTime != chamberModel.deadTime) {
+    chamberModel = model;
+    warmup.setModel(chamberModel);
+  }
+}
+
+void DryerZone::selectMode(Mode mode, uint32_t nowMs) {
+  settings.mode = mode;
+
+  // If the process is already running, force an immediate state change.
+  if (!enabled) return;
+  switch (mode) {
+    case MODE_DRY:
+      currentState = STATE_DRYING;
+      lastTransitionReason = REASON_USER_ACTION;
+      break;
+    case MODE_HEAT:
+      currentState = STATE_HEATING;
+      heatStartTime = nowMs; // Restart the heat timer
+      break;
+    case MODE_WARM:
+      currentState = STATE_WARMING;
+      lastTransitionReason = REASON_USER_ACTION;
+      break;
+    case MODE_IDENTIFY:
+      startIdentification(nowMs);
+      lastTransitionReason = REASON_USER_ACTION;
+      break;
+  }
+}
+
+void DryerZone::setEnabled(bool enabled) {
+  this->enabled = enabled;
+  lastTransitionReason = REASON_USER_ACTION;
+}
+
+void DryerZone::setControlPoint(ControlPoint point) {
+  controlPoint = point;
+  updateControlPoint();
+}
+
+void DryerZone::setReading(const ChamberReading& reading) {
+  chamber = reading;
+  updateControlPoint();
+}
+
+// Picks the values the controller uses from the fused chamber reading
+void DryerZone::updateControlPoint() {
+  bool coldest = controlPoint == POINT_COLDEST;
+  bool wettest = controlPoint == POINT_WETTEST;
+  currentTemperature = coldest ? chamber.coldestTemperature : chamber.meanTemperature; // NAN with no probe
+  temperatureSigma = coldest ? chamber.coldestSigma : chamber.meanTemperatureSigma;
+  currentHumidity = wettest ? chamber.wettestHumidity : chamber.meanHumidity;
+  humiditySigma = wettest ? chamber.wettestSigma : chamber.meanHumiditySigma;
+  hottestTemperature = chamber.hottestTemperature;
+}
+
+void DryerZone::recordHumidity(uint32_t nowMs) {
+  // Readings older than the window are evicted inside
+  if (!isnan(currentHumidity)) humidityHistory.add(nowMs, currentHumidity);
+  // Rate: least-squares slope over the window (0.0 until there are two readings)
+  humidityRate = humidityHistory.ratePerHour();
+}
+
+// Starts a new trend segment on a state change
+void DryerZone::restartHumidityTrend() {
+  humidityHistory.restart(HUMIDITY_RESTART_KEEP);
+  humidityRate = humidityHistory.ratePerHour();
+}
+
+uint32_t DryerZone::getHeatRemaining(uint32_t nowMs) const {
+  if (currentState != STATE_HEATING || !enabled) return 0;
+  uint32_t elapsed = nowMs - heatStartTime;
+  return elapsed < settings.heatDur ? settings.heatDur - elapsed : 0;
+}
+
+float DryerZone::step(uint32_t nowMs) {
+  State previousState = currentState;
+  Mode selectedMode = (Mode)settings.mode;
+  // Humidity has to clear a threshold by this much, so sensor noise cannot flip the state
+  float humidityMargin = HUMIDITY_CONFIDENCE * humiditySigma;
+
+  // --- Informational Stall Detection ---
+  // This does not affect the process, only for UI and logging.
+  bool wasStalledLastLoop = stalled;
+  stalled = selectedMode == MODE_DRY && currentState == STATE_DRYING && humidityRate > -0.1 && humidityRate < 0.1;
+  if (stalled && !wasStalledLastLoop) log(LOG_STALLED);
+
+  if (!enabled) {
+    currentState = STATE_IDLE;
+    if (previousState != STATE_IDLE) lastTransitionReason = REASON_USER_ACTION;
+  } else {
+    // If enabled, decide whether to start or continue a process
+    if (currentState == STATE_IDLE) {
+      // Transition to the user's selected mode and perform initial setup
+      lastTransitionReason = REASON_USER_ACTION;
+      if (selectedMode == MODE_DRY) {
+        currentState = STATE_DRYING;
+      } else if (selectedMode == MODE_HEAT) {
+        currentState = STATE_HEATING;
+        heatStartTime = nowMs; // Start the timer
+      } else if (selectedMode == MODE_WARM) {
+        currentState = STATE_WARMING;
+      } else if (selectedMode == MODE_IDENTIFY) {
+        startIdentification(nowMs);
+      }
+    }
+
+    // --- State Transition Logic ---
+    if (currentState == STATE_DRYING) {
+      // DRYING is for active drying. Once the target is reached, switch to WARMING to
+      // maintain; WARMING returns here if humidity rises above setpoint + hysteresis.
+      if (currentHumidity + humidityMargin <= settings.setpointHum) {
+        restartHumidityTrend();
+        currentState = STATE_WARMING;
+      }
+    } else if (currentState == STATE_HEATING) {
+      // Check for timer completion
+      if (nowMs - heatStartTime > settings.heatDur) {
+        lastTransitionReason = REASON_TIMER_EXPIRED;
+        if (settings.heatAction == ACTION_STOP) {
+          message(ZONE_MSG_DISPLAY, "Heat timer finished. Stopping.");
+          enabled = false; // This will force state to IDLE
+          currentState = STATE_IDLE;
+        } else {
+          message(ZONE_MSG_DISPLAY, "Heat timer finished. Switching to Warm.");
+          currentState = STATE_WARMING;
+        }
+      }
+    } else if (currentState == STATE_IDENTIFYING) {
+      // The step test has finished (or failed): store the model and stop.
+      if (!identifyTest.isRunning()) {
+        finishIdentification();
+        lastTransitionReason = REASON_TARGET_MET;
+        enabled = false; // This will force state to IDLE
+        currentState = STATE_IDLE;
+      }
+    }
+  }
+
+  // An Identify run that was left (disabled or mode changed) must not resume later.
+  if (currentState != STATE_IDENTIFYING && identifyTest.isRunning()) {
+    identifyTest.abort();
+  }
+
+  updateStatus(previousState);
+  if (previousState != currentState) log(LOG_STATUS, currentStatus);
+
+  // --- Temperature target based on State ---
+  float targetTemp = 0.0f;
+  bool heatingRequired = false;
+  switch (currentState) {
+    case STATE_DRYING:
+    case STATE_HEATING:
+      targetTemp = settings.dryingTemp;
+      heatingRequired = true;
+      break;
+    case STATE_WARMING:
+      targetTemp = settings.warmTemp;
+      // If in DRY mode and humidity creeps up, switch back to active drying.
+      if (selectedMode == MODE_DRY && currentHumidity - humidityMargin > (settings.setpointHum + settings.humHyst)) {
+        restartHumidityTrend();
+        currentState = STATE_DRYING; // Reported on the next step
+        targetTemp = settings.dryingTemp;
+      }
+      heatingRequired = true;
+      break;
+    case STATE_IDENTIFYING:
+      targetTemp = settings.dryingTemp; // Used as the temperature limit of the step test
+      heatingRequired = true;
+      break;
+    case STATE_IDLE:
+      break;
+  }
+  targetTemperature = targetTemp;
+  heaterDuty = controlTemperature(nowMs, targetTemp, heatingRequired);
+  return heaterDuty;
+}
+
+void DryerZone::updateStatus(State previousState) {
+  Mode selectedMode = (Mode)settings.mode;
+  if (currentState == STATE_IDLE) {
+    if (previousState == STATE_HEATING && lastTransitionReason == REASON_TIMER_EXPIRED) {
+      currentStatus = STATUS_IDLE_HEAT_STOPPED;
+    } else if (previousState == STATE_IDENTIFYING && lastTransitionReason == REASON_TARGET_MET) {
+      currentStatus = identifyTest.getPhase() == StepResponseTest::PHASE_DONE ? STATUS_IDLE_IDENTIFY_DONE : STATUS_IDLE_IDENTIFY_FAILED;
+    } else {
+      currentStatus = STATUS_IDLE;
+    }
+  } else if (selectedMode == MODE_DRY) {
+    // Simplified status for DRY mode based on the active state
+    if (currentState == STATE_DRYING) currentStatus = STATUS_DRY_DRYING;
+    else if (currentState == STATE_WARMING) currentStatus = STATUS_DRY_MAINTAINING;
+  } else if (selectedMode == MODE_HEAT) {
+    if (currentState == STATE_HEATING) currentStatus = STATUS_HEAT_HEATING;
+    else if (currentState == STATE_WARMING) currentStatus = STATUS_HEAT_WARMING;
+  } else if (selectedMode == MODE_WARM) {
+    currentStatus = STATUS_WARM_WARMING;
+  } else if (selectedMode == MODE_IDENTIFY) {
+    if (identifyTest.getPhase() == StepResponseTest::PHASE_BASELINE) currentStatus = STATUS_IDENTIFY_BASELINE;
+    else currentStatus = STATUS_IDENTIFY_STEP;
+  }
+}
+
+// PID or predictive control towards targetTemp; returns the heater duty
+float DryerZone::controlTemperature(uint32_t nowMs, float targetTemp, bool heatingRequired) {
+  float dt = (nowMs - lastPidUpdateTime) / 1000.0f;
+  lastPidUpdateTime = nowMs;
+  float duty;
+
+  if (currentState == STATE_IDENTIFYING) {
+    // The identification experiment drives the heater open-loop. The test only watches
+    // the control point, so a probe running hot ends it here, as it would cut the heater
+    // in closed-loop control.
+    heaterPid.reset();
+    if (identifyTest.isRunning() && hottestTemperature > settings.dryingTemp + OVER_TEMP_CUTOFF) {
+      identifyTest.abort();
+      message(ZONE_MSG_ERROR, "Identify stopped: a probe is over the temperature limit.");
+    }
+    duty = identifyTest.update(nowMs, currentTemperature);
+  } else if (!heatingRequired || isnan(currentTemperature)) {
+    // Not heating (or no valid reading): heater off and start the PID fresh next time.
+    heaterPid.reset();
+    duty = 0.0f;
+    modelOwnsHeater = false;
+    if (!heatingRequired && !isnan(currentTemperature)) ambientTemperature = currentTemperature;
+    if (!heatingRequired && runStats.isActive()) {
+      reportRun();
+      runStats.stop();
+    }
+  } else {
+    heaterPid.setGains({settings.kp, settings.ki, settings.kd});
+
+    // A new target (process start, state change or setpoint edit) starts a new run.
+    if (!runStats.isActive() || targetTemp != runStats.getSetpoint()) {
+      if (runStats.isActive()) reportRun();
+      runStats.begin(nowMs, targetTemp, currentTemperature);
+      warmup.begin(targetTemp, currentTemperature, ambientTemperature);
+    }
+
+    bool predictive = settings.control == CONTROL_PREDICTIVE && warmup.hasModel();
+    duty = heaterDuty;
+    if (predictive && warmup.update(targetTemp, currentTemperature, duty)) {
+      // The model drives the approach (full power or off) until the heat already in
+      // flight will carry the chamber to the setpoint.
+      heaterPid.reset();
+      modelOwnsHeater = true;
+    } else {
+      if (modelOwnsHeater) {
+        // Bumpless handover: start the PID at the model's steady-state duty.
+        heaterPid.preload(warmup.steadyStateDuty(targetTemp));
+        modelOwnsHeater = false;
+      }
+      // In predictive mode the PID sees the model's dead-time-compensated temperature.
+      float measured = predictive ? warmup.predictedTemperature(currentTemperature) : currentTemperature;
+      duty = heaterPid.update(targetTemp, measured, dt);
+    }
+    if (hottestTemperature > targetTemp + OVER_TEMP_CUTOFF) duty = 0.0f;
+
+    if (runStats.update(nowMs, currentTemperature)) log(LOG_SETPOINT_REACHED);
+  }
+  warmup.observe(dt, duty);
+  return duty;
+}
+
+void DryerZone::startIdentification(uint32_t nowMs) {
+  currentState = STATE_IDENTIFYING;
+  identifyTest.start(nowMs, IDENTIFY_STEP_DUTY, settings.dryingTemp);
+  log(LOG_IDENTIFY_START);
+}
+
+void DryerZone::finishIdentification() {
+  if (identifyTest.getPhase() != StepResponseTest::PHASE_DONE) {
+    message(ZONE_MSG_DISPLAY, "Identify failed. Model unchanged.");
+    message(ZONE_MSG_ERROR, "Identify failed: no usable step response.");
+    return;
+  }
+
+  chamberModel = identifyTest.getModel();
+  warmup.setModel(chamberModel);
+  settings.modelGain = chamberModel.gain;
+  settings.modelTau = chamberModel.timeConstant;
+  settings.modelDeadTime = chamberModel.deadTime;
+  char msg[80];
+  snprintf(msg, sizeof(msg), "Model: K=%.3f C/%%, tau=%.0f s, dead=%.0f s", chamberModel.gain,
+           chamberModel.timeConstant, chamberModel.deadTime);
+  message(ZONE_MSG_DISPLAY, msg);
+  message(ZONE_MSG_INFO, msg);
+  log(LOG_IDENTIFY_DONE);
+  if (hooks.modelIdentified) hooks.modelIdentified(hooks.ctx, *this);
+}
+
+// Summarises the approach that just ended, so strategies can be compared run by run.
+void DryerZone::reportRun() {
+  const char* strategy = settings.control == CONTROL_PREDICTIVE ? "Predictive" : "PID";
+  char msg[100];
+  if (runStats.hasReached()) {
+    snprintf(msg, sizeof(msg), "Run to %.1f C (%s): %lu s to setpoint, overshoot %.2f C",
+             runStats.getSetpoint(), strategy, (unsigned long)(runStats.getTimeToSetpointMs() / 1000),
+             runStats.getOvershoot());
+  } else {
+    snprintf(msg, sizeof(msg), "Run to %.1f C (%s): setpoint not reached", runStats.getSetpoint(), strategy);
+  }
+  message(ZONE_MSG_INFO, msg);
+}
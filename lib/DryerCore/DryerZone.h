@@ -0,0 +1,169 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ChamberProbes.h"
+#include "HumidityRateWindow.h"
+#include "LogFrame.h"
+#include "PidController.h"
+#include "PredictiveWarmup.h"
+#include "PresetCodec.h"
+#include "SetpointRunStats.h"
+#include "ThermalModel.h"
+
+enum State {
+  STATE_IDLE,
+  STATE_DRYING,
+  STATE_HEATING,
+  STATE_WARMING,
+  STATE_IDENTIFYING
+};
+enum Mode {
+  MODE_DRY,
+  MODE_HEAT,
+  MODE_WARM,
+  MODE_IDENTIFY
+};
+enum ControlStrategy {
+  CONTROL_PID,
+  CONTROL_PREDICTIVE
+};
+enum HeatCompletionAction {
+  ACTION_STOP,
+  ACTION_WARM
+};
+enum TransitionReason {
+  REASON_NONE,
+  REASON_USER_ACTION,
+  REASON_TARGET_MET,
+  REASON_STALLED,
+  REASON_TIMER_EXPIRED
+};
+
+// Which point of the chamber the controller holds at the setpoints. The over-temperature
+// cutoff always watches the hottest probe.
+enum ControlPoint {
+  POINT_MEAN,    // Average of all probes
+  POINT_COLDEST, // Temperature control on the coldest probe
+  POINT_WETTEST  // Humidity decisions on the wettest probe
+};
+
+// Where a zone's messages are shown
+enum ZoneMessage {
+  ZONE_MSG_DISPLAY, // TFT message box
+  ZONE_MSG_INFO,    // Web clients
+  ZONE_MSG_ERROR    // Web clients, as an error
+};
+
+class DryerZone;
+
+// How a zone reaches the rest of the firmware; any hook may be left null.
+struct ZoneHooks {
+  void (*log)(void* ctx, const DryerZone& zone, LogEvent event, uint8_t detail);
+  void (*message)(void* ctx, const DryerZone& zone, ZoneMessage type, const char* text);
+  void (*modelIdentified)(void* ctx, const DryerZone& zone); // Identify found a new chamber model
+  void* ctx;
+};
+
+// The controller of one drying chamber: the DRY/HEAT/WARM/IDENTIFY state machine, PID
+// and predictive warm-up, humidity trend and run statistics. Readings and the time come
+// in as arguments and a heater duty goes out, so several zones can share one board and
+// the controller also runs on a host. Not thread-safe; one task drives a zone.
+class DryerZone {
+public:
+  static const uint32_t HUMIDITY_HISTORY_DURATION = 30 * 60 * 1000; // 30 minutes
+  static const size_t HUMIDITY_HISTORY_CAPACITY = 960;  // One reading every 2 s, plus margin
+  static const size_t HUMIDITY_RESTART_KEEP = 15;       // ~30 s of readings carried across state changes
+  static constexpr float HUMIDITY_CONFIDENCE = 2.0f;    // Sigmas humidity must clear a DRYING/WARMING threshold by
+  static constexpr float OVER_TEMP_CUTOFF = 3.0f;       // Heater off when any probe is this far above target
+  static constexpr float IDENTIFY_STEP_DUTY = 50.0f;    // % heater duty applied during the step
+
+  DryerZone();
+
+  void setHooks(const ZoneHooks& hooks) { this->hooks = hooks; }
+  void setIndex(uint8_t index) { this->index = index; }
+  uint8_t getIndex() const { return index; }
+
+  // Takes over every setting, as applying a preset does
+  void setSettings(const PresetValues& values);
+  const PresetValues& getSettings() const { return settings; }
+
+  // Switches a running process to the new mode at once
+  void selectMode(Mode mode, uint32_t nowMs);
+  void setEnabled(bool enabled);
+  void setControlPoint(ControlPoint point);
+
+  // Latest fused probe readings, every sensor tick
+  void setReading(const ChamberReading& reading);
+  // Feeds the humidity trend; called every 2 s
+  void recordHumidity(uint32_t nowMs);
+
+  // Runs the state machine and the temperature controller once (every second).
+  // Returns the heater duty to apply, in %.
+  float step(uint32_t nowMs);
+
+  State getState() const { return currentState; }
+  ProcessStatus getStatus() const { return currentStatus; }
+  bool isEnabled() const { return enabled; }
+  bool isStalled() const { return stalled; }
+  ControlPoint getControlPoint() const { return controlPoint; }
+  const ChamberReading& getChamber() const { return chamber; }
+  float getTemperature() const { return currentTemperature; } // At the control point, NAN without probes
+  float getHumidity() const { return currentHumidity; }
+  float getTemperatureSigma() const { return temperatureSigma; }
+  float getHumiditySigma() const { return humiditySigma; }
+  float getHumidityRate() const { return humidityRate; }          // % per hour
+  float getHeaterDuty() const { return heaterDuty; }
+  float getTargetTemperature() const { return targetTemperature; } // 0 while idle
+  uint32_t getHeatRemaining(uint32_t nowMs) const;                 // ms left of a HEAT run
+  const FopdtModel& getModel() const { return chamberModel; }
+  const PidController& getPid() const { return heaterPid; }
+  const SetpointRunStats& getRunStats() const { return runStats; }
+
+private:
+  void log(LogEvent event, uint8_t detail = 0);
+  void message(ZoneMessage type, const char* text);
+  void updateControlPoint();
+  void restartHumidityTrend();
+  void startIdentification(uint32_t nowMs);
+  void finishIdentification();
+  void reportRun();
+  void updateStatus(State previousState);
+  float controlTemperature(uint32_t nowMs, float targetTemp, bool heatingRequired);
+
+  ZoneHooks hooks;
+  uint8_t index;
+  PresetValues settings;
+  FopdtModel chamberModel;
+
+  // Readings
+  ControlPoint controlPoint;
+  ChamberReading chamber;
+  float currentTemperature;
+  float currentHumidity;
+  float temperatureSigma;
+  float humiditySigma;
+  float hottestTemperature;
+  float humidityRate;
+  HumidityRateWindow<HUMIDITY_HISTORY_CAPACITY> humidityHistory;
+
+  // Process
+  State currentState;
+  ProcessStatus currentStatus;
+  TransitionReason lastTransitionReason;
+  bool enabled; // Master switch, OFF by default for safety
+  bool stalled; // Informational, for the UI and the log
+  uint32_t heatStartTime;
+
+  // Heater
+  PidController heaterPid;       // Output is heater duty in % (0-100)
+  float heaterDuty;
+  float targetTemperature;
+  uint32_t lastPidUpdateTime;
+  StepResponseTest identifyTest;
+  PredictiveWarmup warmup;       // Uses chamberModel to approach new setpoints in minimum time
+  bool modelOwnsHeater;          // True while warmup drives the heater instead of the PID
+  float ambientTemperature;      // Last temperature seen while idle
+  SetpointRunStats runStats;     // Time-to-setpoint and overshoot of the current approach
+};
@@ -0,0 +1,86 @@
+#include "EventBus.h"
+
+#include <string.h>
+
+#include "PresetCodec.h"
+
+static_assert(((1 + sizeof(BusEvent::text)) % 4) == 0, "Event payload must fill whole words");
+static_assert((EventBus::CAPACITY & (EventBus::CAPACITY - 1)) == 0, "Capacity must be a power of two");
+
+EventBus::EventBus() : nextSequence(0), droppedCount(0) {
+  for (size_t i = 0; i < CAPACITY; i++) {
+    slots[i].stamp.store(0, std::memory_order_relaxed);
+    for (size_t w = 0; w < WORDS; w++) slots[i].words[w].store(0, std::memory_order_relaxed);
+  }
+}
+
+uint32_t EventBus::oldest() const {
+  uint32_t h = head();
+  return h > CAPACITY ? h - CAPACITY : 0;
+}
+
+bool EventBus::publish(BusEventType type, const char* text) {
+  uint8_t payload[WORDS * 4];
+  size_t len = utf8Prefix(text, TEXT_MAX);
+  payload[0] = type;
+  memcpy(payload + 1, text, len);
+  memset(payload + 1 + len, 0, sizeof(payload) - 1 - len);
+
+  uint32_t sequence = nextSequence.fetch_add(1, std::memory_order_relaxed);
+  Slot& slot = slots[sequence & (CAPACITY - 1)];
+  uint32_t writing = 2 * sequence + 1;
+  uint32_t stamp = slot.stamp.load(std::memory_order_relaxed);
+  do {
+    // Still being written by a producer a lap behind, or already taken by one a lap ahead
+    if ((stamp & 1) || (int32_t)(stamp - writing) > 0) {
+      droppedCount.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+  } while (!slot.stamp.compare_exchange_weak(stamp, writing, std::memory_order_relaxed));
+  std::atomic_thread_fence(std::memory_order_release); // Stamp is seen before the words
+
+  for (size_t w = 0; w < WORDS; w++) {
+    uint32_t word;
+    memcpy(&word, payload + w * 4, 4);
+    slot.words[w].store(word, std::memory_order_relaxed);
+  }
+  slot.stamp.store(writing + 1, std::memory_order_release);
+  return true;
+}
+
+bool EventBus::read(EventCursor& cursor, BusEvent& out) const {
+  for (;;) {
+    uint32_t h = head();
+    if ((int32_t)(h - cursor.next) < 0) cursor.next = oldest();
+    if (h - cursor.next > CAPACITY) {
+      // Lapped: the events in between are gone
+      cursor.missed += h - CAPACITY - cursor.next;
+      cursor.next = h - CAPACITY;
+    }
+    if (cursor.next == h) return false;
+
+    const Slot& slot = slots[cursor.next & (CAPACITY - 1)];
+    uint32_t complete = 2 * cursor.next + 2;
+    uint32_t before = slot.stamp.load(std::memory_order_acquire);
+    if (before != complete) {
+      // Not written yet, or dropped by its producer (skipped once lapped)
+      if ((int32_t)(before - complete) < 0) return false;
+      continue; // Replaced by a newer event, so the lap check above moves past it
+    }
+
+    uint8_t payload[WORDS * 4];
+    for (size_t w = 0; w < WORDS; w++) {
+      uint32_t word = slot.words[w].load(std::memory_order_relaxed);
+      memcpy(payload + w * 4, &word, 4);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.stamp.load(std::memory_order_relaxed) != before) continue; // Replaced mid-copy
+
+    out.sequence = cursor.next;
+    out.type = payload[0];
+    memcpy(out.text, payload + 1, sizeof(out.text));
+    out.text[sizeof(out.text) - 1] = 0;
+    cursor.next++;
+    return true;
+  }
+}
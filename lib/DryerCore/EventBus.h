@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+enum BusEventType : uint8_t {
+  EVENT_INFO,    // For the web clients
+  EVENT_ERROR,   // For the web clients
+  EVENT_DISPLAY, // Text for the TFT message box ("" clears it)
+};
+
+struct BusEvent {
+  uint32_t sequence;
+  uint8_t type;   // BusEventType
+  char text[99];  // NUL-terminated
+};
+
+// Where one consumer has read up to. Each consumer keeps its own, so every consumer
+// sees every event (unless it falls a full ring behind).
+struct EventCursor {
+  uint32_t next = 0;   // Sequence of the next event to read
+  uint32_t missed = 0; // Events overwritten before this consumer got to them
+};
+
+// Fixed-size ring of short text events, written by any number of tasks on either core
+// and read by any number of consumers. Neither side takes a lock or waits.
+//
+// A producer claims the next sequence number, takes the slot it maps to by switching
+// the slot's stamp to "being written", copies the event in and stamps it with the
+// sequence. A consumer copies a slot and checks the stamp before and after, so it can
+// tell a complete event from one that is being replaced. The payload is kept in
+// atomic words, so those copies are not data races.
+//
+// Nothing ever waits on a slow consumer: the ring overwrites the oldest events and the
+// consumer's cursor counts what it missed. A producer that finds its slot still being
+// written by a producer one lap earlier drops its event and counts it in dropped();
+// consumers skip that sequence number once the ring laps it.
+class EventBus {
+public:
+  static const size_t CAPACITY = 32; // Power of two
+  static const size_t TEXT_MAX = sizeof(BusEvent::text) - 1;
+
+  EventBus();
+
+  // Publishes an event; text longer than TEXT_MAX is cut at a UTF-8 character boundary.
+  // Returns false if the event was dropped.
+  bool publish(BusEventType type, const char* text);
+
+  // Reads the event at the cursor and advances it. Returns false if there is nothing
+  // new yet. A cursor ahead of the bus (e.g. kept by a browser across a reboot) starts
+  // over at the oldest event.
+  bool read(EventCursor& cursor, BusEvent& out) const;
+
+  // Sequence the next event will get; a cursor starting here sees only new events
+  uint32_t head() const { return nextSequence.load(std::memory_order_acquire); }
+  // Sequence of the oldest event still in the ring
+  uint32_t oldest() const;
+  uint32_t dropped() const { return droppedCount.load(std::memory_order_relaxed); }
+
+private:
+  static const size_t WORDS = (1 + sizeof(BusEvent::text)) / 4; // Type byte + text
+
+  // Stamp: 2 * sequence + 1 while being written, 2 * sequence + 2 once complete
+  struct Slot {
+    std::atomic<uint32_t> stamp;
+    std::atomic<uint32_t> words[WORDS];
+  };
+
+  Slot slots[CAPACITY];
+  std::atomic<uint32_t> nextSequence;
+  std::atomic<uint32_t> droppedCount;
+};
@@ -0,0 +1,213 @@
+#include "HistoryRollup.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "LogFrame.h"
+
+// Nominal spacing of the raw tier; sensor samples arrive every 2 s.
+static const uint32_t RAW_RESOLUTION_S = 2;
+
+void HistoryRollup::Tier::push(const Entry& e) {
+  entries[head] = e;
+  head = (head + 1) % capacity;
+  if (count < capacity) count++;
+}
+
+// Index of the first entry starting at or after `time`.
+size_t HistoryRollup::Tier::lowerBound(uint32_t time) const {
+  size_t lo = 0, hi = count;
+  while (lo < hi) {
+    size_t mid = (lo + hi) / 2;
+    if (at(mid).start < time) lo = mid + 1;
+    else hi = mid;
+  }
+  return lo;
+}
+
+HistoryRollup::HistoryRollup() {
+  Entry* storage[TIER_COUNT] = { rawEntries, minuteEntries, quarterEntries };
+  const size_t capacities[TIER_COUNT] = { RAW_CAPACITY, MINUTE_CAPACITY, QUARTER_CAPACITY };
+  const uint32_t resolutions[TIER_COUNT] = { RAW_RESOLUTION_S, 60, 900 };
+  for (size_t i = 0; i < TIER_COUNT; i++) {
+    tiers[i].entries = storage[i];
+    tiers[i].capacity = capacities[i];
+    tiers[i].resolution = resolutions[i];
+    tiers[i].head = 0;
+    tiers[i].count = 0;
+    tiers[i].open.count = 0;
+  }
+}
+
+void HistoryRollup::close(Tier& tier) {
+  const Accumulator& a = tier.open;
+  Entry e;
+  e.start = a.start;
+  e.tempMin = packCenti(a.tempMin);
+  e.tempMean = packCenti(a.tempSum / a.count);
+  e.tempMax = packCenti(a.tempMax);
+  e.humMin = packCentiUnsigned(a.humMin);
+  e.humMean = packCentiUnsigned(a.humSum / a.count);
+  e.humMax = packCentiUnsigned(a.humMax);
+  tier.push(e);
+  tier.open.count = 0;
+}
+
+void HistoryRollup::add(uint32_t timeSec, float temperature, float humidity) {
+  if (isnan(temperature) || isnan(humidity)) return;
+  std::lock_guard<std::mutex> guard(lock);
+
+  Entry raw;
+  raw.start = timeSec;
+  raw.tempMin = raw.tempMean = raw.tempMax = packCenti(temperature);
+  raw.humMin = raw.humMean = raw.humMax = packCentiUnsigned(humidity);
+  tiers[0].push(raw);
+
+  for (size_t i = 1; i < TIER_COUNT; i++) {
+    Tier& tier = tiers[i];
+    uint32_t start = timeSec - timeSec % tier.resolution;
+    if (tier.open.count > 0 && tier.open.start != start) close(tier);
+    Accumulator& a = tier.open;
+    if (a.count == 0) {
+      a.start = start;
+      a.tempMin = a.tempMax = temperature;
+      a.humMin = a.humMax = humidity;
+      a.tempSum = a.humSum = 0.0f;
+    }
+    a.count++;
+    a.tempSum += temperature;
+    a.humSum += humidity;
+    if (temperature < a.tempMin) a.tempMin = temperature;
+    if (temperature > a.tempMax) a.tempMax = temperature;
+    if (humidity < a.humMin) a.humMin = humidity;
+    if (humidity > a.humMax) a.humMax = humidity;
+  }
+}
+
+uint32_t HistoryRollup::oldestTime(uint32_t now) const {
+  std::lock_guard<std::mutex> guard(lock);
+  uint32_t oldest = now;
+  for (size_t i = 0; i < TIER_COUNT; i++) {
+    const Tier& tier = tiers[i];
+    if (tier.count > 0 && tier.at(0).start < oldest) oldest = tier.at(0).start;
+    if (tier.open.count > 0 && tier.open.start < oldest) oldest = tier.open.start;
+  }
+  return oldest;
+}
+
+// Finest tier that holds the bucket containing `from`; the coarsest one otherwise.
+const HistoryRollup::Tier& HistoryRollup::tierFor(uint32_t from) const {
+  for (size_t i = 0; i < TIER_COUNT; i++) {
+    const Tier& t = tiers[i];
+    uint32_t oldest = t.count > 0 ? t.at(0).start : (t.open.count > 0 ? t.open.start : UINT32_MAX);
+    if (oldest < from + t.resolution) return t;
+  }
+  return tiers[TIER_COUNT - 1];
+}
+
+uint32_t HistoryRollup::resolutionAt(uint32_t from) const {
+  std::lock_guard<std::mutex> guard(lock);
+  return tierFor(from).resolution;
+}
+
+bool HistoryRollup::aggregate(uint32_t from, uint32_t to, HistoryPoint& point) const {
+  std::lock_guard<std::mutex> guard(lock);
+  const Tier* tier = &tierFor(from);
+
+  float tempMin = INFINITY, tempMax = -INFINITY, tempSum = 0.0f;
+  float humMin = INFINITY, humMax = -INFINITY, humSum = 0.0f;
+  uint32_t n = 0;
+  auto merge = [&](float tMin, float tMean, float tMax, float hMin, float hMean, float hMax) {
+    if (tMin < tempMin) tempMin = tMin;
+    if (tMax > tempMax) tempMax = tMax;
+    if (hMin < humMin) humMin = hMin;
+    if (hMax > humMax) humMax = hMax;
+    tempSum += tMean;
+    humSum += hMean;
+    n++;
+  };
+
+  for (size_t i = tier->lowerBound(from); i < tier->count && tier->at(i).start < to; i++) {
+    const Entry& e = tier->at(i);
+    merge(unpackCenti(e.tempMin), unpackCenti(e.tempMean), unpackCenti(e.tempMax),
+          unpackCentiUnsigned(e.humMin), unpackCentiUnsigned(e.humMean), unpackCentiUnsigned(e.humMax));
+  }
+  // The bucket still being filled holds the most recent readings
+  const Accumulator& a = tier->open;
+  if (a.count > 0 && a.start >= from && a.start < to) {
+    merge(a.tempMin, a.tempSum / a.count, a.tempMax, a.humMin, a.humSum / a.count, a.humMax);
+  }
+  if (n == 0) return false;
+
+  point.time = from;
+  point.duration = to - from;
+  point.tempMin = tempMin;
+  point.tempMean = tempSum / n;
+  point.tempMax = tempMax;
+  point.humMin = humMin;
+  point.humMean = humSum / n;
+  point.humMax = humMax;
+  return true;
+}
+
+HistoryQuery::HistoryQuery(const HistoryRollup& history, uint32_t now, uint32_t from, uint32_t to, uint32_t points)
+  : history(history), now(now), from(from), to(to), stage(0), first(true), textLen(0), textOffset(0) {
+  if (this->to > now + 1) this->to = now + 1;
+  if (this->from >= this->to) this->from = this->to - 1;
+  if (points == 0) points = 1;
+
+  // Whole buckets of the source tier per step, aligned to its bucket boundaries
+  uint32_t resolution = history.resolutionAt(this->from);
+  this->from -= this->from % resolution;
+  step = (this->to - this->from + points - 1) / points;
+  step = (step + resolution - 1) / resolution * resolution;
+  if (step == 0) step = resolution;
+  cursor = this->from;
+}
+
+bool HistoryQuery::nextText() {
+  int n = 0;
+  if (stage == 0) {
+    n = snprintf(text, sizeof(text), "{\"now\":%lu,\"from\":%lu,\"to\":%lu,\"step\":%lu,\"points\":[",
+                 (unsigned long)now, (unsigned long)from, (unsigned long)to, (unsigned long)step);
+    stage = 1;
+  } else if (stage == 1) {
+    HistoryPoint p;
+    bool found = false;
+    while (!found && cursor < to) {
+      uint32_t end = to - cursor > step ? cursor + step : to;
+      found = history.aggregate(cursor, end, p);
+      cursor = end;
+    }
+    if (found) {
+      n = snprintf(text, sizeof(text), "%s[%lu,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f]", first ? "" : ",",
+                   (unsigned long)p.time, p.tempMin, p.tempMean, p.tempMax, p.humMin, p.humMean, p.humMax);
+      first = false;
+    } else {
+      n = snprintf(text, sizeof(text), "]}");
+      stage = 2;
+    }
+  } else {
+    return false;
+  }
+  textLen = (n > 0 && (size_t)n < sizeof(text)) ? (size_t)n : 0;
+  textOffset = 0;
+  return true;
+}
+
+size_t HistoryQuery::fill(char* buf, size_t size) {
+  size_t len = 0;
+  while (len < size) {
+    if (textOffset < textLen) {
+      size_t n = textLen - textOffset;
+      if (n > size - len) n = size - len;
+      memcpy(buf + len, text + textOffset, n);
+      len += n;
+      textOffset += n;
+      continue;
+    }
+    if (!nextText()) break;
+  }
+  return len;
+}
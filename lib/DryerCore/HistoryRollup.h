@@ -0,0 +1,106 @@
+#pragma once
+
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+
+// One point of a history series: min/mean/max of temperature and humidity over
+// [time, time + duration).
+struct HistoryPoint {
+  uint32_t time; // s since boot
+  uint32_t duration;
+  float tempMin, tempMean, tempMax;
+  float humMin, humMean, humMax;
+};
+
+// Temperature/humidity history in fixed memory, kept at three resolutions:
+//   raw samples for the last 10 minutes (at the 2 s sensor rate),
+//   1 minute buckets for 6 hours, and
+//   15 minute buckets for 4 days.
+// Every tier is fed from the raw samples, so the means are exact. Values are kept in
+// hundredths (16 bytes per entry, about 17 KB in all).
+//
+// add() is called by the sensor task; aggregate() may be called from another task.
+class HistoryRollup {
+public:
+  static const size_t TIER_COUNT = 3;
+
+  HistoryRollup();
+
+  // Adds a sensor reading. Readings with a NAN value are skipped (they leave a gap).
+  void add(uint32_t timeSec, float temperature, float humidity);
+
+  // Oldest time still held by any tier, or `now` if nothing has been added yet.
+  uint32_t oldestTime(uint32_t now) const;
+
+  // Spacing (s) of the finest tier that reaches back to `from`.
+  uint32_t resolutionAt(uint32_t from) const;
+
+  // Merges everything in [from, to) from the finest tier that reaches back to `from`.
+  // Returns false if there is no data in the range.
+  bool aggregate(uint32_t from, uint32_t to, HistoryPoint& point) const;
+
+private:
+  struct Entry {
+    uint32_t start;
+    int16_t tempMin, tempMean, tempMax;
+    uint16_t humMin, humMean, humMax;
+  };
+
+  struct Accumulator {
+    uint32_t start;
+    uint32_t count;
+    float tempMin, tempMax, tempSum;
+    float humMin, humMax, humSum;
+  };
+
+  struct Tier {
+    Entry* entries;
+    size_t capacity;
+    uint32_t resolution; // s
+    size_t head;         // Next slot to write
+    size_t count;
+    Accumulator open;
+
+    const Entry& at(size_t i) const { return entries[(head + capacity - count + i) % capacity]; }
+    void push(const Entry& e);
+    size_t lowerBound(uint32_t time) const;
+  };
+
+  static void close(Tier& tier);
+  const Tier& tierFor(uint32_t from) const;
+
+  static const size_t RAW_CAPACITY = 300;
+  static const size_t MINUTE_CAPACITY = 360;
+  static const size_t QUARTER_CAPACITY = 384;
+
+  Entry rawEntries[RAW_CAPACITY];
+  Entry minuteEntries[MINUTE_CAPACITY];
+  Entry quarterEntries[QUARTER_CAPACITY];
+  Tier tiers[TIER_COUNT];
+  mutable std::mutex lock;
+};
+
+// Streams /history as JSON, one output point at a time, so a long series never has
+// to be built in RAM:
+//   {"now":s,"from":s,"to":s,"step":s,"points":[[t,tMin,tMean,tMax,hMin,hMean,hMax],...]}
+// Each point merges one `step` of the range; steps without data are left out. The step
+// is never finer than the data it is drawn from.
+class HistoryQuery {
+public:
+  HistoryQuery(const HistoryRollup& history, uint32_t now, uint32_t from, uint32_t to, uint32_t points);
+
+  // Fills buf with JSON text (a point may be split across calls). Returns 0 when done.
+  size_t fill(char* buf, size_t size);
+
+private:
+  bool nextText();
+
+  const HistoryRollup& history;
+  uint32_t now, from, to, step;
+  uint32_t cursor;
+  int stage; // 0 = header, 1 = points, 2 = done
+  bool first;
+  char text[128];
+  size_t textLen, textOffset;
+};
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Fixed-size ring buffer of humidity samples that keeps running least-squares sums,
+// so the slope over the window costs O(1) per sample and never touches the heap.
+//
+// Time is stored as a millisecond offset from the oldest sample in the window and
+// humidity as 0.01 %RH steps. All sums are exact 64-bit integers, so adding and
+// evicting samples for days on end cannot accumulate rounding drift.
+template <size_t Capacity>
+class HumidityRateWindow {
+public:
+  explicit HumidityRateWindow(uint32_t windowMs) : windowMs(windowMs) { clear(); }
+
+  void clear() {
+    head = 0;
+    count = 0;
+    origin = 0;
+    sumX = sumY = sumXX = sumXY = 0;
+  }
+
+  // Adds a reading and evicts everything older than the window (or beyond capacity).
+  void add(uint32_t timestamp, float humidity) {
+    while (count > 0 && (timestamp - oldest().timestamp > windowMs || count == Capacity)) {
+      evictOldest();
+    }
+    if (count == 0) origin = timestamp;
+
+    Sample& s = samples[(head + count) % Capacity];
+    s.timestamp = timestamp;
+    s.humidity = toCenti(humidity);
+    count++;
+
+    int64_t x = (int64_t)(timestamp - origin);
+    int64_t y = s.humidity;
+    sumX += x;
+    sumY += y;
+    sumXX += x * x;
+    sumXY += x * y;
+  }
+
+  // Starts a new trend segment (e.g. on a DRYING <-> WARMING transition) while keeping
+  // the newest `keep` samples, so the rate stays defined instead of cold-starting at zero.
+  void restart(size_t keep) {
+    while (count > keep) evictOldest();
+  }
+
+  size_t size() const { return count; }
+
+  // Least-squares slope of humidity over the window, in %RH per hour.
+  float ratePerHour() const {
+    if (count < 2) return 0.0f;
+    double n = (double)count;
+    double denom = n * (double)sumXX - (double)sumX * (double)sumX;
+    if (denom <= 0.0) return 0.0f;
+    double slope = (n * (double)sumXY - (double)sumX * (double)sumY) / denom; // centi-%RH per ms
+    return (float)(slope * 36000.0); // * 3600000 ms/h / 100 centi-%RH/%RH
+  }
+
+private:
+  struct Sample {
+    uint32_t timestamp;
+    int16_t humidity; // 0.01 %RH
+  };
+
+  static int16_t toCenti(float humidity) {
+    if (humidity < 0.0f) humidity = 0.0f;
+    if (humidity > 100.0f) humidity = 100.0f;
+    return (int16_t)(humidity * 100.0f + 0.5f);
+  }
+
+  const Sample& oldest() const { return samples[head]; }
+
+  // The oldest sample always sits at x = 0, so removing it only touches n and sumY.
+  // The sums are then re-based onto the new oldest sample with exact integer shifts.
+  void evictOldest() {
+    sumY -= oldest().humidity;
+    head = (head + 1) % Capacity;
+    count--;
+    if (count == 0) {
+      clear();
+      return;
+    }
+
+    int64_t c = (int64_t)(oldest().timestamp - origin);
+    int64_t n = (int64_t)count;
+    sumXX -= 2 * c * sumX - n * c * c;
+    sumXY -= c * sumY;
+    sumX -= n * c;
+    origin = oldest().timestamp;
+  }
+
+  const uint32_t windowMs;
+  Sample samples[Capacity];
+  size_t head;
+  size_t count;
+  uint32_t origin;
+  int64_t sumX, sumY, sumXX, sumXY;
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "Sht31Sensor.h"
+
+// TCA9548A I2C multiplexer. It remembers the open channel, so selecting the channel
+// that is already open costs no bus traffic. One instance is shared by every device
+// user on the bus; the channel cache is only right if nothing else writes the mux.
+class I2cMux {
+public:
+  static const uint8_t DEFAULT_ADDRESS = 0x70; // A0-A2 low
+
+  I2cMux(I2cWriteFn write, void* ctx, uint8_t address = DEFAULT_ADDRESS)
+    : write(write), ctx(ctx), address(address), selected(UNKNOWN) {}
+
+  // Opens one channel (0-7), or closes all of them for -1, so the main bus is alone
+  bool select(int8_t channel) {
+    if (channel == selected) return true;
+    uint8_t mask = channel < 0 ? 0 : (uint8_t)(1 << channel);
+    if (!write(ctx, address, &mask, 1)) {
+      selected = UNKNOWN;
+      return false;
+    }
+    selected = channel;
+    return true;
+  }
+
+  // Forgets the open channel, e.g. after a bus reset
+  void invalidate() { selected = UNKNOWN; }
+
+private:
+  static const int16_t UNKNOWN = -2;
+
+  I2cWriteFn write;
+  void* ctx;
+  uint8_t address;
+  int16_t selected;
+};
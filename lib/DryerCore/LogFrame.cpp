@@ -0,0 +1,111 @@
+#include "LogFrame.h"
+
+#include <math.h>
+#include <stdio.h>
+
+static const char* const EVENT_NAMES[] = {
+  "TIMED", "HEAT_ON", "HEAT_OFF", "STALLED", "STATUS", "SETPOINT_REACHED", "IDENTIFY_START", "IDENTIFY_DONE"
+};
+static_assert(sizeof(EVENT_NAMES) / sizeof(EVENT_NAMES[0]) == LOG_EVENT_COUNT, "EVENT_NAMES must match LogEvent");
+
+static const char* const STATUS_TEXT[] = {
+  "IDLE", "IDLE (Heat Stopped)", "IDLE (Identify Done)", "IDLE (Identify Failed)",
+  "Dry / DRYING", "Dry / MAINTAINING", "Heat / HEATING", "Heat / WARMING (Time Expired)",
+  "Warm / WARMING", "Identify / BASELINE", "Identify / STEP"
+};
+static_assert(sizeof(STATUS_TEXT) / sizeof(STATUS_TEXT[0]) == STATUS_COUNT, "STATUS_TEXT must match ProcessStatus");
+
+const char* logEventName(uint8_t event) {
+  return event < LOG_EVENT_COUNT ? EVENT_NAMES[event] : "UNKNOWN";
+}
+
+const char* processStatusText(uint8_t status) {
+  return status < STATUS_COUNT ? STATUS_TEXT[status] : "UNKNOWN";
+}
+
+int16_t packCenti(float value) {
+  if (isnan(value)) return INT16_MIN;
+  float scaled = roundf(value * 100.0f);
+  if (scaled > 32767.0f) return 32767;
+  if (scaled < -32767.0f) return -32767;
+  return (int16_t)scaled;
+}
+
+uint16_t packCentiUnsigned(float value) {
+  if (isnan(value)) return 0xFFFF;
+  float scaled = roundf(value * 100.0f);
+  if (scaled < 0.0f) return 0;
+  if (scaled > 65534.0f) return 65534;
+  return (uint16_t)scaled;
+}
+
+float unpackCenti(int16_t value) {
+  return value == INT16_MIN ? NAN : value / 100.0f;
+}
+
+float unpackCentiUnsigned(uint16_t value) {
+  return value == 0xFFFF ? NAN : value / 100.0f;
+}
+
+void putLE16(uint8_t* p, uint16_t v) {
+  p[0] = v & 0xFF;
+  p[1] = v >> 8;
+}
+
+void putLE32(uint8_t* p, uint32_t v) {
+  putLE16(p, v & 0xFFFF);
+  putLE16(p + 2, v >> 16);
+}
+
+uint16_t getLE16(const uint8_t* p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+uint32_t getLE32(const uint8_t* p) {
+  return getLE16(p) | ((uint32_t)getLE16(p + 2) << 16);
+}
+
+size_t encodeLogFrame(const LogRecord& record, uint8_t* out) {
+  out[0] = LOG_FRAME_VERSION;
+  out[1] = record.event;
+  out[2] = record.detail;
+  out[3] = record.zone;
+  putLE32(out + 4, record.sequence);
+  putLE32(out + 8, record.elapsedMs);
+  putLE16(out + 12, (uint16_t)packCenti(record.temperature));
+  putLE16(out + 14, packCentiUnsigned(record.humidity));
+  putLE16(out + 16, (uint16_t)packCenti(record.humidityRate));
+  return LOG_FRAME_SIZE;
+}
+
+bool decodeLogFrame(const uint8_t* in, size_t len, LogRecord& record) {
+  if (len < LOG_FRAME_SIZE || in[0] != LOG_FRAME_VERSION) return false;
+  record.event = in[1];
+  record.detail = in[2];
+  record.zone = in[3];
+  record.sequence = getLE32(in + 4);
+  record.elapsedMs = getLE32(in + 8);
+  record.temperature = unpackCenti((int16_t)getLE16(in + 12));
+  record.humidity = unpackCentiUnsigned(getLE16(in + 14));
+  record.humidityRate = unpackCenti((int16_t)getLE16(in + 16));
+  return true;
+}
+
+size_t formatLogLine(const LogRecord& record, char* buf, size_t size) {
+  uint32_t h = record.elapsedMs / 3600000;
+  uint32_t m = (record.elapsedMs % 3600000) / 60000;
+  uint32_t s = (record.elapsedMs % 60000) / 1000;
+
+  int len;
+  if (record.event == LOG_STATUS) {
+    len = snprintf(buf, size, "%02lu:%02lu:%02lu,STATUS_%s,%.1f,%.1f,%.2f,%u", (unsigned long)h,
+                   (unsigned long)m, (unsigned long)s, processStatusText(record.detail),
+                   record.temperature, record.humidity, record.humidityRate, (unsigned)record.zone);
+  } else {
+    len = snprintf(buf, size, "%02lu:%02lu:%02lu,%s,%.1f,%.1f,%.2f,%u", (unsigned long)h,
+                   (unsigned long)m, (unsigned long)s, logEventName(record.event),
+                   record.temperature, record.humidity, record.humidityRate, (unsigned)record.zone);
+  }
+  if (len < 0 || (size_t)len >= size) return 0;
+  return (size_t)len;
+}
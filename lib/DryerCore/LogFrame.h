@@ -0,0 +1,73 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Log events streamed to the web UI. The numeric values are part of the binary frame
+// format; only append new ones.
+enum LogEvent : uint8_t {
+  LOG_TIMED = 0,
+  LOG_HEAT_ON = 1,
+  LOG_HEAT_OFF = 2,
+  LOG_STALLED = 3,
+  LOG_STATUS = 4, // detail = ProcessStatus
+  LOG_SETPOINT_REACHED = 5,
+  LOG_IDENTIFY_START = 6,
+  LOG_IDENTIFY_DONE = 7,
+  LOG_EVENT_COUNT
+};
+
+// Process status shown on the TFT and web UI. Also part of the binary frame format.
+enum ProcessStatus : uint8_t {
+  STATUS_IDLE = 0,
+  STATUS_IDLE_HEAT_STOPPED = 1,
+  STATUS_IDLE_IDENTIFY_DONE = 2,
+  STATUS_IDLE_IDENTIFY_FAILED = 3,
+  STATUS_DRY_DRYING = 4,
+  STATUS_DRY_MAINTAINING = 5,
+  STATUS_HEAT_HEATING = 6,
+  STATUS_HEAT_WARMING = 7,
+  STATUS_WARM_WARMING = 8,
+  STATUS_IDENTIFY_BASELINE = 9,
+  STATUS_IDENTIFY_STEP = 10,
+  STATUS_COUNT
+};
+
+const char* logEventName(uint8_t event);
+const char* processStatusText(uint8_t status);
+
+struct LogRecord {
+  uint8_t event;      // LogEvent
+  uint8_t detail;     // Event specific (ProcessStatus for LOG_STATUS)
+  uint8_t zone;       // Dryer zone the record is from
+  uint32_t sequence;  // Increments per record, so gaps show dropped frames
+  uint32_t elapsedMs; // Since logging started
+  float temperature;  // C, NAN on sensor error
+  float humidity;     // %RH, NAN on sensor error
+  float humidityRate; // %RH per hour
+};
+
+// Binary frame, little-endian, version 1 (18 bytes):
+//   u8 version, u8 event, u8 detail, u8 zone, u32 sequence, u32 elapsed ms,
+//   i16 temperature (0.01 C), u16 humidity (0.01 %RH), i16 rate (0.01 %RH/h)
+// Missing readings are sent as INT16_MIN / 0xFFFF. The zone byte was reserved (0) before
+// there were several zones, so older frames read as zone 0.
+static const uint8_t LOG_FRAME_VERSION = 1;
+static const size_t LOG_FRAME_SIZE = 18;
+
+// Little-endian fixed-point helpers shared by the binary log formats. Values are
+// stored in hundredths; NAN maps to INT16_MIN / 0xFFFF.
+int16_t packCenti(float value);
+uint16_t packCentiUnsigned(float value);
+float unpackCenti(int16_t value);
+float unpackCentiUnsigned(uint16_t value);
+void putLE16(uint8_t* p, uint16_t v);
+void putLE32(uint8_t* p, uint32_t v);
+uint16_t getLE16(const uint8_t* p);
+uint32_t getLE32(const uint8_t* p);
+
+size_t encodeLogFrame(const LogRecord& record, uint8_t* out);
+bool decodeLogFrame(const uint8_t* in, size_t len, LogRecord& record);
+
+// CSV line as streamed to text clients: HH:MM:SS,EVENT,Temp,Humidity,HumRate,Zone
+size_t formatLogLine(const LogRecord& record, char* buf, size_t size);
@@ -0,0 +1,248 @@
+#include "LogStore.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "Checksum.h"
+
+// Layout: u32 sequence, u32 time, u32 uptime, u8 zone (top 3 bits) and event, u8 detail,
+// i16 temp, u16 humidity, i16 rate, i16 target (all x100), u8 duty (x2), u8 CRC-8 of the
+// first 23 bytes. Records from before zones have zone 0 there.
+size_t encodeStoredLogRecord(const StoredLogRecord& record, uint8_t* out) {
+  putLE32(out, record.sequence);
+  putLE32(out + 4, record.time);
+  putLE32(out + 8, record.uptime);
+  out[12] = (uint8_t)((record.zone << 5) | (record.event & 0x1F));
+  out[13] = record.detail;
+  putLE16(out + 14, (uint16_t)packCenti(record.temperature));
+  putLE16(out + 16, packCentiUnsigned(record.humidity));
+  putLE16(out + 18, (uint16_t)packCenti(record.humidityRate));
+  putLE16(out + 20, (uint16_t)packCenti(record.targetTemp));
+  float duty = record.heaterDuty < 0.0f ? 0.0f : (record.heaterDuty > 100.0f ? 100.0f : record.heaterDuty);
+  out[22] = (uint8_t)lroundf(duty * 2.0f);
+  out[23] = crc8(out, LogStore::RECORD_SIZE - 1);
+  return LogStore::RECORD_SIZE;
+}
+
+bool decodeStoredLogRecord(const uint8_t* in, StoredLogRecord& record) {
+  if (crc8(in, LogStore::RECORD_SIZE - 1) != in[23]) return false;
+  record.sequence = getLE32(in);
+  record.time = getLE32(in + 4);
+  record.uptime = getLE32(in + 8);
+  record.event = in[12] & 0x1F;
+  record.zone = in[12] >> 5;
+  record.detail = in[13];
+  record.temperature = unpackCenti((int16_t)getLE16(in + 14));
+  record.humidity = unpackCentiUnsigned(getLE16(in + 16));
+  record.humidityRate = unpackCenti((int16_t)getLE16(in + 18));
+  record.targetTemp = unpackCenti((int16_t)getLE16(in + 20));
+  record.heaterDuty = in[22] / 2.0f;
+  return true;
+}
+
+static uint32_t segmentOf(uint32_t sequence) {
+  return (sequence / LogStore::SEGMENT_RECORDS) % LogStore::SEGMENT_COUNT;
+}
+
+static uint32_t nextSegmentStart(uint32_t sequence) {
+  return sequence - sequence % LogStore::SEGMENT_RECORDS + LogStore::SEGMENT_RECORDS;
+}
+
+LogStore::LogStore(const char* directory)
+  : directory(directory), batchCount(0), nextSequence(0), flushedEnd(0), writeErrors(0) {}
+
+void LogStore::segmentPath(uint32_t segment, char* buf, size_t size) const {
+  snprintf(buf, size, "%s/log%lu.bin", directory, (unsigned long)segment);
+}
+
+void LogStore::begin() {
+  uint32_t end = 0;
+  for (uint32_t segment = 0; segment < SEGMENT_COUNT; segment++) {
+    char path[48];
+    segmentPath(segment, path, sizeof(path));
+    FILE* f = fopen(path, "rb");
+    if (!f) continue;
+
+    // The last whole record tells how far this segment got
+    fseek(f, 0, SEEK_END);
+    long count = ftell(f) / (long)RECORD_SIZE;
+    uint8_t raw[RECORD_SIZE];
+    StoredLogRecord last;
+    bool valid = count > 0 && fseek(f, (count - 1) * (long)RECORD_SIZE, SEEK_SET) == 0 &&
+                 fread(raw, 1, RECORD_SIZE, f) == RECORD_SIZE && decodeStoredLogRecord(raw, last) &&
+                 segmentOf(last.sequence) == segment &&
+                 last.sequence % SEGMENT_RECORDS == (uint32_t)(count - 1);
+    fclose(f);
+    if (valid && last.sequence + 1 > end) end = last.sequence + 1;
+  }
+  nextSequence = end;
+  flushedEnd.store(end);
+}
+
+void LogStore::append(const StoredLogRecord& record) {
+  batch[batchCount++] = record;
+  if (batchCount == BATCH_RECORDS) flush();
+}
+
+bool LogStore::writeRun(uint32_t& sequence, const StoredLogRecord* records, size_t count) {
+  char path[48];
+  segmentPath(segmentOf(sequence), path, sizeof(path));
+  uint32_t offset = sequence % SEGMENT_RECORDS;
+
+  // A new segment replaces the oldest one; otherwise append where the segment ends.
+  FILE* f = fopen(path, offset == 0 ? "wb" : "ab");
+  if (f && offset != 0) {
+    fseek(f, 0, SEEK_END);
+    if (ftell(f) != (long)(offset * RECORD_SIZE)) {
+      // Torn or missing tail (e.g. power loss mid-write): start the next segment instead
+      fclose(f);
+      sequence = nextSegmentStart(sequence);
+      return writeRun(sequence, records, count);
+    }
+  }
+  if (!f) return false;
+
+  uint8_t raw[BATCH_RECORDS * RECORD_SIZE];
+  for (size_t i = 0; i < count; i++) {
+    StoredLogRecord r = records[i];
+    r.sequence = sequence + i;
+    encodeStoredLogRecord(r, raw + i * RECORD_SIZE);
+  }
+  bool ok = fwrite(raw, 1, count * RECORD_SIZE, f) == count * RECORD_SIZE;
+  ok = (fclose(f) == 0) && ok;
+  return ok;
+}
+
+bool LogStore::flush() {
+  bool ok = true;
+  size_t i = 0;
+  while (i < batchCount) {
+    uint32_t sequence = nextSequence;
+    size_t room = SEGMENT_RECORDS - sequence % SEGMENT_RECORDS;
+    size_t count = batchCount - i < room ? batchCount - i : room;
+    if (!writeRun(sequence, batch + i, count)) {
+      writeErrors++;
+      ok = false;
+      break;
+    }
+    nextSequence = sequence + count;
+    flushedEnd.store(nextSequence);
+    i += count;
+  }
+  batchCount = 0;
+  return ok;
+}
+
+uint32_t LogStore::firstSequence() const {
+  uint32_t end = flushedEnd.load();
+  if (end == 0) return 0;
+  uint32_t lastSegmentStart = (end - 1) - (end - 1) % SEGMENT_RECORDS;
+  uint32_t span = (SEGMENT_COUNT - 1) * SEGMENT_RECORDS;
+  return lastSegmentStart > span ? lastSegmentStart - span : 0;
+}
+
+size_t LogStore::read(uint32_t sequence, StoredLogRecord* out, size_t count) const {
+  uint32_t end = flushedEnd.load();
+  if (sequence >= end || sequence < firstSequence()) return 0;
+  uint32_t offset = sequence % SEGMENT_RECORDS;
+  if (count > end - sequence) count = end - sequence;
+  if (count > SEGMENT_RECORDS - offset) count = SEGMENT_RECORDS - offset;
+
+  char path[48];
+  segmentPath(segmentOf(sequence), path, sizeof(path));
+  FILE* f = fopen(path, "rb");
+  if (!f) return 0;
+  size_t n = 0;
+  if (fseek(f, (long)(offset * RECORD_SIZE), SEEK_SET) == 0) {
+    uint8_t raw[RECORD_SIZE];
+    while (n < count && fread(raw, 1, RECORD_SIZE, f) == RECORD_SIZE) {
+      // A recycled segment may still hold records from the previous lap
+      if (!decodeStoredLogRecord(raw, out[n]) || out[n].sequence != sequence + n) break;
+      n++;
+    }
+  }
+  fclose(f);
+  return n;
+}
+
+LogStoreQuery::LogStoreQuery(const LogStore& store, uint32_t fromSeq, uint32_t toSeq,
+                             uint32_t since, uint32_t until, uint32_t limit)
+  : store(store), since(since), until(until), remaining(limit ? limit : UINT32_MAX),
+    headerSent(false), cacheCount(0), cacheIndex(0), lineLen(0), lineOffset(0) {
+  uint32_t first = store.firstSequence();
+  cursor = fromSeq > first ? fromSeq : first;
+  end = store.endSequence();
+  if (toSeq < end) end = toSeq + 1;
+  if (since) skipToSince();
+}
+
+// Times only move forward, so a segment can be skipped when the next one already
+// starts before `since`. This avoids reading days of records for a recent range.
+void LogStoreQuery::skipToSince() {
+  StoredLogRecord next;
+  while (nextSegmentStart(cursor) < end &&
+         store.read(nextSegmentStart(cursor), &next, 1) == 1 && next.time != 0 && next.time < since) {
+    cursor = nextSegmentStart(cursor);
+  }
+}
+
+bool LogStoreQuery::matches(const StoredLogRecord& record) const {
+  if (!since && !until) return true;
+  if (record.time == 0) return false; // Clock was not set; the time is unknown
+  return record.time >= since && (!until || record.time <= until);
+}
+
+bool LogStoreQuery::nextRecord(StoredLogRecord& record) {
+  while (remaining > 0) {
+    if (cacheIndex < cacheCount) {
+      record = cache[cacheIndex++];
+      if (until && record.time > until) break; // Everything after is later still
+      if (!matches(record)) continue;
+      remaining--;
+      return true;
+    }
+    if (cursor >= end) break;
+    cacheCount = store.read(cursor, cache, CACHE_RECORDS);
+    cacheIndex = 0;
+    if (cacheCount == 0) {
+      cursor = nextSegmentStart(cursor); // Missing or damaged; try the next segment
+    } else {
+      cursor += cacheCount;
+    }
+  }
+  remaining = 0;
+  return false;
+}
+
+size_t LogStoreQuery::fill(char* buf, size_t size) {
+  size_t len = 0;
+  while (len < size) {
+    if (lineOffset < lineLen) {
+      size_t n = lineLen - lineOffset;
+      if (n > size - len) n = size - len;
+      memcpy(buf + len, line + lineOffset, n);
+      len += n;
+      lineOffset += n;
+      continue;
+    }
+
+    int n;
+    StoredLogRecord r;
+    if (!headerSent) {
+      n = snprintf(line, sizeof(line), "Seq,Time,Uptime,Event,Temp,Humidity,HumRate,Target,Duty,Zone\n");
+      headerSent = true;
+    } else if (nextRecord(r)) {
+      n = snprintf(line, sizeof(line), "%lu,%lu,%lu,%s%s%s,%.1f,%.1f,%.2f,%.1f,%.1f,%u\n",
+                   (unsigned long)r.sequence, (unsigned long)r.time, (unsigned long)r.uptime,
+                   logEventName(r.event), r.event == LOG_STATUS ? "_" : "",
+                   r.event == LOG_STATUS ? processStatusText(r.detail) : "",
+                   r.temperature, r.humidity, r.humidityRate, r.targetTemp, r.heaterDuty, (unsigned)r.zone);
+    } else {
+      break;
+    }
+    lineLen = (n > 0 && (size_t)n < sizeof(line)) ? (size_t)n : 0;
+    lineOffset = 0;
+  }
+  return len;
+}
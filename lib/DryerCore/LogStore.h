@@ -0,0 +1,108 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "LogFrame.h"
+
+// One entry of the on-flash log.
+struct StoredLogRecord {
+  uint32_t sequence;  // Assigned by LogStore when the record is flushed
+  uint32_t time;      // Unix time (s), 0 while the clock is not set
+  uint32_t uptime;    // s since boot
+  uint8_t event;      // LogEvent
+  uint8_t detail;     // As in LogRecord
+  uint8_t zone;       // 0-7
+  float temperature;  // C, NAN on sensor error
+  float humidity;     // %RH, NAN on sensor error
+  float humidityRate; // %RH per hour
+  float targetTemp;   // C, 0 while idle
+  float heaterDuty;   // %
+};
+
+// Persistent log kept as a ring of fixed-size segment files (<dir>/log0.bin ...).
+// Records are 24 bytes and are only ever appended; the oldest segment is recreated
+// when the ring wraps, so no flash page is rewritten in place. Appends are buffered
+// in RAM and written in batches by flush().
+//
+// Because every segment holds a fixed number of records, the file and offset of a
+// record follow from its sequence number, and any record can be read on its own.
+//
+// Uses stdio, so it works on the ESP32 VFS mount of SPIFFS (e.g. "/spiffs") and on a
+// host. append()/flush() belong to one task; read() may be called from another.
+class LogStore {
+public:
+  static const size_t RECORD_SIZE = 24;
+  static const uint32_t SEGMENT_RECORDS = 1024;
+  static const uint32_t SEGMENT_COUNT = 8;
+  static const size_t BATCH_RECORDS = 16;
+
+  explicit LogStore(const char* directory);
+
+  // Scans the segments to carry on the sequence from the last boot.
+  void begin();
+
+  // Buffers a record; writes the batch when it is full. The sequence is ignored.
+  void append(const StoredLogRecord& record);
+
+  // Writes buffered records. Returns false if a write failed (the batch is dropped).
+  bool flush();
+
+  size_t pending() const { return batchCount; }
+  uint32_t getWriteErrors() const { return writeErrors; }
+
+  // Sequence range on flash: [firstSequence(), endSequence()).
+  uint32_t firstSequence() const;
+  uint32_t endSequence() const { return flushedEnd.load(); }
+
+  // Reads up to count records starting at sequence, stopping at a segment boundary or
+  // at the first record that is missing or damaged. Returns the number read.
+  size_t read(uint32_t sequence, StoredLogRecord* out, size_t count) const;
+
+private:
+  void segmentPath(uint32_t segment, char* buf, size_t size) const;
+  bool writeRun(uint32_t& sequence, const StoredLogRecord* records, size_t count);
+
+  const char* directory;
+  StoredLogRecord batch[BATCH_RECORDS];
+  size_t batchCount;
+  uint32_t nextSequence;
+  std::atomic<uint32_t> flushedEnd;
+  uint32_t writeErrors;
+};
+
+size_t encodeStoredLogRecord(const StoredLogRecord& record, uint8_t* out);
+bool decodeStoredLogRecord(const uint8_t* in, StoredLogRecord& record);
+
+// Streams the records of a query as CSV in pieces of a caller-given size, so a large
+// range never has to be held in RAM. Records are read from flash 16 at a time.
+class LogStoreQuery {
+public:
+  // Sequence range [fromSeq, toSeq], further limited to records stamped within
+  // [since, until] when since or until is non-zero. At most limit records are returned.
+  LogStoreQuery(const LogStore& store, uint32_t fromSeq, uint32_t toSeq,
+                uint32_t since, uint32_t until, uint32_t limit);
+
+  // Fills buf with CSV text (a line may be split across calls). Returns 0 when the
+  // query is exhausted.
+  size_t fill(char* buf, size_t size);
+
+private:
+  static const size_t CACHE_RECORDS = 16;
+
+  bool nextRecord(StoredLogRecord& record);
+  bool matches(const StoredLogRecord& record) const;
+  void skipToSince();
+
+  const LogStore& store;
+  uint32_t cursor;
+  uint32_t end;
+  uint32_t since, until;
+  uint32_t remaining;
+  bool headerSent;
+  StoredLogRecord cache[CACHE_RECORDS];
+  size_t cacheCount, cacheIndex;
+  char line[128];
+  size_t lineLen, lineOffset;
+};
@@ -0,0 +1,37 @@
+#include "MetricsWriter.h"
+
+#include <math.h>
+#include <stdio.h>
+
+MetricsWriter::MetricsWriter(MetricsWriteFn write, void* ctx) : write(write), ctx(ctx), good(true) {}
+
+void MetricsWriter::line(const char* text, size_t len) {
+  if (write(ctx, text, len) != len) good = false;
+}
+
+void MetricsWriter::family(const char* name, const char* type, const char* help) {
+  char text[224];
+  int n = snprintf(text, sizeof(text), "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+  if (n < 0 || (size_t)n >= sizeof(text)) {
+    good = false;
+    return;
+  }
+  line(text, n);
+}
+
+void MetricsWriter::sample(const char* name, const char* labels, double value) {
+  char number[32];
+  if (isnan(value)) snprintf(number, sizeof(number), "NaN");
+  else if (isinf(value)) snprintf(number, sizeof(number), value > 0 ? "+Inf" : "-Inf");
+  else if (value == floor(value) && fabs(value) < 1e15) snprintf(number, sizeof(number), "%.0f", value);
+  else snprintf(number, sizeof(number), "%.9g", value);
+
+  char text[160];
+  int n = labels ? snprintf(text, sizeof(text), "%s{%s} %s\n", name, labels, number)
+                 : snprintf(text, sizeof(text), "%s %s\n", name, number);
+  if (n < 0 || (size_t)n >= sizeof(text)) {
+    good = false;
+    return;
+  }
+  line(text, n);
+}
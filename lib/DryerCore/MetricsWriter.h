@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef size_t (*MetricsWriteFn)(void* ctx, const char* data, size_t len);
+
+// Writes metrics in the Prometheus text exposition format (version 0.0.4), one line at
+// a time, so the whole page never has to be held in RAM:
+//
+//   # HELP dryer_heater_cycles_total Heater OFF -> ON switches.
+//   # TYPE dryer_heater_cycles_total counter
+//   dryer_heater_cycles_total{zone="0"} 1234
+//
+// Label sets are passed pre-formatted without the braces (zone="0",probe="0x44"); the
+// caller keeps label values free of quotes and backslashes.
+class MetricsWriter {
+public:
+  MetricsWriter(MetricsWriteFn write, void* ctx);
+
+  // HELP and TYPE ("counter", "gauge", "summary") of the samples that follow
+  void family(const char* name, const char* type, const char* help);
+
+  // labels may be nullptr. Whole numbers are written without a fraction, NAN as NaN.
+  void sample(const char* name, const char* labels, double value);
+
+  // Returns false if any write came up short.
+  bool ok() const { return good; }
+
+private:
+  void line(const char* text, size_t len);
+
+  MetricsWriteFn write;
+  void* ctx;
+  bool good;
+};
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <stdint.h>
+
+// Timing of a periodic task so far, in microseconds. Plain data, so it can be handed
+// to other tasks through a Seqlock.
+struct PeriodTiming {
+  uint32_t periodUs;
+  uint32_t periods;      // Periods run
+  uint32_t missed;       // Periods that finished after the next release
+  uint32_t skipped;      // Releases dropped because the task was still running
+  uint32_t lastExecUs;
+  uint32_t meanExecUs;
+  uint32_t maxExecUs;    // Worst-case execution time
+  uint32_t lastJitterUs; // Start of the period, measured from its release
+  uint32_t maxJitterUs;
+};
+
+// Runs and execution time of a piece of work, in microseconds, e.g. one LVGL timer or
+// one zone's probe reads. Plain data, so it can be handed to other tasks through a
+// Seqlock; record() is a handful of adds, cheap enough for every tick.
+struct ExecTiming {
+  uint32_t runs;
+  uint32_t lastUs;
+  uint32_t maxUs;
+  uint64_t totalUs;
+
+  void record(uint32_t us) {
+    runs++;
+    lastUs = us;
+    if (us > maxUs) maxUs = us;
+    totalUs += us;
+  }
+};
+
+// Execution time, release jitter and deadline misses of a task released every
+// `periodUs`, with the deadline at the next release. The caller passes the times in,
+// which keeps it testable on the host.
+class PeriodStats {
+public:
+  explicit PeriodStats(uint32_t periodUs) : execTotalUs(0) {
+    t = {};
+    t.periodUs = periodUs;
+  }
+
+  // Records one period released at releaseUs that ran from startUs to endUs. Returns
+  // how many later releases had already passed by endUs (0 unless it overran); the
+  // caller skips those rather than running them back to back.
+  uint32_t record(int64_t releaseUs, int64_t startUs, int64_t endUs) {
+    uint32_t exec = (uint32_t)(endUs - startUs);
+    int64_t late = startUs - releaseUs;
+    uint32_t jitter = (uint32_t)(late < 0 ? -late : late);
+
+    t.periods++;
+    execTotalUs += exec;
+    t.lastExecUs = exec;
+    t.meanExecUs = (uint32_t)(execTotalUs / t.periods);
+    if (exec > t.maxExecUs) t.maxExecUs = exec;
+    t.lastJitterUs = jitter;
+    if (jitter > t.maxJitterUs) t.maxJitterUs = jitter;
+
+    if (endUs <= releaseUs + t.periodUs) return 0;
+    uint32_t passed = (uint32_t)((endUs - releaseUs - 1) / t.periodUs);
+    t.missed++;
+    t.skipped += passed;
+    return passed;
+  }
+
+  const PeriodTiming& timing() const { return t; }
+
+private:
+  PeriodTiming t;
+  uint64_t execTotalUs;
+};
@@ -0,0 +1,55 @@
+#include "PidController.h"
+
+// Time constant of the low-pass on the derivative term, to keep sensor noise
+// from chattering the output.
+static const float DERIVATIVE_FILTER_S = 10.0f;
+
+static float clampf(float v, float lo, float hi) {
+  return v < lo ? lo : (v > hi ? hi : v);
+}
+
+PidController::PidController(float outMin, float outMax)
+  : gains{0.0f, 0.0f, 0.0f}, outMin(outMin), outMax(outMax) {
+  reset();
+}
+
+void PidController::reset() {
+  integral = 0.0f;
+  lastMeasurement = 0.0f;
+  filteredDerivative = 0.0f;
+  hasLast = false;
+  p = d = out = 0.0f;
+}
+
+void PidController::preload(float integralValue) {
+  integral = clampf(integralValue, outMin, outMax);
+}
+
+float PidController::update(float setpoint, float measurement, float dtSeconds) {
+  float error = setpoint - measurement;
+  p = gains.kp * error;
+
+  // Derivative on measurement, low-pass filtered
+  if (hasLast && dtSeconds > 0.0f) {
+    float rate = (measurement - lastMeasurement) / dtSeconds;
+    float alpha = dtSeconds / (DERIVATIVE_FILTER_S + dtSeconds);
+    filteredDerivative += alpha * (rate - filteredDerivative);
+  } else {
+    filteredDerivative = 0.0f;
+  }
+  lastMeasurement = measurement;
+  hasLast = true;
+  d = -gains.kd * filteredDerivative;
+
+  // Conditional integration: only integrate if it does not drive a saturated output further
+  float step = gains.ki * error * dtSeconds;
+  float unsaturated = p + integral + step + d;
+  bool pushingHigh = unsaturated > outMax && step > 0.0f;
+  bool pushingLow = unsaturated < outMin && step < 0.0f;
+  if (!pushingHigh && !pushingLow) {
+    integral = clampf(integral + step, outMin, outMax);
+  }
+
+  out = clampf(p + integral + d, outMin, outMax);
+  return out;
+}
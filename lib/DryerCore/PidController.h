@@ -0,0 +1,45 @@
+#pragma once
+
+// Positional PID controller for the chamber heater.
+//
+// - Derivative acts on the measurement, not the error, so setpoint changes
+//   (e.g. DRYING -> WARMING) do not kick the output.
+// - The integral is stored already scaled by Ki, so retuning gains live is bumpless.
+// - Anti-windup: the integrator is clamped to the output range and frozen while the
+//   output is saturated in the direction the error is pushing.
+struct PidGains {
+  float kp;
+  float ki; // per second
+  float kd; // seconds
+};
+
+class PidController {
+public:
+  PidController(float outMin = 0.0f, float outMax = 100.0f);
+
+  void setGains(const PidGains& gains) { this->gains = gains; }
+  const PidGains& getGains() const { return gains; }
+
+  // Forget integral and derivative history (e.g. when the process goes IDLE).
+  void reset();
+
+  // Seeds the integral for a bumpless handover (e.g. with a model's steady-state duty).
+  void preload(float integralValue);
+
+  // Advances the controller by dtSeconds and returns the clamped output.
+  float update(float setpoint, float measurement, float dtSeconds);
+
+  float pTerm() const { return p; }
+  float iTerm() const { return integral; }
+  float dTerm() const { return d; }
+  float output() const { return out; }
+
+private:
+  PidGains gains;
+  float outMin, outMax;
+  float integral;
+  float lastMeasurement;
+  float filteredDerivative;
+  bool hasLast;
+  float p, d, out;
+};
@@ -0,0 +1,92 @@
+#include "PredictiveWarmup.h"
+
+PredictiveWarmup::PredictiveWarmup()
+  : phase(PHASE_TRACK), ambient(0.0f), modelTemp(0.0f), delaySlots(1), delayHead(0), slotSeconds(0.0f),
+    slotElapsed(0.0f), seeded(false) {
+  for (size_t i = 0; i < DELAY_SLOTS; i++) delayLine[i] = 0.0f;
+  setModel(FopdtModel{0.0f, 0.0f, 0.0f, 0.0f});
+}
+
+void PredictiveWarmup::setModel(const FopdtModel& model) {
+  this->model = model;
+  // Slots of at least a second, as many as fit the dead time, so the line spans exactly
+  // the dead time; long dead times use all of them with longer slots.
+  delaySlots = model.deadTime >= DELAY_SLOTS ? DELAY_SLOTS : (size_t)model.deadTime;
+  if (delaySlots < 1) delaySlots = 1;
+  slotSeconds = model.deadTime > 0.0f ? model.deadTime / delaySlots : 0.0f;
+  // The old line was laid out for the old dead time
+  for (size_t i = 0; i < delaySlots; i++) delayLine[i] = modelTemp;
+  delayHead = 0;
+  slotElapsed = 0.0f;
+  phase = PHASE_TRACK;
+}
+
+void PredictiveWarmup::begin(float setpoint, float temperature, float ambient) {
+  this->ambient = ambient;
+  if (phase == PHASE_TRACK) {
+    // Re-seed the model on the measurement when starting from a settled state.
+    modelTemp = temperature;
+    for (size_t i = 0; i < delaySlots; i++) delayLine[i] = temperature;
+    delayHead = 0;
+    slotElapsed = 0.0f;
+    seeded = true;
+  }
+
+  if (!hasModel()) {
+    phase = PHASE_TRACK;
+  } else if (setpoint - temperature > STEP_BAND) {
+    phase = PHASE_RAMP_UP;
+  } else if (temperature - setpoint > STEP_BAND) {
+    phase = PHASE_RAMP_DOWN;
+  } else {
+    phase = PHASE_TRACK;
+  }
+}
+
+void PredictiveWarmup::observe(float dtSeconds, float appliedDuty) {
+  if (!hasModel() || !seeded || dtSeconds <= 0.0f) return;
+
+  float target = ambient + model.gain * appliedDuty;
+  float alpha = dtSeconds / (model.timeConstant + dtSeconds);
+  modelTemp += alpha * (target - modelTemp);
+
+  // The delay line holds the model output as it was over the last dead time.
+  if (slotSeconds <= 0.0f) return; // No dead time: nothing is in flight
+  slotElapsed += dtSeconds;
+  while (slotElapsed >= slotSeconds) {
+    slotElapsed -= slotSeconds;
+    delayLine[delayHead] = modelTemp;
+    delayHead = (delayHead + 1) % delaySlots;
+  }
+}
+
+float PredictiveWarmup::predictedTemperature(float temperature) const {
+  if (!hasModel() || !seeded || slotSeconds <= 0.0f) return temperature;
+  // Smith-predictor style: measurement plus the rise the model says is still in flight.
+  return temperature + (modelTemp - delayLine[delayHead]);
+}
+
+float PredictiveWarmup::steadyStateDuty(float setpoint) const {
+  if (!hasModel()) return 0.0f;
+  float duty = (setpoint - ambient) / model.gain;
+  return duty < 0.0f ? 0.0f : (duty > 100.0f ? 100.0f : duty);
+}
+
+bool PredictiveWarmup::update(float setpoint, float temperature, float& duty) {
+  if (phase == PHASE_RAMP_UP) {
+    if (predictedTemperature(temperature) >= setpoint) {
+      phase = PHASE_TRACK;
+    } else {
+      duty = 100.0f;
+      return true;
+    }
+  } else if (phase == PHASE_RAMP_DOWN) {
+    if (predictedTemperature(temperature) <= setpoint) {
+      phase = PHASE_TRACK;
+    } else {
+      duty = 0.0f;
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "ThermalModel.h"
+
+// Model-based setpoint approach for the chamber heater.
+//
+// After a setpoint step it drives the heater flat out (or off) and uses the FOPDT model
+// to predict where the measured temperature will be one dead time from now, given the
+// heat already applied. As soon as that prediction reaches the setpoint it hands over
+// to the PID, preloaded with the model's steady-state duty. The result is a
+// minimum-time approach without the overshoot that the delay would otherwise cause.
+class PredictiveWarmup {
+public:
+  enum Phase { PHASE_TRACK, PHASE_RAMP_UP, PHASE_RAMP_DOWN };
+
+  static const size_t DELAY_SLOTS = 64;
+  static constexpr float STEP_BAND = 2.0f; // C; smaller errors are left to the PID
+
+  PredictiveWarmup();
+
+  // May be called mid-run: the delay line is refilled with the model's current output,
+  // as if nothing were in flight, and the next begin() re-seeds it on the measurement.
+  void setModel(const FopdtModel& model);
+  bool hasModel() const { return model.isValid(); }
+
+  // Starts a new approach towards setpoint from the current temperature.
+  // ambient is the temperature the chamber settles to with the heater off.
+  void begin(float setpoint, float temperature, float ambient);
+
+  // Advances the model by dtSeconds with the duty that was actually applied.
+  // Does nothing until begin() has seeded the model.
+  void observe(float dtSeconds, float appliedDuty);
+
+  // Returns true while the predictor owns the heater; duty is then the output to apply.
+  // Returns false once it has handed over to the PID (see steadyStateDuty()).
+  bool update(float setpoint, float temperature, float& duty);
+
+  // Duty that holds setpoint at equilibrium, according to the model.
+  float steadyStateDuty(float setpoint) const;
+
+  // Measured temperature expected one dead time from now.
+  float predictedTemperature(float temperature) const;
+
+  Phase getPhase() const { return phase; }
+
+private:
+  FopdtModel model;
+  Phase phase;
+  float ambient;
+  float modelTemp;           // Undelayed model output
+  float delayLine[DELAY_SLOTS];
+  size_t delaySlots;         // In use; together they span the dead time
+  size_t delayHead;
+  float slotSeconds;
+  float slotElapsed;
+  bool seeded;               // begin() has set modelTemp and the delay line
+};
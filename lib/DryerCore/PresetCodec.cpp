@@ -0,0 +1,361 @@
+#include "PresetCodec.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void PresetValues::setDefaults() {
+  isDefault = false;
+  dryingTemp = setpointHum = warmTemp = humHyst = stallDelta = 0.0f;
+  stallInterval = heatDur = logInt = 0;
+  heatAction = mode = control = 0;
+  kp = DEFAULT_PID_KP; // Older files have no gains; fall back to defaults
+  ki = DEFAULT_PID_KI;
+  kd = DEFAULT_PID_KD;
+  modelGain = modelTau = modelDeadTime = 0.0f;
+}
+
+size_t utf8Prefix(const char* s, size_t max) {
+  size_t len = strlen(s);
+  if (len <= max) return len;
+  size_t n = max;
+  while (n > 0 && ((unsigned char)s[n] & 0xC0) == 0x80) n--;
+  return n;
+}
+
+// --- Reader ---
+
+PresetReader::PresetReader(PresetReadFn read, void* ctx)
+  : read(read), ctx(ctx), len(0), pos(0), started(false), finished(false), error(false) {}
+
+int PresetReader::peek() {
+  if (pos == len) {
+    len = read(ctx, buf, sizeof(buf));
+    pos = 0;
+    if (len == 0) return -1;
+  }
+  return (unsigned char)buf[pos];
+}
+
+int PresetReader::get() {
+  int c = peek();
+  if (c >= 0) pos++;
+  return c;
+}
+
+void PresetReader::skipSpace() {
+  for (int c = peek(); c == ' ' || c == '\t' || c == '\r' || c == '\n'; c = peek()) pos++;
+}
+
+bool PresetReader::expect(char c) {
+  return get() == c;
+}
+
+static int hexValue(int c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+// Reads a JSON string into out (up to max bytes, NUL-terminated). With out == nullptr
+// the string is only consumed.
+bool PresetReader::readString(char* out, size_t max) {
+  if (!expect('"')) return false;
+  size_t n = 0;
+  bool truncated = false;
+  auto put = [&](uint32_t byte) {
+    if (out && n < max) out[n++] = (char)byte;
+    else truncated = true;
+  };
+  for (;;) {
+    int c = get();
+    if (c < 0) return false;
+    if (c == '"') break;
+    if (c != '\\') {
+      put(c);
+      continue;
+    }
+    c = get();
+    switch (c) {
+      case '"': case '\\': case '/': put(c); break;
+      case 'b': put('\b'); break;
+      case 'f': put('\f'); break;
+      case 'n': put('\n'); break;
+      case 'r': put('\r'); break;
+      case 't': put('\t'); break;
+      case 'u': {
+        uint32_t cp = 0;
+        for (int i = 0; i < 4; i++) {
+          int h = hexValue(get());
+          if (h < 0) return false;
+          cp = (cp << 4) | h;
+        }
+        // A high surrogate followed by a low one is a single code point
+        if (cp >= 0xD800 && cp <= 0xDBFF && peek() == '\\') {
+          get();
+          if (get() != 'u') return false;
+          uint32_t low = 0;
+          for (int i = 0; i < 4; i++) {
+            int h = hexValue(get());
+            if (h < 0) return false;
+            low = (low << 4) | h;
+          }
+          cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+        }
+        if (cp < 0x80) {
+          put(cp);
+        } else if (cp < 0x800) {
+          put(0xC0 | (cp >> 6)); put(0x80 | (cp & 0x3F));
+        } else if (cp < 0x10000) {
+          put(0xE0 | (cp >> 12)); put(0x80 | ((cp >> 6) & 0x3F)); put(0x80 | (cp & 0x3F));
+        } else {
+          put(0xF0 | (cp >> 18)); put(0x80 | ((cp >> 12) & 0x3F)); put(0x80 | ((cp >> 6) & 0x3F)); put(0x80 | (cp & 0x3F));
+        }
+        break;
+      }
+      default: return false;
+    }
+  }
+  if (!out) return true;
+
+  if (truncated && n > 0) {
+    // Do not leave half a UTF-8 sequence at the end
+    size_t lead = n - 1;
+    while (lead > 0 && ((unsigned char)out[lead] & 0xC0) == 0x80) lead--;
+    unsigned char b = (unsigned char)out[lead];
+    size_t seq = b < 0x80 ? 1 : (b >= 0xF0 ? 4 : (b >= 0xE0 ? 3 : 2));
+    if (lead + seq > n) n = lead;
+  }
+  out[n] = '\0';
+  return true;
+}
+
+// Number, true, false or null, as text.
+bool PresetReader::readScalar(char* out, size_t size) {
+  size_t n = 0;
+  for (int c = peek(); c >= 0 && !strchr(",}] \t\r\n", c); c = peek()) {
+    if (n + 1 < size) out[n++] = (char)c;
+    pos++;
+  }
+  out[n] = '\0';
+  return n > 0;
+}
+
+bool PresetReader::skipValue() {
+  int c = peek();
+  if (c == '"') return readString(nullptr, 0);
+  if (c != '{' && c != '[') {
+    char text[32];
+    return readScalar(text, sizeof(text));
+  }
+  int depth = 0;
+  do {
+    skipSpace();
+    c = peek();
+    if (c < 0) return false;
+    if (c == '"') {
+      if (!readString(nullptr, 0)) return false;
+      continue;
+    }
+    pos++;
+    if (c == '{' || c == '[') depth++;
+    else if (c == '}' || c == ']') depth--;
+  } while (depth > 0);
+  return true;
+}
+
+void PresetReader::assign(const char* key, const char* text, PresetValues& v) {
+  if (strcmp(text, "null") == 0) return;
+  bool flag = strcmp(text, "true") == 0;
+  double x = flag ? 1.0 : strtod(text, nullptr);
+  auto wholeMinutes = [](double m) -> uint32_t { return m > 0.0 ? (uint32_t)m * 60000UL : 0; };
+
+  if (strcmp(key, "isDefault") == 0) v.isDefault = x != 0.0;
+  else if (strcmp(key, "dryingTemp") == 0) v.dryingTemp = (float)x;
+  else if (strcmp(key, "setpointHum") == 0) v.setpointHum = (float)x;
+  else if (strcmp(key, "warmTemp") == 0) v.warmTemp = (float)x;
+  else if (strcmp(key, "humHyst") == 0) v.humHyst = (float)x;
+  else if (strcmp(key, "stallInterval") == 0) v.stallInterval = wholeMinutes(x);
+  else if (strcmp(key, "stallDelta") == 0) v.stallDelta = (float)x;
+  else if (strcmp(key, "heatDur") == 0) v.heatDur = x > 0.0 ? (uint32_t)((float)x * 3600000.0f) : 0; // Hours, may be fractional
+  else if (strcmp(key, "heatAction") == 0) v.heatAction = (int)x;
+  else if (strcmp(key, "logInt") == 0) v.logInt = wholeMinutes(x);
+  else if (strcmp(key, "mode") == 0) v.mode = (int)x;
+  else if (strcmp(key, "kp") == 0) v.kp = (float)x;
+  else if (strcmp(key, "ki") == 0) v.ki = (float)x;
+  else if (strcmp(key, "kd") == 0) v.kd = (float)x;
+  else if (strcmp(key, "modelGain") == 0) v.modelGain = (float)x;
+  else if (strcmp(key, "modelTau") == 0) v.modelTau = (float)x;
+  else if (strcmp(key, "modelDeadTime") == 0) v.modelDeadTime = (float)x;
+  else if (strcmp(key, "control") == 0) v.control = (int)x;
+}
+
+bool PresetReader::next(char* name, char* notes, PresetValues& values) {
+  if (finished || error) return false;
+  for (;;) {
+    // Step to the next element of the top-level array
+    skipSpace();
+    if (!started) {
+      if (!expect('[')) break;
+      started = true;
+      skipSpace();
+      if (peek() == ']') {
+        finished = true;
+        return false;
+      }
+    } else {
+      int c = get();
+      if (c == ']') {
+        finished = true;
+        return false;
+      }
+      if (c != ',') break;
+      skipSpace();
+    }
+    if (peek() != '{') {
+      if (!skipValue()) break;
+      continue;
+    }
+
+    // One preset object
+    get();
+    name[0] = notes[0] = '\0';
+    values.setDefaults();
+    bool metadata = false;
+    skipSpace();
+    if (peek() == '}') {
+      get();
+      continue;
+    }
+    for (;;) {
+      char key[24];
+      skipSpace();
+      if (!readString(key, sizeof(key) - 1)) goto fail;
+      skipSpace();
+      if (!expect(':')) goto fail;
+      skipSpace();
+      int c = peek();
+      if (c == '{' || c == '[') {
+        if (!skipValue()) goto fail;
+      } else if (c == '"') {
+        // Only name and notes are strings; any other key keeps its default
+        bool ok;
+        if (strcmp(key, "name") == 0) ok = readString(name, PRESET_NAME_MAX);
+        else if (strcmp(key, "notes") == 0) ok = readString(notes, PRESET_NOTES_MAX);
+        else ok = readString(nullptr, 0);
+        if (!ok) goto fail;
+        if (strcmp(key, "_metadata") == 0) metadata = true;
+      } else {
+        char text[32];
+        if (!readScalar(text, sizeof(text))) goto fail;
+        assign(key, text, values);
+      }
+      skipSpace();
+      c = get();
+      if (c == '}') break;
+      if (c != ',') goto fail;
+    }
+    if (!metadata) return true; // The metadata block only documents the fields
+  }
+fail:
+  error = true;
+  return false;
+}
+
+// --- Writer ---
+
+PresetWriter::PresetWriter(PresetWriteFn write, void* ctx)
+  : write(write), ctx(ctx), first(true), firstField(true), ok(true) {}
+
+void PresetWriter::raw(const char* s) {
+  size_t n = strlen(s);
+  if (write(ctx, s, n) != n) ok = false;
+}
+
+void PresetWriter::string(const char* s) {
+  char out[64];
+  size_t n = 0;
+  out[n++] = '"';
+  for (; *s; s++) {
+    if (n > sizeof(out) - 8) {
+      if (write(ctx, out, n) != n) ok = false;
+      n = 0;
+    }
+    unsigned char c = (unsigned char)*s;
+    switch (c) {
+      case '"': out[n++] = '\\'; out[n++] = '"'; break;
+      case '\\': out[n++] = '\\'; out[n++] = '\\'; break;
+      case '\n': out[n++] = '\\'; out[n++] = 'n'; break;
+      case '\r': out[n++] = '\\'; out[n++] = 'r'; break;
+      case '\t': out[n++] = '\\'; out[n++] = 't'; break;
+      case '\b': out[n++] = '\\'; out[n++] = 'b'; break;
+      case '\f': out[n++] = '\\'; out[n++] = 'f'; break;
+      default:
+        if (c < 0x20) n += snprintf(out + n, sizeof(out) - n, "\\u%04x", c);
+        else out[n++] = (char)c;
+    }
+  }
+  out[n++] = '"';
+  if (write(ctx, out, n) != n) ok = false;
+}
+
+void PresetWriter::key(const char* k) {
+  raw(firstField ? "\"" : ",\"");
+  raw(k);
+  raw("\":");
+  firstField = false;
+}
+
+void PresetWriter::number(const char* k, double v) {
+  char text[24];
+  snprintf(text, sizeof(text), "%.7g", v);
+  key(k);
+  raw(text);
+}
+
+void PresetWriter::beginArray() {
+  raw("[");
+}
+
+void PresetWriter::writePreset(const char* name, const char* notes, const PresetValues& v) {
+  raw(first ? "{" : ",{");
+  first = false;
+  firstField = true;
+  key("name"); string(name);
+  key("notes"); string(notes);
+  key("isDefault"); raw(v.isDefault ? "true" : "false");
+  number("dryingTemp", v.dryingTemp);
+  number("setpointHum", v.setpointHum);
+  number("warmTemp", v.warmTemp);
+  number("humHyst", v.humHyst);
+  number("stallInterval", (float)v.stallInterval / 60000.0f); // ms to minutes
+  number("stallDelta", v.stallDelta);
+  number("heatDur", (float)v.heatDur / 3600000.0f);           // ms to hours
+  number("heatAction", v.heatAction);
+  number("logInt", (float)v.logInt / 60000.0f);               // ms to minutes
+  number("mode", v.mode);
+  number("kp", v.kp);
+  number("ki", v.ki);
+  number("kd", v.kd);
+  number("modelGain", v.modelGain);
+  number("modelTau", v.modelTau);
+  number("modelDeadTime", v.modelDeadTime);
+  number("control", v.control);
+  raw("}");
+}
+
+void PresetWriter::writeSummary(const char* name, const char* notes, bool isDefault) {
+  raw(first ? "{" : ",{");
+  first = false;
+  firstField = true;
+  key("name"); string(name);
+  key("isDefault"); raw(isDefault ? "true" : "false");
+  key("notes"); string(notes);
+  raw("}");
+}
+
+bool PresetWriter::endArray() {
+  raw("]");
+  return ok;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Default PID gains, used for presets that do not define their own
+static const float DEFAULT_PID_KP = 8.0f;  // % duty per C of error
+static const float DEFAULT_PID_KI = 0.02f; // % duty per C*s of accumulated error
+static const float DEFAULT_PID_KD = 60.0f; // % duty per C/s of temperature rise
+
+// Longest name and notes kept (bytes, without the terminator). Longer text is cut at a
+// UTF-8 character boundary.
+static const size_t PRESET_NAME_MAX = 47;
+static const size_t PRESET_NOTES_MAX = 255;
+
+// Length of the longest prefix of s that fits in max bytes without splitting a UTF-8
+// character.
+size_t utf8Prefix(const char* s, size_t max);
+
+// The settings of one preset, in controller units (ms, not the minutes/hours of the file).
+struct PresetValues {
+  bool isDefault;
+  float dryingTemp;
+  float setpointHum;
+  float warmTemp;
+  float humHyst;
+  uint32_t stallInterval; // ms
+  float stallDelta;
+  uint32_t heatDur;       // ms
+  int heatAction;
+  uint32_t logInt;        // ms
+  int mode;               // 0=Dry, 1=Heat, 2=Warm, 3=Identify
+  float kp, ki, kd;
+  float modelGain;        // C per % heater duty, 0 = not identified
+  float modelTau;         // s
+  float modelDeadTime;    // s
+  int control;            // 0=PID, 1=Predictive
+
+  // What a field missing from the file reads as
+  void setDefaults();
+};
+
+typedef size_t (*PresetReadFn)(void* ctx, char* buf, size_t len);
+typedef size_t (*PresetWriteFn)(void* ctx, const char* data, size_t len);
+
+// Pull parser for presets.json: a top-level array of flat objects. Presets are
+// returned one at a time and nothing is allocated, so memory does not grow with the
+// number of presets. Objects holding a "_metadata" key and unknown keys are skipped.
+class PresetReader {
+public:
+  PresetReader(PresetReadFn read, void* ctx);
+
+  // Reads the next preset. Returns false at the end of the array or on a syntax error
+  // (see failed()).
+  bool next(char* name, char* notes, PresetValues& values);
+
+  bool failed() const { return error; }
+
+private:
+  int peek();
+  int get();
+  void skipSpace();
+  bool expect(char c);
+  bool readString(char* out, size_t max);
+  bool readScalar(char* out, size_t size);
+  bool skipValue();
+  void assign(const char* key, const char* text, PresetValues& v);
+
+  PresetReadFn read;
+  void* ctx;
+  char buf[128];
+  size_t len, pos;
+  bool started, finished, error;
+};
+
+// Writes presets.json (and the /presets/list summary) as the presets are visited.
+class PresetWriter {
+public:
+  PresetWriter(PresetWriteFn write, void* ctx);
+
+  void beginArray();
+  void writePreset(const char* name, const char* notes, const PresetValues& values);
+  // {"name","isDefault","notes"} only, for the preset list
+  void writeSummary(const char* name, const char* notes, bool isDefault);
+  // Returns false if any write came up short.
+  bool endArray();
+
+private:
+  void raw(const char* s);
+  void string(const char* s);
+  void key(const char* k);
+  void number(const char* k, double v);
+
+  PresetWriteFn write;
+  void* ctx;
+  bool first, firstField, ok;
+};
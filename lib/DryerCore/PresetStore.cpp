@@ -0,0 +1,370 @@
+#include "PresetStore.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "LogFrame.h"
+#include "PresetCodec.h"
+
+static const uint32_t JOURNAL_MAGIC = 0x314A5250; // "PRJ1"
+static const size_t HEADER_SIZE = 16;             // magic, snapshot size, snapshot CRC, header CRC
+static const size_t VALUES_SIZE = 60;
+// Type, length, name, notes, values, CRC
+static const size_t RECORD_MAX = 3 + (PRESET_NAME_MAX + 1) + (PRESET_NOTES_MAX + 1) + VALUES_SIZE + 4;
+
+enum JournalRecord : uint8_t {
+  RECORD_PUT = 1,     // name, notes, values
+  RECORD_REMOVE = 2,  // name
+  RECORD_RENAME = 3,  // old name, new name
+  RECORD_DEFAULT = 4, // name
+};
+
+// CRC-32 (IEEE 802.3), fed in pieces: start with CRC32_INIT, finish with ~crc
+static const uint32_t CRC32_INIT = 0xFFFFFFFFu;
+
+static uint32_t crc32Update(uint32_t crc, const uint8_t* data, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    crc ^= data[i];
+    for (int b = 0; b < 8; b++) crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1)));
+  }
+  return crc;
+}
+
+static uint32_t crc32(const uint8_t* data, size_t len) {
+  return ~crc32Update(CRC32_INIT, data, len);
+}
+
+static void putFloat(uint8_t* p, float v) {
+  uint32_t bits;
+  memcpy(&bits, &v, sizeof(bits));
+  putLE32(p, bits);
+}
+
+static float getFloat(const uint8_t* p) {
+  uint32_t bits = getLE32(p);
+  float v;
+  memcpy(&v, &bits, sizeof(v));
+  return v;
+}
+
+// Layout: u8 isDefault, mode, heatAction, control; f32 dryingTemp, setpointHum, warmTemp,
+// humHyst, stallDelta, kp, ki, kd, modelGain, modelTau, modelDeadTime; u32 stallInterval,
+// heatDur, logInt
+static void encodeValues(const PresetValues& v, uint8_t* out) {
+  out[0] = v.isDefault ? 1 : 0;
+  out[1] = (uint8_t)v.mode;
+  out[2] = (uint8_t)v.heatAction;
+  out[3] = (uint8_t)v.control;
+  const float floats[11] = { v.dryingTemp, v.setpointHum, v.warmTemp, v.humHyst, v.stallDelta,
+                             v.kp, v.ki, v.kd, v.modelGain, v.modelTau, v.modelDeadTime };
+  for (int i = 0; i < 11; i++) putFloat(out + 4 + i * 4, floats[i]);
+  putLE32(out + 48, v.stallInterval);
+  putLE32(out + 52, v.heatDur);
+  putLE32(out + 56, v.logInt);
+}
+
+static void decodeValues(const uint8_t* in, PresetValues& v) {
+  v.isDefault = in[0] != 0;
+  v.mode = in[1];
+  v.heatAction = in[2];
+  v.control = in[3];
+  float* floats[11] = { &v.dryingTemp, &v.setpointHum, &v.warmTemp, &v.humHyst, &v.stallDelta,
+                        &v.kp, &v.ki, &v.kd, &v.modelGain, &v.modelTau, &v.modelDeadTime };
+  for (int i = 0; i < 11; i++) *floats[i] = getFloat(in + 4 + i * 4);
+  v.stallInterval = getLE32(in + 48);
+  v.heatDur = getLE32(in + 52);
+  v.logInt = getLE32(in + 56);
+}
+
+// Takes the next NUL-terminated string of at most max bytes off a payload
+static const char* takeString(const uint8_t*& p, const uint8_t* end, size_t max) {
+  const uint8_t* nul = (const uint8_t*)memchr(p, 0, end - p);
+  if (!nul || (size_t)(nul - p) > max) return nullptr;
+  const char* s = (const char*)p;
+  p = nul + 1;
+  return s;
+}
+
+static size_t putString(uint8_t* out, const char* s, size_t max) {
+  size_t n = strlen(s);
+  if (n > max) n = max;
+  memcpy(out, s, n);
+  out[n] = 0;
+  return n + 1;
+}
+
+// Applies one journal record to the table. Returns false if the payload is malformed.
+static bool applyRecord(PresetTable& table, uint8_t type, const uint8_t* p, size_t len) {
+  const uint8_t* end = p + len;
+  switch (type) {
+    case RECORD_PUT: {
+      const char* name = takeString(p, end, PRESET_NAME_MAX);
+      const char* notes = name ? takeString(p, end, PRESET_NOTES_MAX) : nullptr;
+      if (!notes || (size_t)(end - p) != VALUES_SIZE) return false;
+      PresetValues v;
+      decodeValues(p, v);
+      table.put(name, notes, v);
+      return true;
+    }
+    case RECORD_REMOVE: {
+      const char* name = takeString(p, end, PRESET_NAME_MAX);
+      if (!name) return false;
+      int i = table.find(name);
+      if (i >= 0) table.remove(i);
+      return true;
+    }
+    case RECORD_RENAME: {
+      const char* oldName = takeString(p, end, PRESET_NAME_MAX);
+      const char* newName = oldName ? takeString(p, end, PRESET_NAME_MAX) : nullptr;
+      if (!newName) return false;
+      int i = table.find(oldName);
+      if (i >= 0) table.rename(i, newName);
+      return true;
+    }
+    case RECORD_DEFAULT: {
+      const char* name = takeString(p, end, PRESET_NAME_MAX);
+      if (!name) return false;
+      table.setDefault(table.find(name));
+      return true;
+    }
+  }
+  return false;
+}
+
+// File access for PresetReader/PresetWriter that keeps a CRC-32 and size of the bytes
+// passing through
+struct CheckedFile {
+  FILE* f;
+  uint32_t crc;
+  uint32_t size;
+};
+
+static size_t checkedRead(void* ctx, char* buf, size_t len) {
+  CheckedFile* c = (CheckedFile*)ctx;
+  size_t n = fread(buf, 1, len, c->f);
+  c->crc = crc32Update(c->crc, (const uint8_t*)buf, n);
+  c->size += n;
+  return n;
+}
+
+static size_t checkedWrite(void* ctx, const char* data, size_t len) {
+  CheckedFile* c = (CheckedFile*)ctx;
+  size_t n = fwrite(data, 1, len, c->f);
+  c->crc = crc32Update(c->crc, (const uint8_t*)data, n);
+  c->size += n;
+  return n;
+}
+
+PresetStore::PresetStore(PresetTable& table, const char* directory)
+  : table(table), directory(directory), snapshotSize(0), snapshotCrc(0), journalSize(0),
+    replayed(0), damaged(false), writeErrors(0) {}
+
+void PresetStore::path(const char* file, char* buf, size_t size) const {
+  snprintf(buf, size, "%s/%s", directory, file);
+}
+
+// Reads a snapshot into the (cleared) table. Returns false if the file is missing or
+// empty.
+bool PresetStore::readSnapshot(const char* file) {
+  char name[48];
+  path(file, name, sizeof(name));
+  table.clear();
+  damaged = false;
+  snapshotSize = 0;
+  snapshotCrc = 0;
+  FILE* f = fopen(name, "rb");
+  if (!f) return false;
+
+  CheckedFile in = { f, CRC32_INIT, 0 };
+  PresetReader reader(checkedRead, &in);
+  char presetName[PRESET_NAME_MAX + 1];
+  char notes[PRESET_NOTES_MAX + 1];
+  PresetValues values;
+  while (reader.next(presetName, notes, values)) {
+    // A repeated name replaces the earlier preset
+    if (table.put(presetName, notes, values) < 0) {
+      damaged = true; // Out of memory; the rest is not loaded
+      break;
+    }
+  }
+  damaged = damaged || reader.failed();
+
+  // The CRC covers the whole file, including anything after the array
+  char rest[64];
+  while (checkedRead(&in, rest, sizeof(rest)) > 0) {}
+  fclose(f);
+  snapshotSize = in.size;
+  snapshotCrc = ~in.crc;
+  return in.size > 0;
+}
+
+bool PresetStore::load() {
+  char tmp[48];
+  path("presets.tmp", tmp, sizeof(tmp));
+  replayed = 0;
+  journalSize = 0;
+
+  bool found = readSnapshot("presets.json");
+  if (found) {
+    remove(tmp); // Left by a compaction that did not finish; presets.json is current
+  } else if (readSnapshot("presets.tmp") && !damaged) {
+    // Power failed between removing presets.json and renaming its replacement
+    char json[48];
+    path("presets.json", json, sizeof(json));
+    rename(tmp, json);
+    found = true;
+  } else {
+    remove(tmp);
+    table.clear();
+    damaged = false;
+    snapshotSize = 0;
+    snapshotCrc = 0;
+  }
+
+  replayJournal();
+  return found;
+}
+
+void PresetStore::replayJournal() {
+  char name[48];
+  path("presets.jnl", name, sizeof(name));
+  FILE* f = fopen(name, "rb");
+  if (!f) return;
+
+  uint8_t header[HEADER_SIZE];
+  bool current = fread(header, 1, HEADER_SIZE, f) == HEADER_SIZE &&
+                 getLE32(header) == JOURNAL_MAGIC &&
+                 getLE32(header + 12) == crc32(header, 12) &&
+                 getLE32(header + 4) == snapshotSize && getLE32(header + 8) == snapshotCrc;
+  if (!current) {
+    // Torn header, or already folded into this snapshot
+    fclose(f);
+    remove(name);
+    return;
+  }
+
+  // The journal never grows much past JOURNAL_LIMIT, so neither does this loop
+  size_t offset = HEADER_SIZE;
+  bool torn = false;
+  uint8_t record[RECORD_MAX];
+  while (offset < JOURNAL_LIMIT + RECORD_MAX) {
+    size_t n = fread(record, 1, 3, f);
+    if (n == 0) break;
+    size_t len = getLE16(record + 1);
+    if (n < 3 || 3 + len + 4 > RECORD_MAX || fread(record + 3, 1, len + 4, f) != len + 4 ||
+        getLE32(record + 3 + len) != crc32(record, 3 + len) ||
+        !applyRecord(table, record[0], record + 3, len)) {
+      torn = true;
+      break;
+    }
+    offset += 3 + len + 4;
+    replayed++;
+  }
+  fclose(f);
+  journalSize = offset;
+
+  // New records must not follow a damaged one
+  if (torn) compact();
+}
+
+bool PresetStore::append(uint8_t type, const uint8_t* payload, size_t len) {
+  char name[48];
+  path("presets.jnl", name, sizeof(name));
+  uint8_t record[RECORD_MAX];
+  record[0] = type;
+  putLE16(record + 1, (uint16_t)len);
+  memcpy(record + 3, payload, len);
+  putLE32(record + 3 + len, crc32(record, 3 + len));
+  size_t size = 3 + len + 4;
+
+  FILE* f = fopen(name, journalSize == 0 ? "wb" : "ab");
+  bool ok = f != nullptr;
+  if (ok && journalSize == 0) {
+    uint8_t header[HEADER_SIZE];
+    putLE32(header, JOURNAL_MAGIC);
+    putLE32(header + 4, snapshotSize);
+    putLE32(header + 8, snapshotCrc);
+    putLE32(header + 12, crc32(header, 12));
+    ok = fwrite(header, 1, HEADER_SIZE, f) == HEADER_SIZE;
+    journalSize = HEADER_SIZE;
+  } else if (ok) {
+    fseek(f, 0, SEEK_END);
+    ok = ftell(f) == (long)journalSize;
+  }
+  ok = ok && fwrite(record, 1, size, f) == size;
+  if (f) ok = (fclose(f) == 0) && ok;
+
+  if (!ok) {
+    // The journal may now end in a partial record; the table is still right, so write
+    // it out whole instead
+    writeErrors++;
+    return compact();
+  }
+  journalSize += size;
+  if (journalSize > JOURNAL_LIMIT) return compact();
+  return true;
+}
+
+bool PresetStore::savePreset(size_t i) {
+  uint8_t payload[RECORD_MAX];
+  size_t len = putString(payload, table.name(i), PRESET_NAME_MAX);
+  len += putString(payload + len, table.notes(i), PRESET_NOTES_MAX);
+  encodeValues(table.values(i), payload + len);
+  return append(RECORD_PUT, payload, len + VALUES_SIZE);
+}
+
+bool PresetStore::saveRemove(const char* name) {
+  uint8_t payload[PRESET_NAME_MAX + 1];
+  return append(RECORD_REMOVE, payload, putString(payload, name, PRESET_NAME_MAX));
+}
+
+bool PresetStore::saveRename(const char* oldName, const char* newName) {
+  uint8_t payload[2 * (PRESET_NAME_MAX + 1)];
+  size_t len = putString(payload, oldName, PRESET_NAME_MAX);
+  len += putString(payload + len, newName, PRESET_NAME_MAX);
+  return append(RECORD_RENAME, payload, len);
+}
+
+bool PresetStore::saveDefault(const char* name) {
+  uint8_t payload[PRESET_NAME_MAX + 1];
+  return append(RECORD_DEFAULT, payload, putString(payload, name, PRESET_NAME_MAX));
+}
+
+bool PresetStore::compact() {
+  char tmp[48], json[48], journal[48];
+  path("presets.tmp", tmp, sizeof(tmp));
+  path("presets.json", json, sizeof(json));
+  path("presets.jnl", journal, sizeof(journal));
+
+  FILE* f = fopen(tmp, "wb");
+  if (!f) {
+    writeErrors++;
+    return false;
+  }
+  CheckedFile out = { f, CRC32_INIT, 0 };
+  PresetWriter writer(checkedWrite, &out);
+  writer.beginArray();
+  for (size_t i = 0; i < table.size(); i++) {
+    writer.writePreset(table.name(i), table.notes(i), table.values(i));
+  }
+  bool ok = writer.endArray();
+  ok = (fclose(f) == 0) && ok;
+  if (!ok) {
+    remove(tmp);
+    writeErrors++;
+    return false;
+  }
+
+  // SPIFFS cannot rename onto an existing file. presets.tmp is complete by now, and
+  // load() falls back to it while presets.json is missing.
+  remove(json);
+  bool renamed = rename(tmp, json) == 0;
+  if (!renamed) writeErrors++; // presets.tmp stands in until the next compaction
+  snapshotSize = out.size;
+  snapshotCrc = ~out.crc;
+
+  // A journal left behind by a power cut here names the old snapshot and is dropped
+  remove(journal);
+  journalSize = 0;
+  return renamed;
+}
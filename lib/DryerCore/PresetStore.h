@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "PresetTable.h"
+
+// Keeps a PresetTable on flash without rewriting the whole file for every edit.
+//
+//   <dir>/presets.json  snapshot, in the format users edit and download
+//   <dir>/presets.jnl   changes made since the snapshot, appended one record at a time
+//   <dir>/presets.tmp   the next snapshot while it is being written
+//
+// An edit appends one small record to the journal. Once the journal grows past
+// JOURNAL_LIMIT, the table is written to presets.tmp, which then replaces
+// presets.json, and the journal starts over. The journal header names the snapshot it
+// applies to (size and CRC-32), so a journal that was already folded into a newer
+// snapshot is recognised and dropped.
+//
+// Power can fail at any byte:
+//   - a record cut short is detected by its length and CRC; replay stops there and the
+//     store is compacted, so new records never follow a damaged one;
+//   - presets.tmp is only promoted if it parses to the end, and presets.json is only
+//     removed once presets.tmp is complete (SPIFFS cannot rename over a file).
+//
+// Uses stdio, so it works on the ESP32 VFS mount of SPIFFS (e.g. "/spiffs") and on a
+// host.
+class PresetStore {
+public:
+  static const size_t JOURNAL_LIMIT = 8192; // Bytes; bounds replay at startup
+
+  PresetStore(PresetTable& table, const char* directory);
+
+  // Fills the table from the snapshot and journal. Returns false if there was no
+  // snapshot to read (the table is then empty).
+  bool load();
+
+  // Whether load() stopped at a syntax error in presets.json (the presets read before
+  // it are kept)
+  bool snapshotDamaged() const { return damaged; }
+  size_t replayedRecords() const { return replayed; }
+
+  // Record a change already made to the table. Return false if the write failed.
+  bool savePreset(size_t i);                            // Added or changed
+  bool saveRemove(const char* name);
+  bool saveRename(const char* oldName, const char* newName);
+  bool saveDefault(const char* name);                   // "" = no default
+
+  // Writes the table as a new snapshot and empties the journal.
+  bool compact();
+
+  size_t journalBytes() const { return journalSize; }
+  uint32_t getWriteErrors() const { return writeErrors; }
+
+private:
+  void path(const char* file, char* buf, size_t size) const;
+  bool readSnapshot(const char* file);
+  void replayJournal();
+  bool append(uint8_t type, const uint8_t* payload, size_t len);
+
+  PresetTable& table;
+  const char* directory;
+  uint32_t snapshotSize, snapshotCrc; // Of presets.json as last read or written
+  size_t journalSize;                 // 0 = no journal file
+  size_t replayed;
+  bool damaged;
+  uint32_t writeErrors;
+};
@@ -0,0 +1,210 @@
+#include "PresetTable.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "Checksum.h"
+
+// Arena offsets are 16 bits
+static const size_t ARENA_LIMIT = 65535;
+
+PresetTable::PresetTable()
+  : block(nullptr), blockSize(0), entries(nullptr), slots(nullptr), arena(nullptr),
+    count(0), entryCapacity(0), slotCount(0), arenaUsed(0), arenaCapacity(0) {}
+
+PresetTable::~PresetTable() {
+  free(block);
+}
+
+// Makes room for `entriesNeeded` entries and `extraBytes` more arena bytes. When the
+// block is replaced, only the strings still referenced are copied over.
+bool PresetTable::reserve(size_t entriesNeeded, size_t extraBytes) {
+  if (entriesNeeded <= entryCapacity && arenaUsed + extraBytes <= arenaCapacity) return true;
+
+  size_t live = 0;
+  for (size_t i = 0; i < count; i++) {
+    live += strlen(arena + entries[i].name) + 1 + strlen(arena + entries[i].notes) + 1;
+  }
+  size_t newEntries = entryCapacity < 4 ? 4 : entryCapacity;
+  while (newEntries < entriesNeeded) newEntries *= 2;
+  size_t newArena = live + extraBytes;
+  newArena += newArena / 2 + 64; // Headroom for the next few edits
+  if (newArena > ARENA_LIMIT) newArena = ARENA_LIMIT;
+  if (live + extraBytes > newArena) return false;
+  size_t newSlots = 8;
+  while (newSlots < newEntries * 2) newSlots *= 2; // Load factor <= 0.5
+
+  size_t size = newEntries * sizeof(Entry) + newSlots * sizeof(uint16_t) + newArena;
+  uint8_t* newBlock = (uint8_t*)malloc(size);
+  if (!newBlock) return false;
+
+  Entry* newEntriesPtr = (Entry*)newBlock;
+  uint16_t* newSlotsPtr = (uint16_t*)(newBlock + newEntries * sizeof(Entry));
+  char* newArenaPtr = (char*)(newSlotsPtr + newSlots);
+  size_t used = 0;
+  for (size_t i = 0; i < count; i++) {
+    Entry e = entries[i];
+    const char* strings[2] = { arena + e.name, arena + e.notes };
+    uint16_t* offsets[2] = { &e.name, &e.notes };
+    for (int k = 0; k < 2; k++) {
+      size_t n = strlen(strings[k]) + 1;
+      memcpy(newArenaPtr + used, strings[k], n);
+      *offsets[k] = (uint16_t)used;
+      used += n;
+    }
+    newEntriesPtr[i] = e;
+  }
+
+  free(block);
+  block = newBlock;
+  blockSize = size;
+  entries = newEntriesPtr;
+  slots = newSlotsPtr;
+  arena = newArenaPtr;
+  entryCapacity = newEntries;
+  slotCount = newSlots;
+  arenaCapacity = newArena;
+  arenaUsed = used;
+  rebuildIndex();
+  return true;
+}
+
+bool PresetTable::appendString(const char* s, uint16_t& offset) {
+  size_t n = strlen(s) + 1;
+  if (arenaUsed + n > arenaCapacity) return false;
+  memcpy(arena + arenaUsed, s, n);
+  offset = (uint16_t)arenaUsed;
+  arenaUsed += n;
+  return true;
+}
+
+void PresetTable::insertIndex(size_t i) {
+  size_t p = fnv1a(arena + entries[i].name) & (slotCount - 1);
+  while (slots[p] != 0) p = (p + 1) & (slotCount - 1);
+  slots[p] = (uint16_t)(i + 1);
+}
+
+void PresetTable::rebuildIndex() {
+  if (slotCount == 0) return;
+  memset(slots, 0, slotCount * sizeof(uint16_t));
+  for (size_t i = 0; i < count; i++) insertIndex(i);
+}
+
+int PresetTable::find(const char* name) const {
+  if (slotCount == 0) return -1;
+  for (size_t p = fnv1a(name) & (slotCount - 1); slots[p] != 0; p = (p + 1) & (slotCount - 1)) {
+    size_t i = slots[p] - 1;
+    if (strcmp(arena + entries[i].name, name) == 0) return (int)i;
+  }
+  return -1;
+}
+
+const char* PresetTable::name(size_t i) const {
+  return arena + entries[i].name;
+}
+
+const char* PresetTable::notes(size_t i) const {
+  return arena + entries[i].notes;
+}
+
+bool PresetTable::isDefault(size_t i) const {
+  return entries[i].isDefault != 0;
+}
+
+PresetValues PresetTable::values(size_t i) const {
+  const Entry& e = entries[i];
+  PresetValues v;
+  v.isDefault = e.isDefault != 0;
+  v.dryingTemp = e.dryingTemp;
+  v.setpointHum = e.setpointHum;
+  v.warmTemp = e.warmTemp;
+  v.humHyst = e.humHyst;
+  v.stallInterval = e.stallInterval;
+  v.stallDelta = e.stallDelta;
+  v.heatDur = e.heatDur;
+  v.heatAction = e.heatAction;
+  v.logInt = e.logInt;
+  v.mode = e.mode;
+  v.kp = e.kp;
+  v.ki = e.ki;
+  v.kd = e.kd;
+  v.modelGain = e.modelGain;
+  v.modelTau = e.modelTau;
+  v.modelDeadTime = e.modelDeadTime;
+  v.control = e.control;
+  return v;
+}
+
+void PresetTable::store(Entry& e, const PresetValues& v) {
+  e.isDefault = v.isDefault ? 1 : 0;
+  e.dryingTemp = v.dryingTemp;
+  e.setpointHum = v.setpointHum;
+  e.warmTemp = v.warmTemp;
+  e.humHyst = v.humHyst;
+  e.stallInterval = v.stallInterval;
+  e.stallDelta = v.stallDelta;
+  e.heatDur = v.heatDur;
+  e.heatAction = (uint8_t)v.heatAction;
+  e.logInt = v.logInt;
+  e.mode = (uint8_t)v.mode;
+  e.kp = v.kp;
+  e.ki = v.ki;
+  e.kd = v.kd;
+  e.modelGain = v.modelGain;
+  e.modelTau = v.modelTau;
+  e.modelDeadTime = v.modelDeadTime;
+  e.control = (uint8_t)v.control;
+}
+
+int PresetTable::put(const char* name, const char* notes, const PresetValues& values) {
+  int i = find(name);
+  if (i >= 0) {
+    if (strcmp(this->notes(i), notes) != 0) {
+      if (!reserve(count, strlen(notes) + 1)) return -1;
+      appendString(notes, entries[i].notes);
+    }
+    store(entries[i], values);
+    return i;
+  }
+
+  if (!reserve(count + 1, strlen(name) + 1 + strlen(notes) + 1)) return -1;
+  Entry& e = entries[count];
+  appendString(name, e.name);
+  appendString(notes, e.notes);
+  store(e, values);
+  insertIndex(count);
+  return (int)count++;
+}
+
+void PresetTable::setValues(size_t i, const PresetValues& values) {
+  store(entries[i], values);
+}
+
+void PresetTable::setDefault(int i) {
+  for (size_t k = 0; k < count; k++) entries[k].isDefault = ((int)k == i) ? 1 : 0;
+}
+
+bool PresetTable::rename(size_t i, const char* newName) {
+  int existing = find(newName);
+  if (existing >= 0) return (size_t)existing == i;
+  if (!reserve(count, strlen(newName) + 1)) return false;
+  appendString(newName, entries[i].name);
+  rebuildIndex();
+  return true;
+}
+
+void PresetTable::remove(size_t i) {
+  memmove(entries + i, entries + i + 1, (count - i - 1) * sizeof(Entry));
+  count--;
+  rebuildIndex();
+}
+
+void PresetTable::clear() {
+  count = 0;
+  arenaUsed = 0;
+  rebuildIndex();
+}
+
+size_t PresetTable::usedBytes() const {
+  return count * sizeof(Entry) + slotCount * sizeof(uint16_t) + arenaUsed;
+}
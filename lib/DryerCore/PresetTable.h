@@ -0,0 +1,73 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "PresetCodec.h"
+
+// The presets held in RAM. Everything lives in one heap block:
+//   [entries: fixed-width settings][name index: open addressing][string arena]
+// Names and notes are NUL-terminated strings in the arena, and the index maps a name
+// hash to its entry, so find() does not scan. The block is replaced (never grown in
+// place) when it runs out of room; superseded strings are dropped at that point.
+//
+// Entries keep the order presets were added in. Names are unique: adding an existing
+// name updates that preset.
+class PresetTable {
+public:
+  PresetTable();
+  ~PresetTable();
+  PresetTable(const PresetTable&) = delete;
+  PresetTable& operator=(const PresetTable&) = delete;
+
+  size_t size() const { return count; }
+  bool empty() const { return count == 0; }
+
+  // Index of the preset with this name, or -1
+  int find(const char* name) const;
+
+  const char* name(size_t i) const;
+  const char* notes(size_t i) const;
+  PresetValues values(size_t i) const;
+  bool isDefault(size_t i) const;
+
+  // Adds a preset, or updates notes and settings if the name exists. Returns its
+  // index, or -1 if memory ran out.
+  int put(const char* name, const char* notes, const PresetValues& values);
+  void setValues(size_t i, const PresetValues& values);
+  void setDefault(int i); // Clears the flag on all others; -1 clears all
+  bool rename(size_t i, const char* newName); // False if the name is taken or memory ran out
+  void remove(size_t i);
+  void clear();
+
+  // Heap block size and the part of it in use, for reporting
+  size_t capacityBytes() const { return blockSize; }
+  size_t usedBytes() const;
+
+private:
+  struct Entry {
+    uint16_t name;  // Arena offsets
+    uint16_t notes;
+    uint8_t mode;
+    uint8_t heatAction;
+    uint8_t control;
+    uint8_t isDefault;
+    float dryingTemp, setpointHum, warmTemp, humHyst, stallDelta;
+    uint32_t stallInterval, heatDur, logInt; // ms
+    float kp, ki, kd;
+    float modelGain, modelTau, modelDeadTime;
+  };
+
+  bool reserve(size_t entries, size_t arenaBytes);
+  bool appendString(const char* s, uint16_t& offset);
+  void insertIndex(size_t i);
+  void rebuildIndex();
+  void store(Entry& e, const PresetValues& v);
+
+  uint8_t* block;
+  size_t blockSize;
+  Entry* entries;
+  uint16_t* slots;  // Entry index + 1; 0 = empty
+  char* arena;
+  size_t count, entryCapacity, slotCount, arenaUsed, arenaCapacity;
+};
@@ -0,0 +1,102 @@
+#include "SensorFilter.h"
+
+#include <math.h>
+
+SensorFilter::SensorFilter() {
+  configure({1, 0.0f, 1.0f, 1});
+}
+
+SensorFilter::SensorFilter(const SensorFilterConfig& config) {
+  configure(config);
+}
+
+void SensorFilter::configure(const SensorFilterConfig& config) {
+  this->config = config;
+  if (this->config.medianSize < 1) this->config.medianSize = 1;
+  if (this->config.medianSize > MAX_MEDIAN) this->config.medianSize = MAX_MEDIAN;
+  reset();
+}
+
+void SensorFilter::reset() {
+  windowCount = 0;
+  windowNext = 0;
+  median = NAN;
+  missed = 0;
+  valid = false;
+  x = v = 0.0f;
+  p00 = p01 = p11 = 0.0f;
+}
+
+float SensorFilter::value() const {
+  return valid ? x : NAN;
+}
+
+float SensorFilter::rate() const {
+  return valid ? v : 0.0f;
+}
+
+float SensorFilter::uncertainty() const {
+  return valid ? sqrtf(p00) : NAN;
+}
+
+// Median of the last medianSize samples (fewer right after a reset)
+float SensorFilter::runningMedian(float sample) {
+  window[windowNext] = sample;
+  windowNext = (windowNext + 1) % config.medianSize;
+  if (windowCount < config.medianSize) windowCount++;
+
+  float sorted[MAX_MEDIAN];
+  for (uint8_t i = 0; i < windowCount; i++) {
+    float s = window[i];
+    uint8_t j = i;
+    for (; j > 0 && sorted[j - 1] > s; j--) sorted[j] = sorted[j - 1];
+    sorted[j] = s;
+  }
+  if (windowCount & 1) return sorted[windowCount / 2];
+  return 0.5f * (sorted[windowCount / 2 - 1] + sorted[windowCount / 2]);
+}
+
+// x += v * dt, with white-noise acceleration added to the covariance
+void SensorFilter::predict(float dt) {
+  float q = config.processNoise;
+  x += v * dt;
+  p00 += dt * (2.0f * p01 + dt * p11) + q * dt * dt * dt / 3.0f;
+  p01 += dt * p11 + q * dt * dt / 2.0f;
+  p11 += q * dt;
+}
+
+void SensorFilter::add(float sample, float dtSeconds) {
+  if (isnan(sample)) {
+    if (!valid) return;
+    if (++missed >= config.maxMissed) {
+      reset();
+      return;
+    }
+    predict(dtSeconds);
+    return;
+  }
+  missed = 0;
+  median = runningMedian(sample);
+
+  float r = config.measurementNoise * config.measurementNoise;
+  if (!valid) {
+    valid = true;
+    x = median;
+    v = 0.0f;
+    p00 = r;
+    p01 = 0.0f;
+    p11 = r; // Rate unknown: about one noise width per second
+    return;
+  }
+
+  predict(dtSeconds);
+  float s = p00 + r;
+  float k0 = p00 / s;
+  float k1 = p01 / s;
+  float innovation = median - x;
+  x += k0 * innovation;
+  v += k1 * innovation;
+  p11 -= k1 * p01;
+  p01 -= k0 * p01;
+  p00 -= k0 * p00;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct SensorFilterConfig {
+  uint8_t medianSize;     // Samples in the median window, odd, 1 to MAX_MEDIAN (1 = off)
+  float processNoise;     // Acceleration noise density, (unit/s^2)^2 per Hz; how fast the rate may change
+  float measurementNoise; // Standard deviation of one median output, in the sensor's unit
+  uint8_t maxMissed;      // Failed samples in a row before the estimate is dropped
+};
+
+// Filters one oversampled sensor channel in two stages:
+//   - a running median of the last medianSize samples throws out single spikes;
+//   - a Kalman filter with a constant-rate model (value and rate per second) smooths
+//     the medians and tracks ramps, such as a warm-up, without lagging behind.
+// uncertainty() is the filter's standard deviation of value(), so callers can leave a
+// margin around thresholds instead of switching on noise.
+//
+// A failed sample (NAN) only advances the prediction, so the estimate coasts through
+// short dropouts with growing uncertainty. After maxMissed of them in a row the filter
+// resets and value() is NAN until the sensor answers again.
+class SensorFilter {
+public:
+  static const size_t MAX_MEDIAN = 9;
+
+  SensorFilter(); // Pass-through until configure() is called
+  explicit SensorFilter(const SensorFilterConfig& config);
+
+  // Applies new settings and starts over
+  void configure(const SensorFilterConfig& config);
+  void reset();
+
+  // Adds a sample taken dtSeconds after the previous one (NAN = failed read)
+  void add(float sample, float dtSeconds);
+
+  bool isValid() const { return valid; }
+  float value() const;       // NAN until the first sample
+  float rate() const;        // Unit per second
+  float uncertainty() const; // 1 sigma of value(), NAN while invalid
+  float lastMedian() const { return median; }
+
+private:
+  float runningMedian(float sample);
+  void predict(float dt);
+
+  SensorFilterConfig config;
+  float window[MAX_MEDIAN];
+  uint8_t windowCount;
+  uint8_t windowNext;
+  float median;
+  uint8_t missed;
+  bool valid;
+  float x, v;              // Value and rate
+  float p00, p01, p11;     // Covariance (symmetric)
+};
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+// A value written by one task and read by any number of others without blocking.
+//
+// Two copies are kept. store() writes the copy readers are not directed to, bracketing
+// it with a sequence number (odd while writing), then points readers at it. load()
+// copies the current copy and retries if its sequence was odd or changed meanwhile,
+// which only happens when two store() calls complete during one load(). A reader that
+// preempts the writer therefore never spins on it, even on the same core.
+//
+// The copies are kept in atomic words, so a copy racing a store() is not a data race.
+template <typename T>
+class Seqlock {
+  static_assert(std::is_trivially_copyable<T>::value, "Seqlock holds plain data only");
+
+public:
+  Seqlock() : current(0), stores(0) {
+    for (Copy& c : copies) {
+      c.sequence.store(0, std::memory_order_relaxed);
+      for (size_t i = 0; i < WORDS; i++) c.words[i].store(0, std::memory_order_relaxed);
+    }
+  }
+
+  // Writer side (one task only)
+  void store(const T& value) {
+    uint32_t raw[WORDS] = {};
+    memcpy(raw, &value, sizeof(T));
+    int next = 1 - current.load(std::memory_order_relaxed);
+    Copy& c = copies[next];
+    uint32_t s = c.sequence.load(std::memory_order_relaxed);
+    c.sequence.store(s + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < WORDS; i++) c.words[i].store(raw[i], std::memory_order_relaxed);
+    c.sequence.store(s + 2, std::memory_order_release);
+    current.store(next, std::memory_order_release);
+    stores.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // Reader side (any task)
+  T load() const {
+    uint32_t raw[WORDS];
+    for (;;) {
+      const Copy& c = copies[current.load(std::memory_order_acquire)];
+      uint32_t before = c.sequence.load(std::memory_order_acquire);
+      if (before & 1) continue; // The writer has moved on to this copy; re-read current
+      for (size_t i = 0; i < WORDS; i++) raw[i] = c.words[i].load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (c.sequence.load(std::memory_order_relaxed) == before) break;
+    }
+    T value;
+    memcpy(&value, raw, sizeof(T));
+    return value;
+  }
+
+  // Number of store() calls so far
+  uint32_t version() const { return stores.load(std::memory_order_relaxed); }
+
+private:
+  static const size_t WORDS = (sizeof(T) + 3) / 4;
+
+  struct Copy {
+    std::atomic<uint32_t> sequence;
+    std::atomic<uint32_t> words[WORDS];
+  };
+
+  Copy copies[2];
+  std::atomic<int> current;
+  std::atomic<uint32_t> stores;
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdint.h>
+
+// Measures one approach to a setpoint: how long it took to get within `tolerance`
+// and how far the temperature went past the setpoint afterwards. Used to compare
+// control strategies run by run.
+class SetpointRunStats {
+public:
+  explicit SetpointRunStats(float tolerance = 0.5f) : tolerance(tolerance) { begin(0, 0.0f, 0.0f); active = false; }
+
+  void begin(uint32_t nowMs, float setpoint, float temperature) {
+    active = true;
+    reached = false;
+    startMs = nowMs;
+    this->setpoint = setpoint;
+    rising = setpoint >= temperature;
+    timeToSetpointMs = 0;
+    overshoot = 0.0f;
+  }
+
+  // Returns true on the tick the setpoint is first reached.
+  bool update(uint32_t nowMs, float temperature) {
+    if (!active) return false;
+    float past = rising ? temperature - setpoint : setpoint - temperature;
+    if (!reached) {
+      if (past >= -tolerance) {
+        reached = true;
+        timeToSetpointMs = nowMs - startMs;
+        if (past > overshoot) overshoot = past;
+        return true;
+      }
+    } else if (past > overshoot) {
+      overshoot = past;
+    }
+    return false;
+  }
+
+  void stop() { active = false; }
+
+  bool isActive() const { return active; }
+  bool hasReached() const { return reached; }
+  float getSetpoint() const { return setpoint; }
+  uint32_t getTimeToSetpointMs() const { return timeToSetpointMs; }
+  float getOvershoot() const { return overshoot; } // C past the setpoint, in the approach direction
+
+private:
+  float tolerance;
+  bool active;
+  bool reached;
+  bool rising;
+  uint32_t startMs;
+  float setpoint;
+  uint32_t timeToSetpointMs;
+  float overshoot;
+};
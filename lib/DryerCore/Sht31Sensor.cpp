@@ -0,0 +1,57 @@
+#include "Sht31Sensor.h"
+
+#include <math.h>
+
+#include "Checksum.h"
+
+static const uint16_t CMD_SOFT_RESET = 0x30A2;
+static const uint16_t CMD_SINGLE_SHOT_HIGH = 0x2400; // High repeatability, no clock stretching
+
+Sht31Sensor::Sht31Sensor(I2cWriteFn write, I2cReadFn read, void* ctx, uint8_t address)
+  : write(write), read(read), ctx(ctx), address(address), measuring(false), startedAt(0),
+    lastTemperature(NAN), lastHumidity(NAN), busErrors(0), crcErrors(0) {}
+
+bool Sht31Sensor::command(uint16_t code) {
+  uint8_t bytes[2] = { (uint8_t)(code >> 8), (uint8_t)code };
+  if (write(ctx, address, bytes, 2)) return true;
+  busErrors++;
+  return false;
+}
+
+bool Sht31Sensor::begin() {
+  measuring = false;
+  return command(CMD_SOFT_RESET);
+}
+
+bool Sht31Sensor::start(uint32_t nowMs) {
+  if (measuring || !command(CMD_SINGLE_SHOT_HIGH)) return false;
+  measuring = true;
+  startedAt = nowMs;
+  return true;
+}
+
+Sht31Sensor::Status Sht31Sensor::poll(uint32_t nowMs) {
+  if (!measuring) return IDLE;
+  uint32_t elapsed = nowMs - startedAt;
+  if (elapsed < MEASURE_MS) return MEASURING;
+
+  // The sensor NACKs the read until the measurement is done
+  uint8_t data[6];
+  if (!read(ctx, address, data, sizeof(data))) {
+    if (elapsed < TIMEOUT_MS) return MEASURING;
+    measuring = false;
+    busErrors++;
+    return FAILED;
+  }
+  measuring = false;
+
+  if (crc8(data, 2) != data[2] || crc8(data + 3, 2) != data[5]) {
+    crcErrors++;
+    return FAILED;
+  }
+  uint16_t rawT = (uint16_t)(data[0] << 8 | data[1]);
+  uint16_t rawH = (uint16_t)(data[3] << 8 | data[4]);
+  lastTemperature = -45.0f + 175.0f * rawT / 65535.0f;
+  lastHumidity = 100.0f * rawH / 65535.0f;
+  return READY;
+}
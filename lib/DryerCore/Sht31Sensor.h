@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Bus access for the sensor drivers; on the ESP32 these wrap Wire, on a host a mock.
+// Both return false if the device did not acknowledge or not all bytes arrived.
+typedef bool (*I2cWriteFn)(void* ctx, uint8_t address, const uint8_t* data, size_t len);
+typedef bool (*I2cReadFn)(void* ctx, uint8_t address, uint8_t* data, size_t len);
+
+// SHT31 driven as a state machine, so no call waits for a measurement.
+//
+// start() sends one single-shot command (high repeatability, no clock stretching)
+// and returns. poll() on a later tick reads temperature and humidity together in one
+// 6-byte transfer and checks the CRC of each word. Until the sensor is done (15.5 ms
+// at most) poll() only reports MEASURING; a sensor that is still not done after
+// TIMEOUT_MS fails the measurement.
+class Sht31Sensor {
+public:
+  enum Status {
+    IDLE,      // Nothing started
+    MEASURING, // Started, result not read yet
+    READY,     // A new reading is in temperature()/humidity()
+    FAILED,    // Bus error, CRC mismatch or timeout; the last reading is kept
+  };
+
+  static const uint32_t MEASURE_MS = 16;
+  static const uint32_t TIMEOUT_MS = 100;
+
+  Sht31Sensor(I2cWriteFn write = nullptr, I2cReadFn read = nullptr, void* ctx = nullptr, uint8_t address = 0x44);
+
+  // Soft-resets the sensor. Returns false if it did not answer.
+  bool begin();
+
+  // Starts a measurement. Returns false if one is already running or the sensor did
+  // not acknowledge the command.
+  bool start(uint32_t nowMs);
+
+  // Reads the result once the measurement time is up. Returns READY or FAILED once per
+  // measurement, then IDLE until the next start().
+  Status poll(uint32_t nowMs);
+
+  bool isMeasuring() const { return measuring; }
+  float temperature() const { return lastTemperature; } // C
+  float humidity() const { return lastHumidity; }       // %RH
+  uint8_t getAddress() const { return address; }
+  uint32_t getBusErrors() const { return busErrors; }
+  uint32_t getCrcErrors() const { return crcErrors; }
+
+private:
+  bool command(uint16_t code);
+
+  I2cWriteFn write;
+  I2cReadFn read;
+  void* ctx;
+  uint8_t address;
+  bool measuring;
+  uint32_t startedAt;
+  float lastTemperature;
+  float lastHumidity;
+  uint32_t busErrors;
+  uint32_t crcErrors;
+};
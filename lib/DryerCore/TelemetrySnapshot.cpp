@@ -0,0 +1,101 @@
+#include "TelemetrySnapshot.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+static const char* const KEYS[] = {
+  "zone", "temperature", "humidity", "humidity_rate", "drying_temp", "setpoint_hum", "warm_temp",
+  "process_state", "heater_on", "is_enabled", "hum_hyst", "stall_interval", "stall_delta",
+  "heat_duration", "heat_remaining", "log_interval", "is_stalled", "selected_mode", "heat_action",
+  "heater_duty", "pid_p", "pid_i", "pid_d", "kp", "ki", "kd",
+  "model_gain", "model_tau", "model_dead_time",
+  "control", "run_setpoint", "run_time_to_setpoint", "run_overshoot",
+  "temperature_sigma", "humidity_sigma",
+  "control_point", "probe_count", "temperature_gradient"
+};
+static_assert(sizeof(KEYS) / sizeof(KEYS[0]) == TelemetryText::FIELD_COUNT, "KEYS must match TelemetryText::format()");
+
+const char* TelemetryText::key(size_t field) {
+  return KEYS[field];
+}
+
+void TelemetryText::format(const TelemetryValues& v) {
+  size_t i = 0;
+  char (*out)[VALUE_SIZE] = values;
+  // Same order as KEYS. JSON has no NaN, so sensor errors are sent as null.
+  #define FIELD(...) snprintf(out[i++], VALUE_SIZE, __VA_ARGS__)
+  #define BOOL_FIELD(b) FIELD("%s", (b) ? "true" : "false")
+  FIELD("%u", (unsigned)v.zone);
+  if (isnan(v.temperature)) FIELD("null"); else FIELD("%.1f", v.temperature);
+  if (isnan(v.humidity)) FIELD("null"); else FIELD("%.1f", v.humidity);
+  FIELD("%.2f", v.humidityRate);
+  FIELD("%.1f", v.dryingTemp);
+  FIELD("%.1f", v.setpointHum);
+  FIELD("%.1f", v.warmTemp);
+  FIELD("\"%s\"", v.processState);
+  BOOL_FIELD(v.heaterOn);
+  BOOL_FIELD(v.isEnabled);
+  FIELD("%.1f", v.humHyst);
+  FIELD("%lu", (unsigned long)v.stallInterval);
+  FIELD("%.1f", v.stallDelta);
+  FIELD("%lu", (unsigned long)v.heatDuration);
+  FIELD("%lu", (unsigned long)v.heatRemaining);
+  FIELD("%.1f", v.logIntervalMin);
+  BOOL_FIELD(v.isStalled);
+  FIELD("%d", v.selectedMode);
+  FIELD("\"%s\"", v.heatAction);
+  FIELD("%.1f", v.heaterDuty);
+  FIELD("%.2f", v.pidP);
+  FIELD("%.2f", v.pidI);
+  FIELD("%.2f", v.pidD);
+  FIELD("%.3f", v.kp);
+  FIELD("%.4f", v.ki);
+  FIELD("%.1f", v.kd);
+  FIELD("%.3f", v.modelGain);
+  FIELD("%.0f", v.modelTau);
+  FIELD("%.0f", v.modelDeadTime);
+  FIELD("%d", v.control);
+  FIELD("%.1f", v.runSetpoint);
+  if (v.runReached) FIELD("%lu", (unsigned long)v.runTimeToSetpoint); else FIELD("null");
+  FIELD("%.2f", v.runOvershoot);
+  if (isnan(v.temperatureSigma)) FIELD("null"); else FIELD("%.2f", v.temperatureSigma);
+  if (isnan(v.humiditySigma)) FIELD("null"); else FIELD("%.2f", v.humiditySigma);
+  FIELD("%d", v.controlPoint);
+  FIELD("%u", (unsigned)v.probeCount);
+  if (isnan(v.temperatureGradient)) FIELD("null"); else FIELD("%.1f", v.temperatureGradient);
+  #undef BOOL_FIELD
+  #undef FIELD
+}
+
+size_t formatTelemetryJson(const TelemetryText& text, char* buf, size_t size, const bool* mask) {
+  size_t len = 0;
+  bool first = true;
+  if (size < 3) return 0;
+  buf[len++] = '{';
+  for (size_t i = 0; i < TelemetryText::FIELD_COUNT; i++) {
+    if (mask && !mask[i]) continue;
+    int n = snprintf(buf + len, size - len, "%s\"%s\":%s", first ? "" : ",", KEYS[i], text.values[i]);
+    if (n < 0 || (size_t)n >= size - len) return 0;
+    len += n;
+    first = false;
+  }
+  if (len + 2 > size) return 0;
+  buf[len++] = '}';
+  buf[len] = '\0';
+  return len;
+}
+
+size_t TelemetryDelta::build(const TelemetryText& text, char* buf, size_t size) {
+  bool changed[TelemetryText::FIELD_COUNT];
+  bool any = false;
+  for (size_t i = 0; i < TelemetryText::FIELD_COUNT; i++) {
+    changed[i] = !primed || strcmp(text.values[i], pushed.values[i]) != 0;
+    any = any || changed[i];
+  }
+  if (!any) return 0;
+  pushed = text;
+  primed = true;
+  changed[TelemetryText::ZONE_FIELD] = true;
+  return formatTelemetryJson(text, buf, size, changed);
+}
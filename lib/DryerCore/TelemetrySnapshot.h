@@ -0,0 +1,157 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Everything the web UI shows, captured once per control tick.
+struct TelemetryValues {
+  uint8_t zone;           // Dryer zone the values are from
+  float temperature;      // NAN on sensor error
+  float humidity;         // NAN on sensor error
+  float humidityRate;
+  float dryingTemp;
+  float setpointHum;
+  float warmTemp;
+  const char* processState;
+  bool heaterOn;
+  bool isEnabled;
+  float humHyst;
+  uint32_t stallInterval; // ms
+  float stallDelta;
+  uint32_t heatDuration;  // ms
+  uint32_t heatRemaining; // ms
+  float logIntervalMin;
+  bool isStalled;
+  int selectedMode;
+  const char* heatAction;
+  float heaterDuty;
+  float pidP, pidI, pidD;
+  float kp, ki, kd;
+  float modelGain, modelTau, modelDeadTime;
+  int control;
+  float runSetpoint;
+  bool runReached;
+  uint32_t runTimeToSetpoint; // s
+  float runOvershoot;
+  float temperatureSigma; // Filter uncertainty (1 sigma), NAN on sensor error
+  float humiditySigma;
+  int controlPoint;
+  uint8_t probeCount;        // Probes with a valid reading
+  float temperatureGradient; // Top probe minus bottom probe, NAN with no probe
+};
+
+// The JSON text of every telemetry field, formatted once per tick and shared by the
+// full /readings body and the WebSocket deltas.
+struct TelemetryText {
+  static const size_t FIELD_COUNT = 38;
+  static const size_t ZONE_FIELD = 0; // Sent with every delta, so clients know whose fields they are
+  static const size_t VALUE_SIZE = 40;
+
+  void format(const TelemetryValues& v);
+  static const char* key(size_t field);
+
+  char values[FIELD_COUNT][VALUE_SIZE];
+};
+
+// Joins the fields into a JSON object with snprintf. With a mask, only fields whose
+// flag is set are written. Returns the length, or 0 if it did not fit.
+size_t formatTelemetryJson(const TelemetryText& text, char* buf, size_t size, const bool* mask = nullptr);
+
+// Pre-serialized /readings body, rebuilt by the control loop and copied out by every
+// request.
+//
+// The same scheme as Seqlock: two copies, each with a sequence number that is odd while
+// the writer fills it. publish() formats into a scratch buffer of its own, then writes
+// the copy readers are not directed to and points them at it. copy() takes the length
+// and text from the copy current at the time and retries if the sequence was odd or
+// changed meanwhile, so a reader never pairs one body with another's length and never
+// keeps a pointer into a buffer the writer may reuse. The text is kept in atomic
+// words, so a copy racing a publish() is not a data race.
+template <size_t Size>
+class TelemetrySnapshot {
+public:
+  static const size_t CAPACITY = Size;                      // Bytes of JSON, without the NUL
+  static const size_t BUFFER_SIZE = (Size + 1 + 3) / 4 * 4; // What copy() may write
+
+  TelemetrySnapshot() : current(0) {
+    for (Copy& c : copies) {
+      c.sequence.store(0, std::memory_order_relaxed);
+      c.length.store(0, std::memory_order_relaxed);
+      for (size_t i = 0; i < WORDS; i++) c.words[i].store(0, std::memory_order_relaxed);
+    }
+  }
+
+  // Writer side (control loop only).
+  void publish(const TelemetryText& text) {
+    size_t len = formatTelemetryJson(text, (char*)scratch, Size + 1);
+    if (len == 0) return; // Keep serving the previous snapshot
+    int next = 1 - current.load(std::memory_order_relaxed);
+    Copy& c = copies[next];
+    uint32_t s = c.sequence.load(std::memory_order_relaxed);
+    c.sequence.store(s + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    c.length.store((uint32_t)len, std::memory_order_relaxed);
+    for (size_t i = 0; i < (len + 3) / 4; i++) c.words[i].store(scratch[i], std::memory_order_relaxed);
+    c.sequence.store(s + 2, std::memory_order_release);
+    current.store(next, std::memory_order_release);
+  }
+
+  // Reader side (any task). Copies the body into out, which must hold BUFFER_SIZE
+  // bytes, NUL-terminates it and returns its length (0 before the first publish()).
+  size_t copy(char* out) const {
+    size_t len;
+    for (;;) {
+      const Copy& c = copies[current.load(std::memory_order_acquire)];
+      uint32_t before = c.sequence.load(std::memory_order_acquire);
+      if (before & 1) continue; // The writer has moved on to this copy; re-read current
+      len = c.length.load(std::memory_order_relaxed);
+      if (len > Size) len = Size; // Torn; the check below retries
+      for (size_t i = 0; i < (len + 3) / 4; i++) {
+        uint32_t word = c.words[i].load(std::memory_order_relaxed);
+        memcpy(out + i * 4, &word, 4);
+      }
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (c.sequence.load(std::memory_order_relaxed) == before) break;
+    }
+    out[len] = '\0';
+    return len;
+  }
+
+private:
+  static const size_t WORDS = BUFFER_SIZE / 4;
+
+  struct Copy {
+    std::atomic<uint32_t> sequence;
+    std::atomic<uint32_t> length;
+    std::atomic<uint32_t> words[WORDS];
+  };
+
+  uint32_t scratch[WORDS]; // Writer only
+  Copy copies[2];
+  std::atomic<int> current;
+};
+
+// Tracks what was last pushed to WebSocket clients and builds a JSON object holding
+// only the fields that changed since then. Fields are compared by their text.
+class TelemetryDelta {
+public:
+  TelemetryDelta() { reset(); }
+
+  // Forget the last frame; the next build() sends every field.
+  void reset() { primed = false; }
+
+  // Returns the length of the delta written to buf, or 0 if nothing changed.
+  size_t build(const TelemetryText& text, char* buf, size_t size);
+
+  // Every field as last pushed, for a client joining now: later deltas apply to it.
+  // Returns the length, or 0 before the first build().
+  size_t formatPushed(char* buf, size_t size) const {
+    return primed ? formatTelemetryJson(pushed, buf, size) : 0;
+  }
+
+private:
+  TelemetryText pushed;
+  bool primed;
+};
@@ -0,0 +1,101 @@
+#include "ThermalModel.h"
+
+#include <math.h>
+
+bool fitFopdt(const float* samples, size_t count, float dtSeconds, float baseline,
+              float stepDuty, FopdtModel& model) {
+  if (count < 20 || dtSeconds <= 0.0f || stepDuty <= 0.0f) return false;
+
+  // Discrete form of the model with the step held constant: after the dead time d,
+  //   y[k+1] = a * y[k] + c,   a = exp(-dt / tau),   c = (1 - a) * K * u
+  // For each candidate d, fit (a, c) by least squares, simulate the whole response
+  // and keep the candidate with the smallest output error.
+  size_t maxDelay = count / 3;
+  bool found = false;
+  double bestSse = 0.0;
+
+  for (size_t d = 0; d <= maxDelay; d++) {
+    double n = 0, sx = 0, sz = 0, sxx = 0, sxz = 0;
+    for (size_t k = d; k + 1 < count; k++) {
+      double x = samples[k] - baseline;
+      double z = samples[k + 1] - baseline;
+      n += 1; sx += x; sz += z; sxx += x * x; sxz += x * z;
+    }
+    double denom = n * sxx - sx * sx;
+    if (n < 10 || denom <= 0.0) continue;
+    double a = (n * sxz - sx * sz) / denom;
+    double c = (sz - a * sx) / n;
+    if (!(a > 0.0 && a < 1.0) || c <= 0.0) continue;
+
+    double y = 0.0, sse = 0.0;
+    for (size_t k = 0; k < count; k++) {
+      double e = (samples[k] - baseline) - y;
+      sse += e * e;
+      if (k >= d) y = a * y + c;
+    }
+    if (!found || sse < bestSse) {
+      found = true;
+      bestSse = sse;
+      model.timeConstant = (float)(-dtSeconds / log(a));
+      model.gain = (float)(c / (1.0 - a) / stepDuty);
+      model.deadTime = (float)(d * dtSeconds);
+      model.rmsError = (float)sqrt(sse / count);
+    }
+  }
+  return found;
+}
+
+void StepResponseTest::start(uint32_t nowMs, float stepDuty, float maxTemperature) {
+  this->stepDuty = stepDuty;
+  this->maxTemperature = maxTemperature;
+  phase = PHASE_BASELINE;
+  phaseStart = nowMs;
+  baselineSum = 0.0;
+  baselineCount = 0;
+  count = 0;
+  model = FopdtModel{0.0f, 0.0f, 0.0f, 0.0f};
+}
+
+void StepResponseTest::abort() {
+  if (isRunning()) phase = PHASE_FAILED;
+}
+
+float StepResponseTest::update(uint32_t nowMs, float temperature) {
+  if (!isRunning()) return 0.0f;
+  if (isnan(temperature)) {
+    phase = PHASE_FAILED; // Never heat blind
+    return 0.0f;
+  }
+
+  if (phase == PHASE_BASELINE) {
+    baselineSum += temperature;
+    baselineCount++;
+    if (nowMs - phaseStart < BASELINE_MS) return 0.0f;
+
+    baseline = (float)(baselineSum / baselineCount);
+    phase = PHASE_STEP;
+    phaseStart = nowMs;
+    nextSampleTime = nowMs;
+  }
+
+  // PHASE_STEP
+  if (nowMs - nextSampleTime < 0x80000000UL) { // nowMs >= nextSampleTime, wrap-safe
+    samples[count++] = temperature;
+    nextSampleTime += SAMPLE_PERIOD_MS;
+
+    bool settled = false;
+    if (nowMs - phaseStart >= MIN_STEP_MS && count > SETTLE_SAMPLES) {
+      settled = samples[count - 1] - samples[count - 1 - SETTLE_SAMPLES] < SETTLE_DELTA;
+    }
+    if (settled || count == CAPACITY || temperature >= maxTemperature) {
+      finish();
+      return 0.0f;
+    }
+  }
+  return stepDuty;
+}
+
+void StepResponseTest::finish() {
+  float dt = SAMPLE_PERIOD_MS / 1000.0f;
+  phase = fitFopdt(samples, count, dt, baseline, stepDuty, model) ? PHASE_DONE : PHASE_FAILED;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// First-order-plus-dead-time model of the chamber:
+//   T(t) = T0 + gain * duty * (1 - exp(-(t - deadTime) / timeConstant))   for t > deadTime
+struct FopdtModel {
+  float gain;         // C per % heater duty at steady state
+  float timeConstant; // s
+  float deadTime;     // s
+  float rmsError;     // C, residual of the fit
+
+  bool isValid() const { return gain > 0.0f && timeConstant > 0.0f; }
+};
+
+// Fits an FOPDT model to a heater step response.
+// samples[0] is the temperature when the step was applied, later samples follow every
+// dtSeconds. `baseline` is the settled temperature before the step and `stepDuty` the
+// applied heater duty in %. Works on partial responses that have not reached steady
+// state. Returns false if no model with 0 < a < 1 fits.
+bool fitFopdt(const float* samples, size_t count, float dtSeconds, float baseline,
+              float stepDuty, FopdtModel& model);
+
+// Runs the on-device identification experiment: a baseline with the heater off, then
+// a fixed duty step that is recorded until the response settles, a temperature limit
+// is reached or the buffer is full, and finally the FOPDT fit.
+class StepResponseTest {
+public:
+  enum Phase { PHASE_IDLE, PHASE_BASELINE, PHASE_STEP, PHASE_DONE, PHASE_FAILED };
+
+  static const size_t CAPACITY = 720;             // 2 hours at one sample per 10 s
+  static const uint32_t SAMPLE_PERIOD_MS = 10000;
+  static const uint32_t BASELINE_MS = 120000;
+  static const uint32_t MIN_STEP_MS = 20 * 60000; // Never call it settled before this
+  static const size_t SETTLE_SAMPLES = 30;        // 5 minutes
+  static constexpr float SETTLE_DELTA = 0.1f;     // C of rise over SETTLE_SAMPLES
+
+  StepResponseTest() : phase(PHASE_IDLE) {}
+
+  void start(uint32_t nowMs, float stepDuty, float maxTemperature);
+  void abort();
+
+  // Feeds the latest reading and returns the heater duty to apply (in %).
+  float update(uint32_t nowMs, float temperature);
+
+  Phase getPhase() const { return phase; }
+  bool isRunning() const { return phase == PHASE_BASELINE || phase == PHASE_STEP; }
+  const FopdtModel& getModel() const { return model; }
+  size_t getSampleCount() const { return count; }
+
+private:
+  void finish();
+
+  Phase phase;
+  float stepDuty;
+  float maxTemperature;
+  uint32_t phaseStart;
+  uint32_t nextSampleTime;
+  double baselineSum;
+  uint32_t baselineCount;
+  float baseline;
+  float samples[CAPACITY];
+  size_t count;
+  FopdtModel model;
+};
@@ -0,0 +1,75 @@
+#include "TimeProportionalOutput.h"
+
+TimeProportionalOutput::TimeProportionalOutput(uint32_t windowMs, uint32_t minOnMs, uint32_t minOffMs,
+                                               PinWriter writer, void* context)
+  : windowMs(windowMs), minOnMs(minOnMs), minOffMs(minOffMs), writer(writer), context(context),
+    dutyCenti(0), on(false), cycles(0), onTotalMs(0), started(false), windowStart(0), onTimeMs(0), carryMs(0),
+    lastSwitch(0), lastServiceMs(0) {}
+
+void TimeProportionalOutput::setDuty(float percent) {
+  if (!(percent > 0.0f)) percent = 0.0f; // Also catches NaN
+  if (percent > 100.0f) percent = 100.0f;
+  dutyCenti.store((uint32_t)(percent * 100.0f + 0.5f));
+}
+
+void TimeProportionalOutput::startWindow(uint32_t nowMs) {
+  // Keep the window phase if we are on time; re-anchor after a long stall.
+  if (started && nowMs - windowStart < 2 * windowMs) {
+    windowStart += windowMs;
+  } else {
+    windowStart = nowMs;
+  }
+
+  uint32_t duty = dutyCenti.load();
+  if (duty == 0 || duty >= 10000) carryMs = 0; // Nothing owed at the extremes
+
+  int32_t desired = (int32_t)((uint64_t)duty * windowMs / 10000) + carryMs;
+  uint32_t onTime;
+  if (desired < (int32_t)minOnMs) {
+    onTime = 0;
+  } else if (desired > (int32_t)(windowMs - minOffMs)) {
+    onTime = windowMs;
+  } else {
+    onTime = (uint32_t)desired;
+  }
+  carryMs = desired - (int32_t)onTime;
+  if (carryMs > (int32_t)windowMs) carryMs = windowMs;
+  if (carryMs < -(int32_t)windowMs) carryMs = -(int32_t)windowMs;
+  onTimeMs = onTime;
+}
+
+void TimeProportionalOutput::write(bool state, uint32_t nowMs) {
+  if (!state) onTotalMs.fetch_add(nowMs - lastSwitch, std::memory_order_relaxed);
+  on.store(state);
+  lastSwitch = nowMs;
+  if (state) cycles.fetch_add(1);
+  if (writer) writer(state, context);
+}
+
+void TimeProportionalOutput::service(uint32_t nowMs) {
+  if (!started) {
+    startWindow(nowMs);
+    started = true;
+    lastSwitch = nowMs - (minOnMs > minOffMs ? minOnMs : minOffMs); // No hold at power-up
+    lastServiceMs = nowMs;
+  }
+  if (nowMs - windowStart >= windowMs) {
+    // After a stall of a window or more the pin was not driven as planned, so what the
+    // last window carried no longer says what is owed. (A stall of two windows or more
+    // also re-anchors the window.)
+    if (nowMs - lastServiceMs >= windowMs) carryMs = 0;
+    startWindow(nowMs);
+  }
+  lastServiceMs = nowMs;
+
+  bool want = (nowMs - windowStart) < onTimeMs;
+  if (dutyCenti.load() == 0) want = false; // Switch off early when heating is no longer wanted
+
+  bool current = on.load();
+  if (want == current) return;
+
+  uint32_t inState = nowMs - lastSwitch;
+  if (current && inState < minOnMs) return;
+  if (!current && inState < minOffMs) return;
+  write(want, nowMs);
+}
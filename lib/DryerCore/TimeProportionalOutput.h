@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+// Time-proportioning output stage for the heater SSR.
+//
+// A 0-100 % duty request is turned into an ON period at the start of each fixed
+// window. service() is meant to be called from a periodic hardware/esp_timer tick,
+// so the edges do not depend on the LVGL loop. The clock and the pin are passed in,
+// which keeps the scheduling testable on the host.
+//
+// Minimum ON and OFF times protect the SSR: ON periods that would be too short are
+// skipped, OFF gaps that would be too short are filled, and the difference is carried
+// into the next window so the average duty still matches the request.
+class TimeProportionalOutput {
+public:
+  typedef void (*PinWriter)(bool on, void* context);
+
+  TimeProportionalOutput(uint32_t windowMs, uint32_t minOnMs, uint32_t minOffMs,
+                         PinWriter writer, void* context = nullptr);
+
+  // Safe to call from another task; takes effect at the next window, except that
+  // a duty of 0 switches off as soon as the minimum ON time allows.
+  void setDuty(float percent);
+  float getDuty() const { return dutyCenti.load() / 100.0f; }
+
+  // Advances the schedule to nowMs and drives the pin on an edge.
+  void service(uint32_t nowMs);
+
+  bool isOn() const { return on.load(); }
+  uint32_t getCycleCount() const { return cycles.load(); } // OFF -> ON transitions
+  // Total of the ON pulses that have ended, in ms; wraps after 49 days of ON time
+  uint32_t getOnTimeTotal() const { return onTotalMs.load(); }
+  uint32_t getWindowOnTime() const { return onTimeMs; }
+
+private:
+  void startWindow(uint32_t nowMs);
+  void write(bool state, uint32_t nowMs);
+
+  const uint32_t windowMs;
+  const uint32_t minOnMs;
+  const uint32_t minOffMs;
+  PinWriter writer;
+  void* context;
+
+  std::atomic<uint32_t> dutyCenti; // 0.01 % steps
+  std::atomic<bool> on;
+  std::atomic<uint32_t> cycles;
+  std::atomic<uint32_t> onTotalMs;
+
+  bool started;
+  uint32_t windowStart;
+  uint32_t onTimeMs;
+  int32_t carryMs;
+  uint32_t lastSwitch;
+  uint32_t lastServiceMs;
+};
@@ -0,0 +1,65 @@
+#include "ChamberPlant.h"
+
+#include <math.h>
+
+static const float CHAMBER_HEIGHT = 30.0f; // cm
+
+ChamberPlant::ChamberPlant(const ChamberPlantConfig& config)
+  : config(config), element(config.ambientTemperature), air(config.ambientTemperature), energy(0.0f) {
+  vapor = config.volume * saturationDensity(config.ambientTemperature) * config.ambientHumidity / 100.0f;
+  water = config.filamentMass * config.filamentMoisture / 100.0f;
+}
+
+float ChamberPlant::saturationDensity(float temperature) {
+  float pressure = 611.2f * expf(17.62f * temperature / (243.12f + temperature)); // Pa
+  return pressure / (461.5f * (temperature + 273.15f)) * 1000.0f;                 // g/m3
+}
+
+void ChamberPlant::step(float dtSeconds, bool heaterOn) {
+  // Heat: element -> air -> room
+  float power = heaterOn ? config.heaterPower : 0.0f;
+  float intoAir = config.elementCoupling * (element - air);
+  float lost = config.lossCoefficient * (air - config.ambientTemperature);
+  element += (power - intoAir) / config.elementCapacity * dtSeconds;
+  air += (intoAir - lost) / config.chamberCapacity * dtSeconds;
+  energy += power * dtSeconds;
+
+  // Moisture: filament -> air -> room. Desorption speeds up with temperature and stops
+  // at the equilibrium moisture content for the chamber humidity.
+  float rh = relativeHumidity() / 100.0f;
+  float equilibrium = config.filamentMass * config.equilibriumMoisture / 100.0f * rh;
+  float rate = config.desorptionRate * exp2f((air - 25.0f) / 10.0f) / 3600.0f;
+  float desorbed = (water - equilibrium) * rate * dtSeconds;
+  water -= desorbed;
+  float ambientVapor = config.volume * saturationDensity(config.ambientTemperature) * config.ambientHumidity / 100.0f;
+  vapor += desorbed - (vapor - ambientVapor) * config.airChangesPerHour / 3600.0f * dtSeconds;
+
+  // Anything above saturation condenses on the walls and is gone
+  float saturated = config.volume * saturationDensity(air);
+  if (vapor > saturated) vapor = saturated;
+}
+
+void ChamberPlant::addVapor(float grams) {
+  vapor += grams;
+  float saturated = config.volume * saturationDensity(air);
+  if (vapor > saturated) vapor = saturated;
+}
+
+float ChamberPlant::relativeHumidity() const {
+  float rh = vapor / (config.volume * saturationDensity(air)) * 100.0f;
+  return rh > 100.0f ? 100.0f : rh;
+}
+
+float ChamberPlant::filamentMoisture() const {
+  return water / config.filamentMass * 100.0f;
+}
+
+float ChamberPlant::temperatureAt(float height) const {
+  float gradient = config.stratification * (air - config.ambientTemperature);
+  return air + gradient * (height / CHAMBER_HEIGHT - 0.5f);
+}
+
+float ChamberPlant::humidityAt(float height) const {
+  float rh = vapor / (config.volume * saturationDensity(temperatureAt(height))) * 100.0f;
+  return rh > 100.0f ? 100.0f : rh;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stdint.h>
+
+// Physical constants of a simulated dryer. The defaults describe a vented 30 L box
+// with a 60 W heater and a 1 kg spool of damp PETG in a 26.5 C / 56 % room, which is
+// where the live test plan was run.
+struct ChamberPlantConfig {
+  float ambientTemperature = 26.5f; // C
+  float ambientHumidity = 56.0f;    // %RH
+  float heaterPower = 60.0f;        // W with the SSR on
+  float elementCapacity = 60.0f;    // J/K of the heater and its fins
+  float elementCoupling = 4.0f;     // W/K from the element into the air
+  float chamberCapacity = 1100.0f;  // J/K of air, walls and spool
+  float lossCoefficient = 0.9f;     // W/K through the walls
+  float volume = 0.03f;             // m3 of air
+  float airChangesPerHour = 6.0f;   // Venting; carries the moisture out
+  float filamentMass = 1000.0f;     // g
+  float filamentMoisture = 0.6f;    // % of the filament mass at the start
+  float equilibriumMoisture = 0.6f; // % held by the filament at 100 %RH, linear below
+  float desorptionRate = 1.0f / 48; // 1/h towards equilibrium at 25 C; doubles every 10 C
+  float stratification = 0.03f;     // Top minus bottom, per C above ambient
+};
+
+// Lumped model of the chamber: the heater element warms the air, the air loses heat
+// through the walls, and the filament gives off water until it is in equilibrium with
+// the air, which the vents exchange with the room. Integrated with explicit Euler
+// steps, so step() should be called with dt of a few ms up to about a second.
+class ChamberPlant {
+public:
+  explicit ChamberPlant(const ChamberPlantConfig& config = ChamberPlantConfig());
+
+  void step(float dtSeconds, bool heaterOn);
+
+  // Water added straight to the air, e.g. someone breathing into the box (g)
+  void addVapor(float grams);
+
+  float airTemperature() const { return air; }
+  float elementTemperature() const { return element; }
+  float relativeHumidity() const; // %RH of the chamber air, at most 100
+  float filamentMoisture() const; // % of the filament mass
+  float temperatureAt(float height) const; // C at height cm, 0-30 from floor to lid
+  float humidityAt(float height) const;    // %RH there, with the same water content as the rest
+  float heaterEnergy() const { return energy; } // J since construction
+
+  // Saturation vapour density (g/m3) at temperature C (Magnus formula)
+  static float saturationDensity(float temperature);
+
+  const ChamberPlantConfig& getConfig() const { return config; }
+
+private:
+  ChamberPlantConfig config;
+  float element;  // C
+  float air;      // C
+  float vapor;    // g of water in the air
+  float water;    // g of water in the filament
+  float energy;   // J
+};
@@ -0,0 +1,147 @@
+#include "DryerSimulation.h"
+
+#include <math.h>
+#include <stdio.h>
+
+#include "Checksum.h"
+
+// SHT31 in still air behind its filter cap
+static const float SENSOR_TIME_CONSTANT = 8.0f;   // s
+static const float TEMPERATURE_NOISE = 0.05f;     // C, 1 sigma
+static const float HUMIDITY_NOISE = 0.15f;        // %RH, 1 sigma
+
+static const uint16_t CMD_SOFT_RESET = 0x30A2;
+static const uint16_t CMD_SINGLE_SHOT_HIGH = 0x2400;
+
+DryerSimulation::DryerSimulation(const ChamberPlantConfig& config, uint32_t seed)
+  : plant(config), output(HEATER_WINDOW_MS, HEATER_MIN_ON_MS, HEATER_MIN_OFF_MS, writeHeater, this),
+    heaterPin(false), nowMs(0), tick(0), random(seed), verbose(false), events() {
+  // The two main-bus probes of the firmware's first zone
+  probes[0] = {0x44, 5.0f, 0.0f, 0.0f, false, 0, 0};
+  probes[1] = {0x45, 25.0f, 0.0f, 0.0f, false, 0, 0};
+  for (size_t i = 0; i < 2; i++) {
+    probes[i].temperature = plant.temperatureAt(probes[i].height);
+    probes[i].humidity = plant.humidityAt(probes[i].height);
+    probeConfigs[i] = {-1, probes[i].address, probes[i].height};
+  }
+  sensors.configure(busWrite, busRead, this, nullptr, probeConfigs, 2, PROBE_TEMPERATURE_FILTER, PROBE_HUMIDITY_FILTER);
+  sensors.begin();
+
+  ZoneHooks hooks = {onLog, onMessage, nullptr, this};
+  dryer.setHooks(hooks);
+  trace.push_back({0, dryer.getStatus()});
+}
+
+void DryerSimulation::run(uint32_t ms) {
+  uint32_t end = nowMs + ms;
+  while ((int32_t)(end - nowMs) > 0) advance();
+}
+
+bool DryerSimulation::advance() {
+  bool stepped = false;
+  if (nowMs % CONTROL_TICK_MS == 0) {
+    // The control task's tick
+    sensors.service(nowMs);
+    dryer.setReading(sensors.fused());
+    if (tick % RECORD_TICKS == 0) dryer.recordHumidity(nowMs);
+    if (tick % CONTROL_TICKS == 0) {
+      output.setDuty(dryer.step(nowMs));
+      if (dryer.getStatus() != trace.back().status) {
+        trace.push_back({nowMs, dryer.getStatus()});
+        if (verbose) printf("%8.1f min  %s\n", nowMs / 60000.0, processStatusText(dryer.getStatus()));
+      }
+      stepped = true;
+    }
+    tick++;
+  }
+  output.service(nowMs);
+  plant.step(HEATER_TICK_MS / 1000.0f, heaterPin);
+  nowMs += HEATER_TICK_MS;
+  return stepped;
+}
+
+bool DryerSimulation::sawStatus(ProcessStatus status, uint32_t sinceMs) const {
+  for (const StatusChange& change : trace) {
+    if (change.status == status && change.timeMs >= sinceMs) return true;
+  }
+  return false;
+}
+
+// Gaussian, from a fixed-seed generator so every run is the same
+float DryerSimulation::noise(float sigma) {
+  auto uniform = [this]() {
+    random = random * 1664525u + 1013904223u;
+    return ((random >> 8) + 0.5f) / 16777216.0f;
+  };
+  float u1 = uniform(), u2 = uniform();
+  return sigma * sqrtf(-2.0f * logf(u1)) * cosf(6.2831853f * u2);
+}
+
+DryerSimulation::Probe* DryerSimulation::probe(uint8_t address) {
+  for (Probe& p : probes) {
+    if (p.address == address) return &p;
+  }
+  return nullptr;
+}
+
+bool DryerSimulation::busWrite(void* ctx, uint8_t address, const uint8_t* data, size_t len) {
+  DryerSimulation* sim = (DryerSimulation*)ctx;
+  Probe* p = sim->probe(address);
+  if (!p || len != 2) return false;
+  uint16_t command = (uint16_t)(data[0] << 8 | data[1]);
+  if (command == CMD_SOFT_RESET) {
+    p->measuring = false;
+    return true;
+  }
+  if (command != CMD_SINGLE_SHOT_HIGH || p->measuring) return false;
+  p->measuring = true;
+  p->startedAt = sim->nowMs;
+  return true;
+}
+
+bool DryerSimulation::busRead(void* ctx, uint8_t address, uint8_t* data, size_t len) {
+  DryerSimulation* sim = (DryerSimulation*)ctx;
+  Probe* p = sim->probe(address);
+  // Like the sensor, NACK the read until the measurement is done
+  if (!p || len != 6 || !p->measuring || sim->nowMs - p->startedAt < Sht31Sensor::MEASURE_MS) return false;
+  p->measuring = false;
+
+  // The element follows the air at its height with a first-order lag
+  float dt = (sim->nowMs - p->lastUpdate) / 1000.0f;
+  p->lastUpdate = sim->nowMs;
+  float k = 1.0f - expf(-dt / SENSOR_TIME_CONSTANT);
+  p->temperature += (sim->plant.temperatureAt(p->height) - p->temperature) * k;
+  p->humidity += (sim->plant.humidityAt(p->height) - p->humidity) * k;
+
+  float t = p->temperature + sim->noise(TEMPERATURE_NOISE);
+  float h = p->humidity + sim->noise(HUMIDITY_NOISE);
+  float rawT = (t + 45.0f) / 175.0f * 65535.0f;
+  float rawH = h / 100.0f * 65535.0f;
+  uint16_t words[2] = {
+    (uint16_t)(rawT < 0 ? 0 : rawT > 65535 ? 65535 : lroundf(rawT)),
+    (uint16_t)(rawH < 0 ? 0 : rawH > 65535 ? 65535 : lroundf(rawH)),
+  };
+  for (int i = 0; i < 2; i++) {
+    data[i * 3] = words[i] >> 8;
+    data[i * 3 + 1] = words[i] & 0xFF;
+    data[i * 3 + 2] = crc8(data + i * 3, 2);
+  }
+  return true;
+}
+
+void DryerSimulation::writeHeater(bool on, void* ctx) {
+  ((DryerSimulation*)ctx)->heaterPin = on;
+}
+
+void DryerSimulation::onLog(void* ctx, const DryerZone&, LogEvent event, uint8_t) {
+  DryerSimulation* sim = (DryerSimulation*)ctx;
+  if (event < LOG_EVENT_COUNT) sim->events[event]++;
+  if (sim->verbose && event != LOG_STATUS) {
+    printf("%8.1f min  %s\n", sim->nowMs / 60000.0, logEventName(event));
+  }
+}
+
+void DryerSimulation::onMessage(void* ctx, const DryerZone&, ZoneMessage type, const char* text) {
+  DryerSimulation* sim = (DryerSimulation*)ctx;
+  if (sim->verbose && type != ZONE_MSG_DISPLAY) printf("%8.1f min  %s\n", sim->nowMs / 60000.0, text);
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "ChamberPlant.h"
+#include "ChamberProbes.h"
+#include "DryerZone.h"
+#include "TimeProportionalOutput.h"
+
+// One dryer zone of the firmware run against a ChamberPlant in simulated time.
+//
+// The controller side is the firmware's own code: SHT31 drivers, ChamberProbes and its
+// filters, DryerZone and the time-proportioned heater output. They are driven on the
+// schedule of the control task in src/main.cpp (probes every 250 ms tick, humidity
+// trend every 2 s, a control step every second) and the heater timer (10 ms). The
+// probes answer on an emulated I2C bus with the plant's temperature and humidity at
+// their height, plus sensor lag and noise.
+class DryerSimulation {
+public:
+  // As in src/main.cpp
+  static const uint32_t CONTROL_TICK_MS = 250;
+  static const uint32_t CONTROL_TICKS = 4;
+  static const uint32_t RECORD_TICKS = 8;
+  static const uint32_t HEATER_WINDOW_MS = 10000;
+  static const uint32_t HEATER_MIN_ON_MS = 1000;
+  static const uint32_t HEATER_MIN_OFF_MS = 1000;
+  static const uint32_t HEATER_TICK_MS = 10;
+
+  struct StatusChange {
+    uint32_t timeMs;
+    ProcessStatus status;
+  };
+
+  explicit DryerSimulation(const ChamberPlantConfig& plant = ChamberPlantConfig(), uint32_t seed = 1);
+
+  // Prints logs, messages and status changes as they happen
+  void setVerbose(bool verbose) { this->verbose = verbose; }
+
+  // Advances simulated time by ms
+  void run(uint32_t ms);
+
+  // Advances until condition(*this) holds after a control step, at most maxMs.
+  // Returns whether it did.
+  template <typename Condition>
+  bool runUntil(Condition condition, uint32_t maxMs) {
+    uint32_t end = nowMs + maxMs;
+    while ((int32_t)(end - nowMs) > 0) {
+      if (advance() && condition(*this)) return true;
+    }
+    return false;
+  }
+
+  // Web commands, applied as applyControlCommand() does
+  void setSettings(const PresetValues& settings) { dryer.setSettings(settings); }
+  void selectMode(Mode mode) { dryer.selectMode(mode, nowMs); }
+  void setEnabled(bool enabled) { dryer.setEnabled(enabled); }
+
+  uint32_t now() const { return nowMs; }
+  DryerZone& zone() { return dryer; }
+  ChamberPlant& chamber() { return plant; }
+  const TimeProportionalOutput& heater() const { return output; }
+  const std::vector<StatusChange>& statusTrace() const { return trace; }
+  bool sawStatus(ProcessStatus status, uint32_t sinceMs = 0) const;
+  uint32_t eventCount(LogEvent event) const { return events[event]; }
+
+private:
+  struct Probe {
+    uint8_t address;
+    float height;
+    float temperature; // Lagged reading of the sensor element
+    float humidity;
+    bool measuring;
+    uint32_t startedAt;
+    uint32_t lastUpdate;
+  };
+
+  bool advance(); // One heater tick; true if a control step ran
+  float noise(float sigma);
+  Probe* probe(uint8_t address);
+
+  static bool busWrite(void* ctx, uint8_t address, const uint8_t* data, size_t len);
+  static bool busRead(void* ctx, uint8_t address, uint8_t* data, size_t len);
+  static void writeHeater(bool on, void* ctx);
+  static void onLog(void* ctx, const DryerZone& zone, LogEvent event, uint8_t detail);
+  static void onMessage(void* ctx, const DryerZone& zone, ZoneMessage type, const char* text);
+
+  ChamberPlant plant;
+  Probe probes[2];
+  ProbeConfig probeConfigs[2];
+  ChamberProbes sensors;
+  DryerZone dryer;
+  TimeProportionalOutput output;
+  bool heaterPin;
+  uint32_t nowMs;
+  uint32_t tick;
+  uint32_t random;
+  bool verbose;
+  uint32_t events[LOG_EVENT_COUNT];
+  std::vector<StatusChange> trace;
+};
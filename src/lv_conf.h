@@ -16,7 +16,7 @@
 #define LV_COLOR_DEPTH     16
 
 /*Swap the 2 bytes of RGB565 color. Useful if the display has a different byte order.*/
-#define LV_COLOR_16_SWAP   0
+#define LV_COLOR_16_SWAP   1
 
 /*Enable features to draw on transparent background.
  *It's required if you need transparent charts, labels, etc.
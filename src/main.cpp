@@ -1,177 +1,450 @@
 #include <Arduino.h>
 #include <lvgl.h>
 #include <TFT_eSPI.h>
-#include <deque>
 #include <Wire.h>
-#include "Adafruit_SHT31.h"
 #include <WiFi.h>
 #include <ESPAsyncWebServer.h>
 #include "SPIFFS.h"
-#include <ArduinoJson.h>
+#include "HumidityRateWindow.h"
+#include "PidController.h"
+#include "TimeProportionalOutput.h"
+#include "ThermalModel.h"
+#include "PredictiveWarmup.h"
+#include "SetpointRunStats.h"
+#include "TelemetrySnapshot.h"
+#include "LogFrame.h"
+#include "LogStore.h"
+#include "HistoryRollup.h"
+#include "PresetCodec.h"
+#include "Checksum.h"
+#include "CommandQueue.h"
+#include "EventBus.h"
+#include "PeriodStats.h"
+#include "PresetStore.h"
+#include "PresetTable.h"
+#include "Seqlock.h"
+#include "ChamberProbes.h"
+#include "DryerZone.h"
+#include "I2cMux.h"
+#include "MetricsWriter.h"
+#include <atomic>
+#include <memory>
+#include <time.h>
+#include <esp_timer.h>
 
 /* LVGL Globals */
 TFT_eSPI tft = TFT_eSPI();
 static const uint16_t screenWidth  = 320;
 static const uint16_t screenHeight = 240;
+static const uint16_t drawBufLines = 10;
 static lv_disp_draw_buf_t draw_buf;
-static lv_color_t buf[screenWidth * 10];
+static lv_disp_drv_t disp_drv;
+// Two buffers: LVGL renders into one while DMA sends the other to the display. Both are
+// in internal RAM, which the SPI DMA can read. LV_COLOR_16_SWAP makes LVGL render in
+// the panel's byte order, so nothing is swapped at flush time.
+static lv_color_t buf1[screenWidth * drawBufLines];
+static lv_color_t buf2[screenWidth * drawBufLines];
+static bool useDma = false;               // Set once initDMA() succeeds
+static bool flushInFlight = false;
+static int64_t flushWaitUs = 0;           // Time LVGL spent waiting for DMA to finish
+
+/* Zones */
+// One chamber per zone, each with its own SHT31 probes, heater SSR and preset. The
+// control task steps the zones in turn; the web API takes a zone parameter (0 when
+// left out) and the TFT shows the zones one after another. A zone needs about 30 KB of
+// RAM, mostly history.
+//
+// Probes that do not answer at startup are left out, so the same table works with one
+// probe per zone or several. Probes behind the TCA9548A mux (0x70) give its channel;
+// the heights give each chamber's top-to-bottom gradient.
+struct ZoneConfig {
+  const char* name;
+  int heaterPin;
+  const ProbeConfig* probes;
+  size_t probeCount;
+};
+const ProbeConfig ZONE1_PROBES[] = {
+  // mux channel, address, height (cm above the floor)
+  { -1, 0x44, 5.0f },
+  { -1, 0x45, 25.0f },
+};
+// Further chambers go behind the mux, e.g. { { 0, 0x44, 5.0f }, { 0, 0x45, 25.0f } }
+// on channel 0 for the second one.
+const ZoneConfig ZONES[] = {
+  { "Dryer 1", 1, ZONE1_PROBES, sizeof(ZONE1_PROBES) / sizeof(ZONE1_PROBES[0]) }, // GPIO 1 (TX) drives the ZGT-25 DA relay
+  // { "Dryer 2", 25, ZONE2_PROBES, sizeof(ZONE2_PROBES) / sizeof(ZONE2_PROBES[0]) },
+  // { "Dryer 3", 26, ZONE3_PROBES, sizeof(ZONE3_PROBES) / sizeof(ZONE3_PROBES[0]) },
+  // { "Dryer 4", 32, ZONE4_PROBES, sizeof(ZONE4_PROBES) / sizeof(ZONE4_PROBES[0]) },
+};
+const size_t ZONE_COUNT = sizeof(ZONES) / sizeof(ZONES[0]);
 
 /* Sensor Globals */
-Adafruit_SHT31 sht31 = Adafruit_SHT31();
-float currentTemperature = 0.0; // Global to store latest temp
-float currentHumidity = 0.0;    // Global to store latest hum
-float humidityRate = 0.0;       // % per hour
-
-struct HumidityReading {
-  uint32_t timestamp;
-  float humidity;
+// A measurement is started on every control task tick and collected on the next, so the
+// task never waits for a probe. Each probe and channel is filtered with
+// PROBE_TEMPERATURE_FILTER / PROBE_HUMIDITY_FILTER (ChamberProbes.h).
+bool wireWrite(void* ctx, uint8_t address, const uint8_t* data, size_t len);
+bool wireRead(void* ctx, uint8_t address, uint8_t* data, size_t len);
+const uint32_t I2C_CLOCK_HZ = 400000; // Keeps a tick's probe reads short with four zones
+I2cMux mux(wireWrite, nullptr);        // Only used if a probe gives a mux channel
+
+// Per-probe readings for /probes, published by the control task
+struct ProbeSnapshot {
+  uint8_t controlPoint;
+  ChamberReading chamber;
+  ProbeReading probes[ChamberProbes::MAX_PROBES];
+  ExecTiming timing; // The zone's probe reads per tick, bus transfers included
 };
-// Use a deque to store the last 30 minutes of humidity readings (approx)
-std::deque<HumidityReading> humidityHistory;
 
-/* Hardware Pins */
-const int HEATER_PIN = 1; // GPIO 1 (TX pin) for the ZGT-25 DA relay
-bool isHeaterOn = false;  // Tracks the actual state of the heater relay
+/* Heater Output Stage */
+// Each zone's duty is time-proportioned onto its SSR from one esp_timer, independent of
+// the control task.
+const uint32_t HEATER_WINDOW_MS = 10000;     // Time-proportioning window
+const uint32_t HEATER_MIN_ON_MS = 1000;      // Shortest ON pulse sent to the SSR
+const uint32_t HEATER_MIN_OFF_MS = 1000;     // Shortest OFF gap sent to the SSR
+const uint32_t HEATER_TIMER_PERIOD_US = 10000; // 10 ms = one mains half-cycle at 50 Hz
+void writeHeaterPin(bool on, void* context);
+esp_timer_handle_t heaterTimer = nullptr;
 
 /* Network Globals */
 #include "wifi_credentials.h" // Your WiFi credentials should be in this file
 AsyncWebServer server(80);
 AsyncWebSocket ws("/ws"); // Create a WebSocket object
+char telemetryFrame[1024]; // Delta frame buffer (writer task only)
 
 
 /* Settings & State */
-struct Preset {
-  String name;
-  String notes;
-  bool isDefault = false;
-  float dryingTemp;
-  float setpointHum;
-  float warmTemp;
-  float humHyst;
-  uint32_t stallInterval;
-  float stallDelta;
-  uint32_t heatDur;
-  int heatAction;
-  uint32_t logInt;
-  int mode; // 0=Dry, 1=Heat, 2=Warm
-
-  // Default constructor (important for std::vector and other contexts)
-  Preset() : name(""), notes(""), isDefault(false), dryingTemp(0.0f), setpointHum(0.0f),
-             warmTemp(0.0f), humHyst(0.0f), stallInterval(0U), stallDelta(0.0f),
-             heatDur(0U), heatAction(0), logInt(0U) {}
-
-  // Parameterized constructor for easy initialization
-  Preset(String _name, String _notes, bool _isDefault, float _dryingTemp, float _setpointHum,
-         float _warmTemp, float _humHyst, uint32_t _stallInterval,
-         float _stallDelta, uint32_t _heatDur, int _heatAction, uint32_t _logInt, int _mode)
-    : name(_name), notes(_notes), isDefault(_isDefault), dryingTemp(_dryingTemp), 
-      setpointHum(_setpointHum), warmTemp(_warmTemp), humHyst(_humHyst), stallInterval(_stallInterval),
-      stallDelta(_stallDelta), heatDur(_heatDur), heatAction(_heatAction), logInt(_logInt),
-      mode(_mode) {}
+// Names, notes and settings in one heap block with a hashed name index
+PresetTable presets;
+// Edits are appended to a journal next to presets.json rather than rewriting the file
+PresetStore presetStore(presets, "/spiffs");
+// The web handlers (async_tcp) and the writer task both edit presets, and put, rename
+// and reserve move the table's heap block, so every use of presets or presetStore
+// after setup() holds this lock, for the table access only: replies are sent after it is
+// released. The control task never takes it: presets reach it as commands and
+// identified models leave it through the writer.
+SemaphoreHandle_t presetMutex = nullptr;
+struct PresetLock {
+  PresetLock() { xSemaphoreTake(presetMutex, portMAX_DELAY); }
+  ~PresetLock() { xSemaphoreGive(presetMutex); }
 };
 
-std::vector<Preset> presets;
-
-float dryingTemperature = 50.0;
-float setpointHumidity = 30.0;
-float warmTemperature = 35.0;
-float humidityHysteresis = 5.0; // %RH to allow humidity to rise before re-engaging drying
-// Stall settings are no longer used for process control but are kept for future UI reporting.
-uint32_t stallCheckInterval = 1800000; // 30 minutes in ms
-float stallHumidityDelta = 0.5; // %RH drop
-uint32_t heatDuration = 240 * 60000; // 4 hours in milliseconds
-uint32_t heatStartTime = 0;
-
-enum State {
-  STATE_IDLE,
-  STATE_DRYING,
-  STATE_HEATING,
-  STATE_WARMING
-};
-enum Mode {
-  MODE_DRY,
-  MODE_HEAT,
-  MODE_WARM
+// Pulls /presets/list (summaries) or /presets/download (whole presets) out of
+// PresetWriter one preset at a time for a chunked response.
+struct PresetListStream {
+  PresetWriter writer;
+  bool full;            // Whole presets, as in presets.json
+  size_t index = 0;     // Next preset to write
+  bool started = false;
+  bool done = false;
+  char text[2560];      // One preset; fits the longest escaped name and notes
+  size_t len = 0, offset = 0;
+
+  explicit PresetListStream(bool full) : writer(append, this), full(full) {}
+
+  static size_t append(void *ctx, const char *data, size_t n) {
+    PresetListStream *self = (PresetListStream *)ctx;
+    if (self->len + n > sizeof(self->text)) return 0;
+    memcpy(self->text + self->len, data, n);
+    self->len += n;
+    return n;
+  }
+
+  size_t fill(uint8_t *buffer, size_t maxLen);
 };
-enum HeatCompletionAction {
-  ACTION_STOP,
-  ACTION_WARM
+/* Control Task */
+// Sensing and control run in their own FreeRTOS task, pinned to the core loop() does
+// not run on, so LVGL rendering and SPI flushes cannot delay a heater decision. The
+// task is released every CONTROL_TICK_MS by the FreeRTOS tick and samples every zone's
+// probes each time. Each zone steps its controller every CONTROL_TICKS ticks, the zones
+// on different ticks, so up to CONTROL_TICKS zones add no more to a tick than one does.
+const uint32_t CONTROL_TICK_MS = 250;
+const uint32_t CONTROL_TICKS = 4;              // Control step once a second
+const uint32_t RECORD_TICKS = 8;               // History and humidity trend every 2 s
+const uint32_t CONTROL_TASK_STACK = 8192;
+const UBaseType_t CONTROL_TASK_PRIORITY = 5;   // Above async_tcp (3) and loop() (1)
+TaskHandle_t controlTaskHandle = nullptr;
+PeriodStats controlStats(CONTROL_TICK_MS * 1000); // Control task only
+Seqlock<PeriodTiming> controlTiming;                // Published copy, for /control/timing
+
+/* Writer Task */
+// Flash writes, WebSocket sends and serial output can each block for milliseconds, so
+// the control task only publishes snapshots and queues log records. This task, on
+// loop()'s core at loop()'s priority, does the writing; the control task wakes it at
+// the end of every tick.
+const uint32_t WRITER_TASK_STACK = 8192;
+const UBaseType_t WRITER_TASK_PRIORITY = 1;    // As loop()
+const uint32_t WRITER_IDLE_MS = 1000;          // Runs at least this often without a wake-up
+TaskHandle_t writerTaskHandle = nullptr;
+
+/* Web -> Control Task */
+// The web server runs in the async_tcp task. Web setters do not write the controller
+// globals; they queue a command that the control task applies at the start of its
+// next period. Web readers use each zone's settingsSnapshot.
+enum ControlCommandType : uint8_t {
+  CMD_SET_DRYING_TEMP,
+  CMD_SET_HUM_SETPOINT,
+  CMD_SET_WARM_TEMP,
+  CMD_SET_HUM_HYST,
+  CMD_SET_STALL_INTERVAL,
+  CMD_SET_STALL_DELTA,
+  CMD_SET_MODE,
+  CMD_SET_HEAT_DURATION,
+  CMD_SET_HEAT_ACTION,
+  CMD_SET_CONTROL,
+  CMD_SET_CONTROL_POINT,
+  CMD_SET_PID_KP,
+  CMD_SET_PID_KI,
+  CMD_SET_PID_KD,
+  CMD_SET_LOG_INTERVAL,
+  CMD_TOGGLE_ENABLE,
+  CMD_START_LOG,
+  CMD_STOP_LOG,
+  CMD_APPLY_PRESET,   // name, preset
+  CMD_PRESET_RENAMED, // name -> newName
 };
-enum TransitionReason {
-  REASON_NONE,
-  REASON_USER_ACTION,
-  REASON_TARGET_MET,
-  REASON_STALLED,
-  REASON_TIMER_EXPIRED
+struct ControlCommand {
+  ControlCommandType type;
+  uint8_t zone;
+  double value; // Holds any uint32_t exactly
+  PresetValues preset;
+  char name[PRESET_NAME_MAX + 1];
+  char newName[PRESET_NAME_MAX + 1];
 };
-State currentState = STATE_IDLE;
-Mode selectedMode = MODE_DRY; // Default to Dry mode
-HeatCompletionAction heatCompletionAction = ACTION_STOP;
-TransitionReason lastTransitionReason = REASON_NONE;
-bool isHeaterEnabled = false; // Master switch for the heating process, OFF by default for safety
-
-bool isStalled = false; // Informational flag for UI and logging
+CommandQueue<ControlCommand, 16> controlCommands;
 
 /* Logging State */
 bool isWebClientConnected = false;
 bool ipMessageCleared = false;
 bool isLoggingEnabled = false;
 uint32_t loggingStartTime = 0;
-uint32_t logIntervalMillis = 60000; // Default 1 minute
-uint32_t lastTimedLogTime = 0;
+uint32_t logSequence = 0;
+
+// WebSocket clients and the log format each asked for. Clients start on CSV text and
+// switch to binary LogFrame records by sending "log:binary".
+const size_t MAX_LOG_CLIENTS = 8; // DEFAULT_MAX_WS_CLIENTS
+struct LogClient {
+  uint32_t id; // 0 = free slot
+  bool binary;
+};
+LogClient logClients[MAX_LOG_CLIENTS];
+
+/* Persistent Log */
+// Kept on SPIFFS whether or not a browser is logging. Heater ON/OFF events are left out:
+// the SSR pulses every time-proportioning window, and the duty is in each sample instead.
+LogStore logStore("/spiffs");
+const uint32_t STORE_SAMPLE_INTERVAL_MS = 60000;  // One TIMED record per minute
+const uint32_t STORE_FLUSH_INTERVAL_MS = 600000;  // Write a partial batch at least every 10 min
+uint32_t lastStoreFlushTime = 0; // Writer task only
+
+/* Control Task -> Writer Task */
+// Log records as the control task captured them, written out in order by the writer.
+enum LogJobType : uint8_t {
+  LOG_JOB_RECORD,
+  LOG_JOB_START, // A browser log starts: each zone's settings and the CSV header
+};
+struct LogJob {
+  LogJobType type;
+  bool store;             // Append stored to logStore
+  bool send;              // Send record to the logging browsers and the serial port
+  StoredLogRecord stored;
+  LogRecord record;
+};
+CommandQueue<LogJob, 32> logJobs;
 
-enum MessageType { MSG_INFO, MSG_ERROR };
-struct WebMessage {
-  String text;
-  MessageType type;
+// A model from an Identify run, to be saved in the preset the zone was running
+struct IdentifiedModel {
+  char preset[PRESET_NAME_MAX + 1];
+  FopdtModel model;
 };
+CommandQueue<IdentifiedModel, 4> identifiedModels;
 
-/* Web Message Queue */
-std::vector<WebMessage> webMessageQueue;
+// WebSocket clients that have just connected, for the writer to send the full telemetry
+CommandQueue<uint32_t, 8> joinedClients;
+std::atomic<bool> resendTelemetry(false); // Too many joined at once: send everyone every field
+
+enum MessageType { MSG_INFO, MSG_ERROR };
+
+/* Event Bus */
+// Web messages and message box text, published from any task; the TFT, the serial log
+// and each browser read it with their own cursor.
+EventBus events;
+EventCursor displayCursor;
+EventCursor serialCursor;
+std::atomic<uint32_t> displayMissed(0); // The cursors' missed counts, for /metrics
+std::atomic<uint32_t> serialMissed(0);
+std::atomic<uint32_t> lastWebMessageHash(0);
+std::atomic<uint32_t> lastDisplayHash(0);
+
+/* Control Task -> Display */
+// What the TFT shows of the controller, published at the end of every control period
+// and drawn by display_task on the LVGL loop. LVGL itself is only touched from there.
+struct DisplayValues {
+  float temperature; // NAN after a failed read
+  float humidity;
+  float dryingTemp;
+  float setpointHum;
+  uint8_t status;    // ProcessStatus
+  bool heaterOn;
+  bool hasReading;   // False until the sensor has been read once
+};
+const uint32_t ZONE_SHOW_MS = 5000; // How long the TFT shows each zone when there are several
 
 /* UI Object Globals */
-String currentStatusString = "IDLE";
-lv_obj_t * temp_label_value;
-lv_obj_t * hum_label_value;
-lv_obj_t * message_label;
-lv_obj_t * setpoint_label_value;
-lv_obj_t * heater_status_label;
-lv_obj_t * state_label;
-lv_obj_t * hum_setpoint_label_value;
 static lv_style_t style_error;
 
+/* Display View */
+// What each dynamic label last showed. A label is only handed to LVGL, which
+// invalidates and redraws its area, when its formatted text or its look changes; a
+// steady chamber then causes no redraws and no SPI traffic at all.
+enum LabelLook : uint8_t {
+  LOOK_NORMAL,
+  LOOK_ERROR,      // style_error
+  LOOK_HEATER_ON,  // Red
+  LOOK_HEATER_OFF, // Grey
+};
+struct LabelView {
+  lv_obj_t * label;
+  char text[sizeof(BusEvent::text)];
+  uint8_t look;
+};
+LabelView titleView, tempView, humView, messageView, setpointView, heaterView, stateView, humSetpointView;
+
+// Redraw counters, kept on the LVGL loop and published once a second
+struct DisplayStats {
+  uint32_t invalidationsPerSec; // LVGL calls that invalidated a label
+  uint32_t pixelsPerSec;        // Pixels sent to the panel
+  uint32_t invalidations;       // Totals since boot
+  uint32_t pixels;
+};
+uint32_t labelInvalidations = 0;
+uint32_t flushedPixels = 0;
+Seqlock<DisplayStats> displayStats;
+
+/* Zone State */
+typedef TelemetrySnapshot<1024> ReadingsSnapshot; // Pre-serialized /readings body
+
+// Everything that exists once per chamber. The control task owns the controller, the
+// probes and the bookkeeping; other tasks only read the published copies.
+struct Zone {
+  const ZoneConfig* config = nullptr;
+  uint8_t index = 0;
+  DryerZone dryer;
+  ChamberProbes probes;
+  TimeProportionalOutput heater;
+  bool isHeaterOn = false;      // Relay state as last reported
+  uint32_t sensorReads = 0;     // Read attempts so far
+  ExecTiming sensorTiming = {}; // Time in probes.service(), published with the probe snapshot
+  String activePresetName = ""; // Preset last applied; receives the results of an Identify run
+  uint32_t lastTimedLogTime = 0;
+  uint32_t lastStoreSampleTime = 0;
+  std::atomic<uint32_t> lastStepUs{0}; // Sensing and control of this zone in one tick
+  std::atomic<uint32_t> maxStepUs{0};
+
+  // Raw, 1 min and 15 min tiers in fixed RAM, fed by the control task; served by /history.
+  HistoryRollup history;
+
+  // Published by the control task
+  TelemetryText telemetryText;              // Field texts of the latest control step
+  ReadingsSnapshot readingsSnapshot;        // Copied out by /readings and new WebSocket clients
+  Seqlock<TelemetryValues> telemetryValues; // Pushed to the WebSocket clients by the writer task
+  Seqlock<PresetValues> settingsSnapshot;   // The live settings, republished every step
+  Seqlock<DisplayValues> displaySnapshot;
+  Seqlock<ProbeSnapshot> probeSnapshot;
+
+  // Writer task only
+  TelemetryDelta telemetryDelta;            // Fields last pushed over the WebSocket
+  uint32_t pushedTelemetry = 0;             // telemetryValues version last pushed
+
+  Zone() : heater(HEATER_WINDOW_MS, HEATER_MIN_ON_MS, HEATER_MIN_OFF_MS, writeHeaterPin, this) {}
+};
+Zone zones[ZONE_COUNT];
+
 /* Forward Declarations */
 void my_disp_flush(lv_disp_drv_t *disp, const lv_area_t *area, lv_color_t *color_p);
+void my_disp_wait(lv_disp_drv_t *disp);
+void display_flush_poll();
+#ifdef DISPLAY_BENCH
+void runDisplayBench();
+#endif
 void onWsEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len);
 void setupWiFi();
 void setupWebServer();
 void setupHardwarePins();
+void heaterTimerCallback(void* arg);
 void ui_init();
-void update_humidity_setpoint_display();
+void update_humidity_setpoint_display(float setpoint);
 void loadPresets();
-void savePresets();
-void applyPreset(const Preset& preset);
-void update_setpoint_display();
-void update_process_status_display();
-void update_heater_status_display();
-void calculateHumidityRate();
+void reportPresetWrite(bool ok);
+void applyPreset(Zone& zone, const char* name, const PresetValues& preset);
+void update_setpoint_display(float setpoint);
+void update_process_status_display(ProcessStatus status);
+void update_heater_status_display(bool on);
+void update_sensor_display(float t, float h);
+void view_set(LabelView& view, const char* text, LabelLook look = LOOK_NORMAL);
+void display_stats_task(lv_timer_t * timer);
+void display_task(lv_timer_t * timer);
+void publishDisplay(Zone& zone);
+void sendLog(Zone& zone, LogEvent event, uint8_t detail = 0);
+void storeLog(Zone& zone, LogEvent event, uint8_t detail = 0);
 void update_message_box(const char* message);
+void event_bus_task(lv_timer_t * timer);
+void publishTelemetry(Zone& zone);
 void heater_enable_switch_event_handler(lv_event_t * e);
+void setupZones();
 void setupSensor();
-void update_sensor_task(lv_timer_t * timer);
-void controlHeaterTask(lv_timer_t * timer);
+void controlTask(void* arg);
+void writerTask(void* arg);
+void writeLogJob(const LogJob& job);
+void sendLogSetup();
+void saveIdentifiedModel(const IdentifiedModel& identified);
+void pushTelemetry();
+void serviceSensor(Zone& zone);
+void recordReading(Zone& zone);
+void controlZone(Zone& zone);
+void serviceLogStore();
+void applyControlCommands();
+void applyControlCommand(const ControlCommand& command);
+void startLogging();
+void logToWeb(const char* message, MessageType type = MSG_INFO);
 void logToWeb(String message, MessageType type = MSG_INFO);
+uint32_t uptimeSeconds();
+void runTimedLvTimer(lv_timer_t * timer);
+
+/* LVGL Timers */
+// The work on the LVGL loop, timed for /metrics. Each run is recorded by the loop and
+// published through a Seqlock, which costs a few word stores.
+struct TimedLvTimer {
+  const char* name;
+  lv_timer_cb_t callback;
+  uint32_t periodMs;
+  ExecTiming timing;             // LVGL loop only
+  Seqlock<ExecTiming> published;
+};
+TimedLvTimer lvTimers[] = {
+  { "display", display_task, 100 },             // Show what the controller publishes
+  { "display_stats", display_stats_task, 1000 },
+  { "event_bus", event_bus_task, 100 },         // Show and log bus events
+};
+TimedLvTimer lvHandler = { "lv_timer_handler", nullptr, 0 }; // Whole passes, LVGL's own rendering included
 
-void logToWeb(String message, MessageType type) {
+// Seconds since boot from the 64-bit timer, so it does not wrap with millis()
+uint32_t uptimeSeconds() {
+  return (uint32_t)(esp_timer_get_time() / 1000000);
+}
+
+// Safe from any task, the control task included: nothing is allocated.
+void logToWeb(const char* message, MessageType type) {
   // Prevent queuing the same message consecutively.
   // This stops floods of identical messages (e.g., from a sensor error).
-  if (!webMessageQueue.empty() && webMessageQueue.back().text == message) {
+  uint32_t h = fnv1a(message) ^ type;
+  if (lastWebMessageHash.exchange(h) == h) {
     return; // Don't add duplicate message
   }
+  events.publish(type == MSG_ERROR ? EVENT_ERROR : EVENT_INFO, message);
+}
 
-  if (webMessageQueue.size() < 10) { // Limit queue size to prevent memory issues
-    webMessageQueue.push_back({message, type});
-  }
+void logToWeb(String message, MessageType type) {
+  logToWeb(message.c_str(), type);
 }
 
 void setup() {
@@ -180,6 +453,8 @@ void setup() {
   // --- TFT_eSPI Display Initialization ---
   tft.begin();
   tft.setRotation(1);
+  useDma = tft.initDMA();
+  tft.startWrite(); // The display is alone on its SPI bus, so keep it selected for DMA
 
   // Backlight workaround (must be after tft.begin())
   ledcSetup(0, 5000, 8);
@@ -193,14 +468,15 @@ void setup() {
   if(!SPIFFS.begin(true)){
     // We can't log here as UI isn't ready, but this prevents a crash.
   }
-  lv_disp_draw_buf_init(&draw_buf, buf, NULL, screenWidth * 10);
+  logStore.begin(); // Carry on the record sequence from the last boot
+  lv_disp_draw_buf_init(&draw_buf, buf1, buf2, screenWidth * drawBufLines);
 
   /*Initialize the display*/
-  static lv_disp_drv_t disp_drv;
   lv_disp_drv_init(&disp_drv);
   disp_drv.hor_res = screenWidth;
   disp_drv.ver_res = screenHeight;
   disp_drv.flush_cb = my_disp_flush;
+  disp_drv.wait_cb = my_disp_wait;
   disp_drv.draw_buf = &draw_buf;
   lv_disp_drv_register(&disp_drv);
 
@@ -209,6 +485,8 @@ void setup() {
   ui_init();
 
   // --- Load Presets ---
+  presetMutex = xSemaphoreCreateMutex();
+  setupZones();
   loadPresets();
 
   // --- Hardware Pin Setup ---
@@ -219,149 +497,281 @@ void setup() {
 
   // --- Network Initialization ---
   setupWiFi();
+  for (Zone& zone : zones) {
+    publishTelemetry(zone); // So /readings has a body before the first control tick
+    publishDisplay(zone);
+    zone.settingsSnapshot.store(zone.dryer.getSettings());
+  }
   setupWebServer();
 
-  // --- Create a task to update sensor data ---
-  lv_timer_create(update_sensor_task, 2000, NULL);
+  // --- Create the LVGL timers: display, redraw stats and bus events ---
+  for (TimedLvTimer& t : lvTimers) {
+    lv_timer_create(runTimedLvTimer, t.periodMs, &t);
+  }
+
+#ifdef DISPLAY_BENCH
+  runDisplayBench();
+#endif
 
-  // --- Create a task to control the heater ---
-  lv_timer_create(controlHeaterTask, 1000, NULL); // Run thermostat logic every second
+  // --- Start the writer for flash, WebSocket and serial output on this core ---
+  if (xTaskCreatePinnedToCore(writerTask, "writer", WRITER_TASK_STACK, NULL,
+                              WRITER_TASK_PRIORITY, &writerTaskHandle, xPortGetCoreID()) != pdPASS) {
+    update_message_box("Writer task failed!");
+    logToWeb("CRITICAL: Writer task failed to start!", MSG_ERROR);
+  }
+
+  // --- Start sensing and control on the other core ---
+  BaseType_t controlCore = xPortGetCoreID() == 0 ? 1 : 0;
+  if (xTaskCreatePinnedToCore(controlTask, "control", CONTROL_TASK_STACK, NULL,
+                              CONTROL_TASK_PRIORITY, &controlTaskHandle, controlCore) != pdPASS) {
+    update_message_box("Control task failed!");
+    logToWeb("CRITICAL: Control task failed to start!", MSG_ERROR);
+  }
 }
 
 void loop() {
+  display_flush_poll(); // Hand back a buffer whose DMA finished while we slept
+  int64_t startUs = esp_timer_get_time();
   lv_timer_handler(); // let the LVGL timer handler do the work
+  lvHandler.timing.record((uint32_t)(esp_timer_get_time() - startUs));
+  lvHandler.published.store(lvHandler.timing);
   delay(5);
 }
 
-void applyPreset(const Preset& preset) {
-  dryingTemperature = preset.dryingTemp;
-  setpointHumidity = preset.setpointHum;
-  warmTemperature = preset.warmTemp;
-  humidityHysteresis = preset.humHyst;
-  stallCheckInterval = preset.stallInterval;
-  stallHumidityDelta = preset.stallDelta;
-  heatDuration = preset.heatDur;
-  heatCompletionAction = (HeatCompletionAction)preset.heatAction;
-  logIntervalMillis = preset.logInt;
-  selectedMode = (Mode)preset.mode; // Apply the mode from the preset
-
-  // Update any relevant UI elements immediately
-  update_setpoint_display();
-  update_humidity_setpoint_display();
+void runTimedLvTimer(lv_timer_t * timer) {
+  TimedLvTimer& t = *(TimedLvTimer *)timer->user_data;
+  int64_t startUs = esp_timer_get_time();
+  t.callback(timer);
+  t.timing.record((uint32_t)(esp_timer_get_time() - startUs));
+  t.published.store(t.timing);
+}
+
+void applyPreset(Zone& zone, const char* name, const PresetValues& preset) {
+  zone.dryer.setSettings(preset); // Mode included
+  zone.activePresetName = name;
+  // The display picks up the new setpoints from the next publishDisplay()
+}
+
+// Every zone starts on the same preset; each can be given its own from the web page
+static void applyPresetToAll(const char* name, const PresetValues& preset) {
+  for (Zone& zone : zones) {
+    applyPreset(zone, name, preset);
+  }
 }
 
 void loadPresets() {
-  File file = SPIFFS.open("/presets.json", "r");
-  if (!file || file.size() == 0) {
+  if (!presetStore.load()) {
     logToWeb("Presets file not found. Creating defaults.");
     // Create default presets
     presets.clear();
-    Preset p1("PLA - Generic", "Standard PLA drying settings.", true, 50.0f, 30.0f, 35.0f, 5.0f, 30 * 60000U, 0.5f, 4 * 3600000U, 0, 1 * 60000U, 0); // Dry Mode
-    Preset p2("PETG - Strong", "Aggressive PETG drying.", false, 65.0f, 15.0f, 40.0f, 3.0f, 60 * 60000U, 0.2f, 8 * 3600000U, 1, 5 * 60000U, 0); // Dry Mode
-    presets.push_back(p1);
-    presets.push_back(p2);
-    savePresets();
-    applyPreset(p1); // Apply the first default
+    PresetValues p1;
+    p1.setDefaults();
+    p1.isDefault = true;
+    p1.dryingTemp = 50.0f; p1.setpointHum = 30.0f; p1.warmTemp = 35.0f; p1.humHyst = 5.0f;
+    p1.stallInterval = 30 * 60000U; p1.stallDelta = 0.5f; p1.heatDur = 4 * 3600000U;
+    p1.heatAction = 0; p1.logInt = 1 * 60000U; p1.mode = 0; // Dry Mode
+    PresetValues p2 = p1;
+    p2.isDefault = false;
+    p2.dryingTemp = 65.0f; p2.setpointHum = 15.0f; p2.warmTemp = 40.0f; p2.humHyst = 3.0f;
+    p2.stallInterval = 60 * 60000U; p2.stallDelta = 0.2f; p2.heatDur = 8 * 3600000U;
+    p2.heatAction = 1; p2.logInt = 5 * 60000U; p2.mode = 0; // Dry Mode
+    presets.put("PLA - Generic", "Standard PLA drying settings.", p1);
+    presets.put("PETG - Strong", "Aggressive PETG drying.", p2);
+    reportPresetWrite(presetStore.compact());
+    applyPresetToAll("PLA - Generic", p1); // Apply the first default
     return;
   }
 
-  StaticJsonDocument<4096> doc; // Increased size for more presets
-  DeserializationError error = deserializeJson(doc, file);
-  file.close();
-
-  if (error) {
+  if (presetStore.snapshotDamaged()) {
+    // Keep the presets read before the error
     logToWeb("Failed to parse presets.json. Check file for errors.", MSG_ERROR);
-    return;
   }
 
-  JsonArray array = doc.as<JsonArray>();
-  presets.clear();
-  bool defaultLoaded = false;
-  for (JsonObject obj : array) {
-    // If the object is our metadata block, skip it.
-    if (obj.containsKey("_metadata")) continue;
-    Preset p;
-    p.name = obj["name"].as<String>();
-    p.notes = obj["notes"].as<String>(); // This is safe, returns "" if 'notes' is missing
-    p.isDefault = obj["isDefault"];
-    p.dryingTemp = obj["dryingTemp"];
-    p.setpointHum = obj["setpointHum"];
-    p.warmTemp = obj["warmTemp"];
-    p.humHyst = obj["humHyst"];
-    p.stallInterval = obj["stallInterval"].as<unsigned long>() * 60000UL;
-    p.stallDelta = obj["stallDelta"];
-    p.heatDur = (uint32_t)(obj["heatDur"].as<float>() * 3600000.0f); // Keep float for hours, but cast result
-    p.heatAction = obj["heatAction"];
-    p.logInt = obj["logInt"].as<unsigned long>() * 60000UL; // Use unsigned long for safe math
-    p.mode = obj["mode"];
-    presets.push_back(p);
-
-    if (p.isDefault && !defaultLoaded) {
-      applyPreset(p);
-      defaultLoaded = true;
+  // Apply the default preset, or the first one as a fallback
+  size_t chosen = 0;
+  for (size_t i = 0; i < presets.size(); i++) {
+    if (presets.isDefault(i)) {
+      chosen = i;
+      break;
     }
   }
-
-  // If no default was found, apply the first preset as a fallback
-  if (!defaultLoaded && !presets.empty()) {
-    applyPreset(presets[0]);
+  if (!presets.empty()) {
+    applyPresetToAll(presets.name(chosen), presets.values(chosen));
   }
   // This message is too noisy for startup, so it's commented out.
   // logToWeb("Presets loaded successfully.");
 }
 
-void savePresets() {
-  File file = SPIFFS.open("/presets.json", "w");
-  if (!file) {
-    logToWeb("Error: Failed to open presets.json for writing.", MSG_ERROR);
-    return;
-  }
-
-  StaticJsonDocument<4096> doc; // Increased size for more presets
-  JsonArray array = doc.to<JsonArray>();
-
-  for (const auto& p : presets) {
-    JsonObject obj = array.createNestedObject();
-    obj["name"] = p.name;
-    obj["notes"] = p.notes;
-    obj["isDefault"] = p.isDefault;
-    obj["dryingTemp"] = p.dryingTemp;
-    obj["setpointHum"] = p.setpointHum;
-    obj["warmTemp"] = p.warmTemp;
-    obj["humHyst"] = p.humHyst;
-    obj["stallInterval"] = (float)p.stallInterval / 60000.0f; // Convert ms to minutes for JSON
-    obj["stallDelta"] = p.stallDelta;
-    obj["heatDur"] = (float)p.heatDur / 3600000.0f; // Convert ms to hours for JSON
-    obj["heatAction"] = p.heatAction;
-    obj["logInt"] = (float)p.logInt / 60000.0f; // Convert ms to minutes for JSON
-    obj["mode"] = p.mode;
-  }
-
-  if (serializeJson(doc, file) == 0) {
-    logToWeb("Error: Failed to write to presets.json.", MSG_ERROR);
+// Called with the result of each PresetStore write
+void reportPresetWrite(bool ok) {
+  if (!ok) {
+    logToWeb("Error: Failed to write presets to flash.", MSG_ERROR);
   } else {
     logToWeb("Presets saved successfully.", MSG_INFO);
   }
-  file.close();
+}
+
+size_t PresetListStream::fill(uint8_t *buffer, size_t maxLen) {
+  size_t out = 0;
+  while (out < maxLen) {
+    if (offset < len) {
+      size_t n = min(len - offset, maxLen - out);
+      memcpy(buffer + out, text + offset, n);
+      out += n;
+      offset += n;
+      continue;
+    }
+    if (done) break;
+    len = offset = 0;
+    if (!started) {
+      writer.beginArray();
+      started = true;
+    }
+    PresetLock lock; // Released between presets; text holds a copy
+    if (index < presets.size()) {
+      if (full) {
+        writer.writePreset(presets.name(index), presets.notes(index), presets.values(index));
+      } else {
+        writer.writeSummary(presets.name(index), presets.notes(index), presets.isDefault(index));
+      }
+      index++;
+    } else {
+      writer.endArray();
+      done = true;
+    }
+  }
+  return out;
 }
 
 /* Display flushing */
+// With DMA the flush only queues the transfer and returns, so LVGL renders the next
+// part of the frame into the other buffer meanwhile. The buffer is handed back from
+// display_flush_poll() once the transfer has completed.
 void my_disp_flush(lv_disp_drv_t *disp, const lv_area_t *area, lv_color_t *color_p) {
   uint32_t w = (area->x2 - area->x1 + 1);
   uint32_t h = (area->y2 - area->y1 + 1);
-  tft.startWrite();
-  tft.setAddrWindow(area->x1, area->y1, w, h);
-  tft.pushColors((uint16_t *)color_p, w * h, true);
-  tft.endWrite();
-  lv_disp_flush_ready(disp);
+  flushedPixels += w * h;
+  if (useDma) {
+    tft.pushImageDMA(area->x1, area->y1, w, h, (uint16_t *)color_p);
+    flushInFlight = true;
+  } else {
+    tft.setAddrWindow(area->x1, area->y1, w, h);
+    tft.pushPixels(color_p, w * h);
+    lv_disp_flush_ready(disp);
+  }
+}
+
+void display_flush_poll() {
+  if (flushInFlight && !tft.dmaBusy()) {
+    flushInFlight = false;
+    lv_disp_flush_ready(&disp_drv);
+  }
+}
+
+// Called by LVGL while it needs the buffer that is still being sent
+void my_disp_wait(lv_disp_drv_t *disp) {
+  int64_t start = esp_timer_get_time();
+  display_flush_poll();
+  flushWaitUs += esp_timer_get_time() - start;
+}
+
+#ifdef DISPLAY_BENCH
+// Redraws the whole screen DISPLAY_BENCH times with the blocking flush, then with DMA,
+// and reports the time per frame and how much of it the CPU was free. Build with
+// -D DISPLAY_BENCH=<frames>; the result goes to the message box and the web clients.
+void runDisplayBench() {
+  uint32_t frameUs[2], busyUs[2];
+  bool dma = useDma;
+  for (int mode = 0; mode < 2; mode++) {
+    useDma = mode == 1 && dma;
+    flushWaitUs = 0;
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < DISPLAY_BENCH; i++) {
+      lv_obj_invalidate(lv_scr_act());
+      lv_refr_now(NULL);
+      while (flushInFlight) my_disp_wait(&disp_drv); // The frame ends with its last transfer
+    }
+    int64_t total = esp_timer_get_time() - start;
+    frameUs[mode] = (uint32_t)(total / DISPLAY_BENCH);
+    busyUs[mode] = (uint32_t)((total - flushWaitUs) / DISPLAY_BENCH);
+  }
+  useDma = dma;
+
+  char msg[96];
+  snprintf(msg, sizeof(msg), "Frame: blocking %lu us, DMA %lu us (CPU busy %lu us, %ld us freed)%s",
+           (unsigned long)frameUs[0], (unsigned long)frameUs[1], (unsigned long)busyUs[1],
+           (long)busyUs[0] - (long)busyUs[1], dma ? "" : " - DMA unavailable");
+  update_message_box(msg);
+  logToWeb(msg);
+}
+#endif
+
+/* Zone hooks */
+// DryerZone reports through these; they run on the control task.
+
+static void zoneLog(void* ctx, const DryerZone& dryer, LogEvent event, uint8_t detail) {
+  sendLog(zones[dryer.getIndex()], event, detail);
+}
+
+// Messages carry the zone name once there is more than one zone
+static void zoneMessage(void* ctx, const DryerZone& dryer, ZoneMessage type, const char* text) {
+  char msg[sizeof(BusEvent::text)];
+  if (ZONE_COUNT > 1) {
+    snprintf(msg, sizeof(msg), "%s: %s", zones[dryer.getIndex()].config->name, text);
+    text = msg;
+  }
+  switch (type) {
+    case ZONE_MSG_DISPLAY: update_message_box(text); break;
+    case ZONE_MSG_INFO: logToWeb(text, MSG_INFO); break;
+    case ZONE_MSG_ERROR: logToWeb(text, MSG_ERROR); break;
+  }
+}
+
+// Hands an identified model to the writer task, which stores it in the zone's active
+// preset, so every enclosure keeps its own
+static void zoneModelIdentified(void* ctx, const DryerZone& dryer) {
+  IdentifiedModel identified;
+  strlcpy(identified.preset, zones[dryer.getIndex()].activePresetName.c_str(), sizeof(identified.preset));
+  identified.model = dryer.getModel();
+  if (!identifiedModels.push(identified)) logToWeb("Error: Identified model not saved, writer busy.", MSG_ERROR);
+}
+
+void setupZones() {
+  ZoneHooks hooks = { zoneLog, zoneMessage, zoneModelIdentified, nullptr };
+  for (size_t i = 0; i < ZONE_COUNT; i++) {
+    zones[i].config = &ZONES[i];
+    zones[i].index = i;
+    zones[i].dryer.setIndex(i);
+    zones[i].dryer.setHooks(hooks);
+  }
 }
 
 void setupSensor() {
   Wire.begin(27, 22); // SDA=27, SCL=22
-  if (!sht31.begin(0x44)) {
-    // Do NOT block here. Log the error and allow the system to continue.
-    update_message_box("Sensor Init Failed!");
-    logToWeb("CRITICAL: SHT31 sensor initialization failed!", MSG_ERROR);
+  Wire.setClock(I2C_CLOCK_HZ);
+  for (Zone& zone : zones) {
+    const ZoneConfig& cfg = *zone.config;
+    // The mux is only switched for zones that have probes behind it, so a board
+    // without one still reads its main-bus probes.
+    bool usesMux = false;
+    for (size_t i = 0; i < cfg.probeCount; i++) {
+      if (cfg.probes[i].muxChannel >= 0) usesMux = true;
+    }
+    zone.probes.configure(wireWrite, wireRead, nullptr, usesMux ? &mux : nullptr, cfg.probes,
+                          cfg.probeCount, PROBE_TEMPERATURE_FILTER, PROBE_HUMIDITY_FILTER);
+    size_t found = zone.probes.begin();
+    char msg[64];
+    if (found == 0) {
+      // Do NOT block here. Log the error and allow the system to continue.
+      snprintf(msg, sizeof(msg), "%s: Sensor Init Failed!", cfg.name);
+      update_message_box(ZONE_COUNT > 1 ? msg : "Sensor Init Failed!");
+      snprintf(msg, sizeof(msg), "CRITICAL: %s SHT31 sensor initialization failed!", cfg.name);
+      logToWeb(msg, MSG_ERROR);
+    } else if (found < cfg.probeCount) {
+      snprintf(msg, sizeof(msg), "%s: %u of %u SHT31 probes found.", cfg.name, (unsigned)found,
+               (unsigned)cfg.probeCount);
+      logToWeb(msg);
+    }
   }
 }
 
@@ -383,6 +793,180 @@ void setupWiFi() {
   sprintf(msgBuffer, "Web Client at: %s", WiFi.localIP().toString().c_str()); // Prepare message for TFT
   // Do NOT log to web client, as they already know the IP.
   update_message_box(msgBuffer);
+
+  // UTC clock for the persistent log; records are stamped with 0 until it is set.
+  configTime(0, 0, "pool.ntp.org");
+}
+
+// The zone a request is for: the "zone" parameter (form or query), 0 when left out.
+// Returns -1 for a zone that does not exist.
+static int zoneParam(AsyncWebServerRequest *request) {
+  const AsyncWebParameter* p = request->hasParam("zone", true) ? request->getParam("zone", true)
+                             : request->hasParam("zone") ? request->getParam("zone") : nullptr;
+  if (!p) return 0;
+  long zone = strtol(p->value().c_str(), nullptr, 10);
+  return zone >= 0 && zone < (long)ZONE_COUNT ? (int)zone : -1;
+}
+
+// The zone a request is for, or null after answering 400 for an unknown one
+static Zone* requestZone(AsyncWebServerRequest *request) {
+  int zone = zoneParam(request);
+  if (zone < 0) {
+    request->send(400, "text/plain", "Unknown zone");
+    return nullptr;
+  }
+  return &zones[zone];
+}
+
+// Queues a command for the request's zone and answers the request: 200 once queued,
+// 503 if the queue is full.
+static void queueControl(AsyncWebServerRequest *request, ControlCommand command) {
+  Zone* zone = requestZone(request);
+  if (!zone) return;
+  command.zone = zone->index;
+  if (controlCommands.push(command)) {
+    request->send(200, "text/plain", "OK");
+  } else {
+    request->send(503, "text/plain", "Busy, try again");
+  }
+}
+
+static void queueControl(AsyncWebServerRequest *request, ControlCommandType type, double value = 0) {
+  ControlCommand command = {};
+  command.type = type;
+  command.value = value;
+  queueControl(request, command);
+}
+
+// One decimal, or null for a missing reading (JSON has no NaN)
+static const char* jsonFloat(char* buf, float value) {
+  if (isnan(value)) return "null";
+  snprintf(buf, 12, "%.1f", value);
+  return buf;
+}
+
+// --- Metrics ---
+// Tasks whose stack high-water mark /metrics reports
+static const char* const METRICS_TASKS[] = { "loopTask", "control", "writer", "async_tcp", "esp_timer" };
+
+static size_t appendToStream(void *ctx, const char *data, size_t len) {
+  return ((AsyncResponseStream *)ctx)->write((const uint8_t *)data, len);
+}
+
+// Writes the /metrics page. Everything here is read from counters the tasks keep as
+// they go or from published snapshots; only the heap and stack figures are asked of
+// the system, once per scrape. Runs in the async_tcp task, like the WebSocket events.
+static void writeMetrics(MetricsWriter& m) {
+  char labels[64];
+
+  m.family("dryer_uptime_seconds", "gauge", "Time since boot.");
+  m.sample("dryer_uptime_seconds", nullptr, esp_timer_get_time() / 1e6);
+
+  // Heap
+  m.family("dryer_heap_free_bytes", "gauge", "Free heap.");
+  m.sample("dryer_heap_free_bytes", nullptr, ESP.getFreeHeap());
+  m.family("dryer_heap_min_free_bytes", "gauge", "Lowest free heap since boot.");
+  m.sample("dryer_heap_min_free_bytes", nullptr, ESP.getMinFreeHeap());
+  m.family("dryer_heap_largest_free_block_bytes", "gauge", "Largest block that can be allocated.");
+  m.sample("dryer_heap_largest_free_block_bytes", nullptr, ESP.getMaxAllocHeap());
+
+  // Tasks
+  m.family("dryer_task_stack_free_min_bytes", "gauge", "Least free stack each task has had (high-water mark).");
+  for (const char* name : METRICS_TASKS) {
+    TaskHandle_t task = xTaskGetHandle(name);
+    if (!task) continue;
+    snprintf(labels, sizeof(labels), "task=\"%s\"", name);
+    m.sample("dryer_task_stack_free_min_bytes", labels, uxTaskGetStackHighWaterMark(task)); // Bytes on the ESP32
+  }
+  PeriodTiming control = controlTiming.load();
+  m.family("dryer_control_periods_total", "counter", "Control task periods run.");
+  m.sample("dryer_control_periods_total", nullptr, control.periods);
+  m.family("dryer_control_missed_total", "counter", "Control task periods that finished after the next release.");
+  m.sample("dryer_control_missed_total", nullptr, control.missed);
+  m.family("dryer_control_exec_max_seconds", "gauge", "Longest control task period.");
+  m.sample("dryer_control_exec_max_seconds", nullptr, control.maxExecUs / 1e6);
+
+  // LVGL loop
+  const size_t timerCount = sizeof(lvTimers) / sizeof(lvTimers[0]);
+  ExecTiming timings[timerCount + 1];
+  const char* timerNames[timerCount + 1];
+  for (size_t i = 0; i < timerCount; i++) {
+    timings[i] = lvTimers[i].published.load();
+    timerNames[i] = lvTimers[i].name;
+  }
+  timings[timerCount] = lvHandler.published.load();
+  timerNames[timerCount] = lvHandler.name;
+  m.family("dryer_lv_timer_seconds", "summary", "Time spent in each LVGL timer; lv_timer_handler is whole passes, rendering included.");
+  for (size_t i = 0; i <= timerCount; i++) {
+    snprintf(labels, sizeof(labels), "timer=\"%s\"", timerNames[i]);
+    m.sample("dryer_lv_timer_seconds_sum", labels, timings[i].totalUs / 1e6);
+    m.sample("dryer_lv_timer_seconds_count", labels, timings[i].runs);
+  }
+  m.family("dryer_lv_timer_max_seconds", "gauge", "Longest run of each LVGL timer.");
+  for (size_t i = 0; i <= timerCount; i++) {
+    snprintf(labels, sizeof(labels), "timer=\"%s\"", timerNames[i]);
+    m.sample("dryer_lv_timer_max_seconds", labels, timings[i].maxUs / 1e6);
+  }
+
+  // WebSocket. Every client has a logClients slot.
+  size_t queued = 0;
+  for (const LogClient& c : logClients) {
+    if (c.id == 0) continue;
+    AsyncWebSocketClient *client = ws.client(c.id);
+    AsyncClient *tcp = client ? client->client() : nullptr;
+    if (tcp && tcp->connected()) queued += TCP_SND_BUF - tcp->space();
+  }
+  m.family("dryer_websocket_clients", "gauge", "Connected WebSocket clients.");
+  m.sample("dryer_websocket_clients", nullptr, ws.count());
+  m.family("dryer_websocket_queued_bytes", "gauge", "Bytes sent to WebSocket clients and not yet acknowledged.");
+  m.sample("dryer_websocket_queued_bytes", nullptr, queued);
+
+  // Sensors
+  m.family("dryer_sensor_errors_total", "counter", "SHT31 bus and CRC errors.");
+  for (const Zone& zone : zones) {
+    ProbeSnapshot p = zone.probeSnapshot.load();
+    for (size_t i = 0; i < zone.config->probeCount; i++) {
+      const ProbeConfig& probe = zone.config->probes[i];
+      snprintf(labels, sizeof(labels), "zone=\"%u\",channel=\"%d\",address=\"0x%02X\"",
+               (unsigned)zone.index, probe.muxChannel, probe.address);
+      m.sample("dryer_sensor_errors_total", labels, p.probes[i].errors);
+    }
+  }
+  m.family("dryer_sensor_read_seconds", "summary", "Time to collect and restart a zone's probe measurements, once per tick.");
+  for (const Zone& zone : zones) {
+    ExecTiming t = zone.probeSnapshot.load().timing;
+    snprintf(labels, sizeof(labels), "zone=\"%u\"", (unsigned)zone.index);
+    m.sample("dryer_sensor_read_seconds_sum", labels, t.totalUs / 1e6);
+    m.sample("dryer_sensor_read_seconds_count", labels, t.runs);
+  }
+  m.family("dryer_sensor_read_max_seconds", "gauge", "Longest probe read of a tick.");
+  for (const Zone& zone : zones) {
+    snprintf(labels, sizeof(labels), "zone=\"%u\"", (unsigned)zone.index);
+    m.sample("dryer_sensor_read_max_seconds", labels, zone.probeSnapshot.load().timing.maxUs / 1e6);
+  }
+
+  // Heater
+  m.family("dryer_heater_on_seconds_total", "counter", "Heater SSR on time, counted as each pulse ends.");
+  for (const Zone& zone : zones) {
+    snprintf(labels, sizeof(labels), "zone=\"%u\"", (unsigned)zone.index);
+    m.sample("dryer_heater_on_seconds_total", labels, zone.heater.getOnTimeTotal() / 1000.0);
+  }
+  m.family("dryer_heater_cycles_total", "counter", "Heater OFF -> ON switches.");
+  for (const Zone& zone : zones) {
+    snprintf(labels, sizeof(labels), "zone=\"%u\"", (unsigned)zone.index);
+    m.sample("dryer_heater_cycles_total", labels, zone.heater.getCycleCount());
+  }
+
+  // Messages and commands
+  m.family("dryer_event_bus_dropped_total", "counter", "Messages dropped because their slot was still being written.");
+  m.sample("dryer_event_bus_dropped_total", nullptr, events.dropped());
+  m.family("dryer_event_bus_missed_total", "counter", "Messages overwritten before a consumer read them.");
+  m.sample("dryer_event_bus_missed_total", "consumer=\"display\"", displayMissed.load(std::memory_order_relaxed));
+  m.sample("dryer_event_bus_missed_total", "consumer=\"serial\"", serialMissed.load(std::memory_order_relaxed));
+  m.family("dryer_control_commands_rejected_total", "counter", "Web commands turned away because the control queue was full.");
+  m.sample("dryer_control_commands_rejected_total", nullptr, controlCommands.getRejected());
+  m.family("dryer_log_records_rejected_total", "counter", "Log records dropped because the writer queue was full.");
+  m.sample("dryer_log_records_rejected_total", nullptr, logJobs.getRejected());
 }
 
 void setupWebServer() {
@@ -392,71 +976,144 @@ void setupWebServer() {
   });
 
   // Route for sensor readings (JSON endpoint)
+  // Serves a copy of the snapshot built by the control loop; nothing is formatted here.
+  // The response keeps its own copy, since the snapshot changes on every tick.
   server.on("/readings", HTTP_GET, [](AsyncWebServerRequest *request){
-    String json = "{";
-    json += "\"temperature\":" + (isnan(currentTemperature) ? "null" : String(currentTemperature, 1));
-    json += ",\"humidity\":" + (isnan(currentHumidity) ? "null" : String(currentHumidity, 1));
-    json += ",\"humidity_rate\":" + String(humidityRate, 2);
-    json += ",\"drying_temp\":";
-    json += String(dryingTemperature, 1);
-    json += ",\"setpoint_hum\":";
-    json += String(setpointHumidity, 1);
-    json += ",\"warm_temp\":";
-    json += String(warmTemperature, 1);
-    json += ",\"process_state\":\"" + currentStatusString + "\"";
-    json += ",\"heater_on\":";
-    json += isHeaterOn ? "true" : "false";
-    json += ",\"is_enabled\":";
-    json += isHeaterEnabled ? "true" : "false";
-    json += ",\"hum_hyst\":";
-    json += String(humidityHysteresis, 1);
-    json += ",\"stall_interval\":";
-    json += String(stallCheckInterval);
-    json += ",\"stall_delta\":";
-    json += String(stallHumidityDelta, 1);
-    json += ",\"heat_duration\":";
-    json += String(heatDuration);
-    json += ",\"heat_remaining\":";
-    long remaining = 0;
-    if (currentState == STATE_HEATING && isHeaterEnabled) remaining = heatDuration - (millis() - heatStartTime);
-    json += String(remaining > 0 ? remaining : 0);
-    json += ",\"log_interval\":";
-    json += String(logIntervalMillis / 60000.0, 1);
-    json += ",\"is_stalled\":";
-    json += isStalled ? "true" : "false";
-    json += ",\"selected_mode\":";
-    json += String(selectedMode);
-    json += ",\"heat_action\":\"" + String(heatCompletionAction == ACTION_STOP ? "Stop" : "Warm") + "\"";
-    json += "}";
+    Zone* zone = requestZone(request);
+    if (!zone) return;
+    char body[ReadingsSnapshot::BUFFER_SIZE];
+    zone->readingsSnapshot.copy(body);
+    request->send(200, "application/json", body);
+  });
+
+  // Every zone at a glance, for the zone selector
+  server.on("/zones", HTTP_GET, [](AsyncWebServerRequest *request){
+    char json[128 + ZONE_COUNT * 160];
+    char a[12], b[12];
+    int len = snprintf(json, sizeof(json), "{\"zones\":[");
+    for (const Zone& zone : zones) {
+      DisplayValues v = zone.displaySnapshot.load();
+      len += snprintf(json + len, sizeof(json) - len,
+             "%s{\"zone\":%u,\"name\":\"%s\",\"temperature\":%s,\"humidity\":%s,"
+             "\"processState\":\"%s\",\"heaterOn\":%s}",
+             zone.index > 0 ? "," : "", (unsigned)zone.index, zone.config->name,
+             jsonFloat(a, v.hasReading ? v.temperature : NAN), jsonFloat(b, v.hasReading ? v.humidity : NAN),
+             processStatusText((ProcessStatus)v.status), v.heaterOn ? "true" : "false");
+    }
+    snprintf(json + len, sizeof(json) - len, "]}");
     request->send(200, "application/json", json);
   });
 
-  // --- Logging Endpoints ---
-  server.on("/start_log", HTTP_POST, [](AsyncWebServerRequest *request){
-    isLoggingEnabled = true;
-    loggingStartTime = millis();
-    lastTimedLogTime = loggingStartTime; // Reset timed log on start
-    // Log the current settings first
-    String setup_string = "SETUP,Mode:" + String(selectedMode == MODE_DRY ? "Dry" : (selectedMode == MODE_HEAT ? "Heat" : "Warm"));
-    setup_string += ",DryingTemp:" + String(dryingTemperature, 1);
-    setup_string += ",WarmingTemp:" + String(warmTemperature, 1);
-    setup_string += ",HumSet:" + String(setpointHumidity, 1);
-    setup_string += ",HumHyst:" + String(humidityHysteresis, 1);
-    setup_string += ",HeatDur:" + String(heatDuration/3600000.0, 1);
-    setup_string += ",HeatAction:" + String(heatCompletionAction == ACTION_STOP ? "Stop" : "Warm");
-    ws.textAll(setup_string);
+  // Execution time, jitter and deadline misses of the control task, in microseconds,
+  // and each zone's share of a tick
+  server.on("/control/timing", HTTP_GET, [](AsyncWebServerRequest *request){
+    PeriodTiming t = controlTiming.load();
+    char json[256 + ZONE_COUNT * 48];
+    int len = snprintf(json, sizeof(json),
+             "{\"periodUs\":%lu,\"periods\":%lu,\"missed\":%lu,\"skipped\":%lu,"
+             "\"execUs\":%lu,\"meanExecUs\":%lu,\"maxExecUs\":%lu,\"jitterUs\":%lu,\"maxJitterUs\":%lu,\"zones\":[",
+             (unsigned long)t.periodUs, (unsigned long)t.periods, (unsigned long)t.missed,
+             (unsigned long)t.skipped, (unsigned long)t.lastExecUs, (unsigned long)t.meanExecUs,
+             (unsigned long)t.maxExecUs, (unsigned long)t.lastJitterUs, (unsigned long)t.maxJitterUs);
+    for (const Zone& zone : zones) {
+      len += snprintf(json + len, sizeof(json) - len, "%s{\"execUs\":%lu,\"maxExecUs\":%lu}",
+                      zone.index > 0 ? "," : "", (unsigned long)zone.lastStepUs.load(),
+                      (unsigned long)zone.maxStepUs.load());
+    }
+    snprintf(json + len, sizeof(json) - len, "]}");
+    request->send(200, "application/json", json);
+  });
 
-    // Send header as first log entry
-    String header = "Timestamp,Event,Temp,Humidity,HumRate";
-    ws.textAll(header);
+  // Runtime health in the Prometheus text format, for scraping
+  server.on("/metrics", HTTP_GET, [](AsyncWebServerRequest *request){
+    AsyncResponseStream *response = request->beginResponseStream("text/plain; version=0.0.4; charset=utf-8");
+    MetricsWriter m(appendToStream, response);
+    writeMetrics(m);
+    request->send(response);
+  });
 
-    // Send the first data point immediately
-    sendLog("TIMED");
-    request->send(200, "text/plain", "OK");
+  // Label redraws and pixels sent to the display, per second and since boot
+  server.on("/display/stats", HTTP_GET, [](AsyncWebServerRequest *request){
+    DisplayStats s = displayStats.load();
+    char json[160];
+    snprintf(json, sizeof(json),
+             "{\"invalidationsPerSec\":%lu,\"pixelsPerSec\":%lu,\"invalidations\":%lu,\"pixels\":%lu}",
+             (unsigned long)s.invalidationsPerSec, (unsigned long)s.pixelsPerSec,
+             (unsigned long)s.invalidations, (unsigned long)s.pixels);
+    request->send(200, "application/json", json);
+  });
+
+  // Each probe's filtered reading and the fused chamber values
+  server.on("/probes", HTTP_GET, [](AsyncWebServerRequest *request){
+    Zone* zone = requestZone(request);
+    if (!zone) return;
+    ProbeSnapshot p = zone->probeSnapshot.load();
+    const ZoneConfig& cfg = *zone->config;
+    const ChamberReading& c = p.chamber;
+    char json[1280];
+    char a[12], b[12], d[12], e[12];
+    int len = snprintf(json, sizeof(json),
+             "{\"zone\":%u,\"controlPoint\":%u,\"count\":%u,\"meanTemperature\":%s,\"meanHumidity\":%s,"
+             "\"temperatureGradient\":%s,\"humidityGradient\":%s,\"coldestProbe\":%d,\"wettestProbe\":%d,"
+             "\"hottestProbe\":%d,\"probes\":[",
+             (unsigned)zone->index, (unsigned)p.controlPoint, (unsigned)c.probes, jsonFloat(a, c.meanTemperature),
+             jsonFloat(b, c.meanHumidity), jsonFloat(d, c.temperatureGradient), jsonFloat(e, c.humidityGradient),
+             c.coldestProbe, c.wettestProbe, c.hottestProbe);
+    for (size_t i = 0; i < cfg.probeCount; i++) {
+      const ProbeReading& r = p.probes[i];
+      len += snprintf(json + len, sizeof(json) - len,
+             "%s{\"channel\":%d,\"address\":\"0x%02X\",\"height\":%.1f,\"present\":%s,"
+             "\"temperature\":%s,\"humidity\":%s,\"errors\":%lu}",
+             i > 0 ? "," : "", cfg.probes[i].muxChannel, cfg.probes[i].address, cfg.probes[i].height,
+             r.present ? "true" : "false", jsonFloat(a, r.temperature), jsonFloat(b, r.humidity),
+             (unsigned long)r.errors);
+    }
+    snprintf(json + len, sizeof(json) - len, "]}");
+    request->send(200, "application/json", json);
+  });
+
+  // --- Logging Endpoints ---
+  server.on("/start_log", HTTP_POST, [](AsyncWebServerRequest *request){
+    queueControl(request, CMD_START_LOG);
   });
   server.on("/stop_log", HTTP_POST, [](AsyncWebServerRequest *request){
-    isLoggingEnabled = false;
-    request->send(200, "text/plain", "OK");
+    queueControl(request, CMD_STOP_LOG);
+  });
+
+  // Stored log as CSV. Select by sequence (from/to) and/or Unix time (since/until),
+  // optionally capped with limit. Streamed in chunks straight from flash.
+  server.on("/log/records", HTTP_GET, [](AsyncWebServerRequest *request){
+    auto param = [request](const char *name, uint32_t fallback) -> uint32_t {
+      return request->hasParam(name) ? strtoul(request->getParam(name)->value().c_str(), nullptr, 10) : fallback;
+    };
+    auto query = std::make_shared<LogStoreQuery>(logStore, param("from", 0), param("to", UINT32_MAX),
+                                                 param("since", 0), param("until", 0), param("limit", 0));
+    request->send(request->beginChunkedResponse("text/csv", [query](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+      return query->fill((char *)buffer, maxLen);
+    }));
+  });
+
+  // Temperature/humidity history of a zone for charting, downsampled to at most `points`
+  // points. from/to are seconds since boot; negative values count back from now.
+  server.on("/history", HTTP_GET, [](AsyncWebServerRequest *request){
+    Zone* zone = requestZone(request);
+    if (!zone) return;
+    HistoryRollup& history = zone->history;
+    uint32_t now = uptimeSeconds();
+    auto param = [request, now](const char *name, uint32_t fallback) -> uint32_t {
+      if (!request->hasParam(name)) return fallback;
+      long value = strtol(request->getParam(name)->value().c_str(), nullptr, 10);
+      if (value >= 0) return (uint32_t)value;
+      return (uint32_t)-value < now ? now + value : 0;
+    };
+    uint32_t points = param("points", 300);
+    if (points < 1) points = 1;
+    if (points > 1000) points = 1000;
+    auto query = std::make_shared<HistoryQuery>(history, now, param("from", history.oldestTime(now)),
+                                                param("to", now + 1), points);
+    request->send(request->beginChunkedResponse("application/json", [query](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+      return query->fill((char *)buffer, maxLen);
+    }));
   });
 
   // Route to set the log interval
@@ -464,7 +1121,8 @@ void setupWebServer() {
     if (request->hasParam("value", true)) {
       float minutes = request->getParam("value", true)->value().toFloat();
       if (minutes > 0) {
-        logIntervalMillis = minutes * 60000;
+        queueControl(request, CMD_SET_LOG_INTERVAL, (uint32_t)(minutes * 60000));
+        return;
       }
       request->send(200, "text/plain", "OK");
     } else {
@@ -474,59 +1132,76 @@ void setupWebServer() {
 
 
   // --- Message Queue Endpoint ---
+  // Each browser passes the sequence of the last message it showed ("after"), so every
+  // client gets every message. Without it, the oldest message still held is returned.
   server.on("/getmessage", HTTP_GET, [](AsyncWebServerRequest *request){
-    if (!webMessageQueue.empty()) {
-      WebMessage msg = webMessageQueue.front();
-      webMessageQueue.erase(webMessageQueue.begin()); // Dequeue the message
-      String json = "{\"type\":\"" + String(msg.type == MSG_INFO ? "info" : "error") + "\",";
-      json += "\"text\":\"" + msg.text + "\"}";
+    EventCursor cursor;
+    cursor.next = request->hasParam("after") ? (uint32_t)request->getParam("after")->value().toInt() + 1
+                                             : events.oldest();
+    BusEvent e;
+    while (events.read(cursor, e)) {
+      if (e.type == EVENT_DISPLAY) continue;
+      char json[64 + 6 * sizeof(e.text)];
+      size_t len = snprintf(json, sizeof(json), "{\"seq\":%lu,\"missed\":%lu,\"type\":\"%s\",\"text\":\"",
+                            (unsigned long)e.sequence, (unsigned long)cursor.missed,
+                            e.type == EVENT_ERROR ? "error" : "info");
+      for (const char *c = e.text; *c; c++) {
+        if (*c == '"' || *c == '\\') {
+          json[len++] = '\\';
+          json[len++] = *c;
+        } else if ((uint8_t)*c < 0x20) {
+          len += snprintf(json + len, 7, "\\u%04x", (uint8_t)*c);
+        } else {
+          json[len++] = *c;
+        }
+      }
+      memcpy(json + len, "\"}", 3);
       request->send(200, "application/json", json);
-    } else {
-      request->send(204, "text/plain", ""); // Send "No Content" if no message
+      return;
     }
+    request->send(204, "text/plain", ""); // Send "No Content" if no message
   });
 
 
   // --- Preset Endpoints ---
   server.on("/presets/list", HTTP_GET, [](AsyncWebServerRequest *request){
-    // Use ArduinoJson to safely serialize the list. This correctly handles
-    // special characters in any field, including the 'notes' field.
-    StaticJsonDocument<2048> doc;
-    JsonArray array = doc.to<JsonArray>();
-    for (const auto& p : presets) {
-      JsonObject obj = array.createNestedObject();
-      obj["name"] = p.name;
-      obj["isDefault"] = p.isDefault;
-      obj["notes"] = p.notes;
-    }
-    String output;
-    serializeJson(doc, output);
-    request->send(200, "application/json", output);
+    // Streamed one preset at a time, so the reply is not capped by a buffer size.
+    // PresetWriter escapes special characters in any field, including 'notes'.
+    auto list = std::make_shared<PresetListStream>(false);
+    request->send(request->beginChunkedResponse("application/json", [list](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+      return list->fill(buffer, maxLen);
+    }));
   });
 
   server.on("/presets/load", HTTP_POST, [](AsyncWebServerRequest *request){
     if (request->hasParam("name", true)) {
       String name = request->getParam("name", true)->value();
-      for (const auto& p : presets) {
-        if (p.name == name) {
-          applyPreset(p);
-          request->send(200, "text/plain", "OK");
-          return;
+      ControlCommand command = {};
+      bool found;
+      {
+        PresetLock lock;
+        int i = presets.find(name.c_str());
+        found = i >= 0;
+        if (found) {
+          command.type = CMD_APPLY_PRESET;
+          command.preset = presets.values(i);
+          strlcpy(command.name, presets.name(i), sizeof(command.name));
         }
       }
+      if (found) {
+        queueControl(request, command);
+        return;
+      }
     }
     request->send(404, "text/plain", "Preset not found");
   });
 
   server.on("/presets/download", HTTP_GET, [](AsyncWebServerRequest *request){
-    File file = SPIFFS.open("/presets.json", "r");
-    if (!file) {
-      request->send(500, "text/plain", "Could not read presets file.");
-      return;
-    }
-    String content = file.readString();
-    file.close();
-    request->send(200, "application/json", content);
+    // Built from RAM: presets.json alone lacks the edits still in the journal
+    auto list = std::make_shared<PresetListStream>(true);
+    request->send(request->beginChunkedResponse("application/json", [list](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+      return list->fill(buffer, maxLen);
+    }));
   });
 
   server.on("/presets/save", HTTP_POST, [](AsyncWebServerRequest *request){
@@ -534,32 +1209,30 @@ void setupWebServer() {
       String notes_from_request = "";
       if (request->hasParam("notes", true)) {
         notes_from_request = request->getParam("notes", true)->value();
+        notes_from_request.remove(utf8Prefix(notes_from_request.c_str(), PRESET_NOTES_MAX));
       }
 
       String name = request->getParam("name", true)->value();
-      // Check if preset with this name already exists to update it
-      for (auto& p : presets) {
-        if (p.name == name) {
-          // Update existing preset
-          p.notes = notes_from_request; 
-          p.dryingTemp = dryingTemperature; p.setpointHum = setpointHumidity; p.warmTemp = warmTemperature; p.humHyst = humidityHysteresis;
-          p.stallInterval = stallCheckInterval; p.stallDelta = stallHumidityDelta; p.heatDur = heatDuration;
-          p.heatAction = heatCompletionAction; p.logInt = logIntervalMillis; p.mode = selectedMode;
-          savePresets();
-          request->send(200, "text/plain", "Updated");
-          return;
-        }
+      name.remove(utf8Prefix(name.c_str(), PRESET_NAME_MAX));
+      Zone* zone = requestZone(request); // Saves the settings of this zone
+      if (!zone) return;
+      PresetValues values = zone->settingsSnapshot.load();
+      int existing, i;
+      bool written = false;
+      {
+        PresetLock lock;
+        // Check if preset with this name already exists to update it
+        existing = presets.find(name.c_str());
+        values.isDefault = existing >= 0 && presets.isDefault(existing);
+        i = presets.put(name.c_str(), notes_from_request.c_str(), values);
+        if (i >= 0) written = presetStore.savePreset(i);
       }
-      // If not found, create a new one
-      Preset p_new;
-      p_new.name = name;
-      p_new.notes = notes_from_request; 
-      p_new.dryingTemp = dryingTemperature; p_new.setpointHum = setpointHumidity; p_new.warmTemp = warmTemperature; p_new.humHyst = humidityHysteresis;
-      p_new.stallInterval = stallCheckInterval; p_new.stallDelta = stallHumidityDelta; p_new.heatDur = heatDuration;
-      p_new.heatAction = heatCompletionAction; p_new.logInt = logIntervalMillis; p_new.mode = selectedMode;
-      presets.push_back(p_new);
-      savePresets();
-      request->send(200, "text/plain", "Saved");
+      if (i < 0) {
+        request->send(500, "text/plain", "Out of memory");
+        return;
+      }
+      reportPresetWrite(written);
+      request->send(200, "text/plain", existing >= 0 ? "Updated" : "Saved");
     } else {
       request->send(400, "text/plain", "Bad Request");
     }
@@ -568,8 +1241,17 @@ void setupWebServer() {
   server.on("/presets/delete", HTTP_POST, [](AsyncWebServerRequest *request){
     if (request->hasParam("name", true)) {
       String name = request->getParam("name", true)->value();
-      presets.erase(std::remove_if(presets.begin(), presets.end(), [&](const Preset& p){ return p.name == name; }), presets.end());
-      savePresets();
+      bool found, written = false;
+      {
+        PresetLock lock;
+        int i = presets.find(name.c_str());
+        found = i >= 0;
+        if (found) {
+          presets.remove(i);
+          written = presetStore.saveRemove(name.c_str());
+        }
+      }
+      if (found) reportPresetWrite(written);
       request->send(200, "text/plain", "Deleted");
     } else {
       request->send(400, "text/plain", "Bad Request");
@@ -580,16 +1262,40 @@ void setupWebServer() {
     if (request->hasParam("old_name", true) && request->hasParam("new_name", true)) {
       String old_name = request->getParam("old_name", true)->value();
       String new_name = request->getParam("new_name", true)->value();
-
-      for (auto& p : presets) {
-        if (p.name == old_name) {
-          p.name = new_name;
-          savePresets();
-          request->send(200, "text/plain", "Renamed");
-          return;
+      new_name.remove(utf8Prefix(new_name.c_str(), PRESET_NAME_MAX));
+
+      int status = 200;
+      const char* reply = "Renamed";
+      bool written = false;
+      {
+        PresetLock lock;
+        int i = presets.find(old_name.c_str());
+        int taken = presets.find(new_name.c_str());
+        if (i < 0) {
+          status = 404;
+          reply = "Preset not found";
+        } else if (taken >= 0 && taken != i) {
+          status = 409;
+          reply = "A preset with that name already exists";
+        } else if (!controlCommands.hasRoom()) {
+          // The zones learn the new name through the queue; check for room before
+          // renaming, so nothing has to be undone. The web handlers are its only producers.
+          status = 503;
+          reply = "Busy, try again";
+        } else if (!presets.rename(i, new_name.c_str())) {
+          status = 500;
+          reply = "Out of memory";
+        } else {
+          ControlCommand command = {};
+          command.type = CMD_PRESET_RENAMED; // The active preset may carry the old name
+          strlcpy(command.name, old_name.c_str(), sizeof(command.name));
+          strlcpy(command.newName, new_name.c_str(), sizeof(command.newName));
+          controlCommands.push(command);
+          written = presetStore.saveRename(old_name.c_str(), new_name.c_str());
         }
       }
-      request->send(404, "text/plain", "Preset not found");
+      if (status == 200) reportPresetWrite(written);
+      request->send(status, "text/plain", reply);
     } else {
       request->send(400, "text/plain", "Bad Request");
     }
@@ -598,8 +1304,21 @@ void setupWebServer() {
   server.on("/presets/setdefault", HTTP_POST, [](AsyncWebServerRequest *request){
     if (request->hasParam("name", true)) {
       String name = request->getParam("name", true)->value();
-      for (auto& p : presets) { p.isDefault = (p.name == name); }
-      savePresets();
+      bool found, written = false;
+      {
+        PresetLock lock;
+        int i = presets.find(name.c_str());
+        found = i >= 0 || name.length() == 0; // "" clears the default
+        if (found) {
+          presets.setDefault(i);
+          written = presetStore.saveDefault(name.c_str());
+        }
+      }
+      if (!found) {
+        request->send(404, "text/plain", "Preset not found");
+        return;
+      }
+      reportPresetWrite(written);
       request->send(200, "text/plain", "OK");
     } else {
       request->send(400, "text/plain", "Bad Request");
@@ -610,9 +1329,7 @@ void setupWebServer() {
   server.on("/setdryingtemp", HTTP_POST, [](AsyncWebServerRequest *request){
     if (request->hasParam("value", true)) { // "true" means it's a POST parameter
       String value = request->getParam("value", true)->value();
-      dryingTemperature = value.toFloat();
-      update_setpoint_display(); // Update the LVGL display immediately
-      request->send(200, "text/plain", "OK");
+      queueControl(request, CMD_SET_DRYING_TEMP, value.toFloat());
     } else {
       request->send(400, "text/plain", "Bad Request");
     }
@@ -622,9 +1339,7 @@ void setupWebServer() {
   server.on("/setpointhum", HTTP_POST, [](AsyncWebServerRequest *request){
     if (request->hasParam("value", true)) {
       String value = request->getParam("value", true)->value();
-      setpointHumidity = value.toFloat();
-      update_humidity_setpoint_display(); // Update the LVGL display immediately
-      request->send(200, "text/plain", "OK");
+      queueControl(request, CMD_SET_HUM_SETPOINT, value.toFloat());
     } else {
       request->send(400, "text/plain", "Bad Request");
     }
@@ -634,8 +1349,7 @@ void setupWebServer() {
   server.on("/setwarmtemp", HTTP_POST, [](AsyncWebServerRequest *request){
     if (request->hasParam("value", true)) {
       String value = request->getParam("value", true)->value();
-      warmTemperature = value.toFloat();
-      request->send(200, "text/plain", "OK");
+      queueControl(request, CMD_SET_WARM_TEMP, value.toFloat());
     } else {
       request->send(400, "text/plain", "Bad Request");
     }
@@ -645,8 +1359,7 @@ void setupWebServer() {
   server.on("/sethumhyst", HTTP_POST, [](AsyncWebServerRequest *request){
     if (request->hasParam("value", true)) {
       String value = request->getParam("value", true)->value();
-      humidityHysteresis = value.toFloat();
-      request->send(200, "text/plain", "OK");
+      queueControl(request, CMD_SET_HUM_HYST, value.toFloat());
     } else {
       request->send(400, "text/plain", "Bad Request");
     }
@@ -656,8 +1369,7 @@ void setupWebServer() {
   server.on("/setstallinterval", HTTP_POST, [](AsyncWebServerRequest *request){
     if (request->hasParam("value", true)) {
       String value = request->getParam("value", true)->value();
-      stallCheckInterval = value.toInt();
-      request->send(200, "text/plain", "OK");
+      queueControl(request, CMD_SET_STALL_INTERVAL, (uint32_t)value.toInt());
     } else {
       request->send(400, "text/plain", "Bad Request");
     }
@@ -667,8 +1379,7 @@ void setupWebServer() {
   server.on("/setstalldelta", HTTP_POST, [](AsyncWebServerRequest *request){
     if (request->hasParam("value", true)) {
       String value = request->getParam("value", true)->value();
-      stallHumidityDelta = value.toFloat();
-      request->send(200, "text/plain", "OK");
+      queueControl(request, CMD_SET_STALL_DELTA, value.toFloat());
     } else {
       request->send(400, "text/plain", "Bad Request");
     }
@@ -678,26 +1389,9 @@ void setupWebServer() {
   server.on("/setmode", HTTP_POST, [](AsyncWebServerRequest *request){
     if (request->hasParam("mode", true)) {
       int mode = request->getParam("mode", true)->value().toInt();
-      if (mode >= 0 && mode <= 2) {
-        selectedMode = (Mode)mode;
-
-        // If the process is already running, force an immediate state change.
-        if (isHeaterEnabled) {
-          switch(selectedMode) {
-            case MODE_DRY:
-              currentState = STATE_DRYING;
-              lastTransitionReason = REASON_USER_ACTION;
-              break;
-            case MODE_HEAT:
-              currentState = STATE_HEATING;
-              heatStartTime = millis(); // Restart the heat timer
-              break;
-            case MODE_WARM:
-              currentState = STATE_WARMING;
-              lastTransitionReason = REASON_USER_ACTION;
-              break;
-          }
-        }
+      if (mode >= MODE_DRY && mode <= MODE_IDENTIFY) {
+        queueControl(request, CMD_SET_MODE, mode);
+        return;
       }
       request->send(200, "text/plain", "OK");
     } else {
@@ -709,8 +1403,7 @@ void setupWebServer() {
   server.on("/setheatduration", HTTP_POST, [](AsyncWebServerRequest *request){
     if (request->hasParam("value", true)) {
       float hours = request->getParam("value", true)->value().toFloat();
-      heatDuration = hours * 3600000; // Convert hours to milliseconds
-      request->send(200, "text/plain", "OK");
+      queueControl(request, CMD_SET_HEAT_DURATION, (uint32_t)(hours * 3600000)); // Convert hours to milliseconds
     } else {
       request->send(400, "text/plain", "Bad Request");
     }
@@ -720,19 +1413,70 @@ void setupWebServer() {
   server.on("/setheataction", HTTP_POST, [](AsyncWebServerRequest *request){
     if (request->hasParam("action", true)) {
       int action = request->getParam("action", true)->value().toInt();
-      if (action == 0) heatCompletionAction = ACTION_STOP;
-      else if (action == 1) heatCompletionAction = ACTION_WARM;
+      if (action == ACTION_STOP || action == ACTION_WARM) {
+        queueControl(request, CMD_SET_HEAT_ACTION, action);
+        return;
+      }
+      request->send(200, "text/plain", "OK");
+    } else {
+      request->send(400, "text/plain", "Bad Request");
+    }
+  });
+
+  // Route to choose between plain PID and model-based predictive control
+  server.on("/setcontrol", HTTP_POST, [](AsyncWebServerRequest *request){
+    if (request->hasParam("control", true)) {
+      int control = request->getParam("control", true)->value().toInt();
+      if (control == CONTROL_PID || control == CONTROL_PREDICTIVE) {
+        queueControl(request, CMD_SET_CONTROL, control);
+        return;
+      }
       request->send(200, "text/plain", "OK");
     } else {
       request->send(400, "text/plain", "Bad Request");
     }
   });
 
+  // Route to choose the chamber point held at the setpoints: mean, coldest or wettest probe
+  server.on("/setcontrolpoint", HTTP_POST, [](AsyncWebServerRequest *request){
+    if (request->hasParam("point", true)) {
+      int point = request->getParam("point", true)->value().toInt();
+      if (point >= POINT_MEAN && point <= POINT_WETTEST) {
+        queueControl(request, CMD_SET_CONTROL_POINT, point);
+        return;
+      }
+      request->send(200, "text/plain", "OK");
+    } else {
+      request->send(400, "text/plain", "Bad Request");
+    }
+  });
+
+  // Routes to tune the PID gains live
+  server.on("/setpidkp", HTTP_POST, [](AsyncWebServerRequest *request){
+    if (request->hasParam("value", true)) {
+      queueControl(request, CMD_SET_PID_KP, request->getParam("value", true)->value().toFloat());
+    } else {
+      request->send(400, "text/plain", "Bad Request");
+    }
+  });
+  server.on("/setpidki", HTTP_POST, [](AsyncWebServerRequest *request){
+    if (request->hasParam("value", true)) {
+      queueControl(request, CMD_SET_PID_KI, request->getParam("value", true)->value().toFloat());
+    } else {
+      request->send(400, "text/plain", "Bad Request");
+    }
+  });
+  server.on("/setpidkd", HTTP_POST, [](AsyncWebServerRequest *request){
+    if (request->hasParam("value", true)) {
+      queueControl(request, CMD_SET_PID_KD, request->getParam("value", true)->value().toFloat());
+    } else {
+      request->send(400, "text/plain", "Bad Request");
+    }
+  });
+
   // Route to toggle the master enable state
   server.on("/toggle_enable", HTTP_POST, [](AsyncWebServerRequest *request){
-    isHeaterEnabled = !isHeaterEnabled;
-    lastTransitionReason = REASON_USER_ACTION;
-    request->send(200, "text/plain", "OK");
+    queueControl(request, CMD_TOGGLE_ENABLE);
   });
 
   // Attach the WebSocket handler
@@ -743,9 +1487,31 @@ void setupWebServer() {
 }
 
 void setupHardwarePins() {
-  // Heater Relay Pin
-  pinMode(HEATER_PIN, OUTPUT);
-  digitalWrite(HEATER_PIN, LOW); // Ensure heater is off initially
+  // Heater Relay Pins
+  for (const ZoneConfig& cfg : ZONES) {
+    pinMode(cfg.heaterPin, OUTPUT);
+    digitalWrite(cfg.heaterPin, LOW); // Ensure heater is off initially
+  }
+
+  // Heater output timer: drives the SSR edges from the esp_timer task
+  esp_timer_create_args_t timerArgs = {};
+  timerArgs.callback = heaterTimerCallback;
+  timerArgs.name = "heater";
+  if (esp_timer_create(&timerArgs, &heaterTimer) != ESP_OK ||
+      esp_timer_start_periodic(heaterTimer, HEATER_TIMER_PERIOD_US) != ESP_OK) {
+    logToWeb("CRITICAL: Heater output timer failed to start!", MSG_ERROR);
+  }
+}
+
+void writeHeaterPin(bool on, void* context) {
+  digitalWrite(((Zone*)context)->config->heaterPin, on ? HIGH : LOW);
+}
+
+void heaterTimerCallback(void* arg) {
+  uint32_t now = (uint32_t)(esp_timer_get_time() / 1000);
+  for (Zone& zone : zones) {
+    zone.heater.service(now);
+  }
 }
 
 void ui_init() {
@@ -786,11 +1552,13 @@ void ui_init() {
   const int col1_x = 10;
   const int col2_x = 120;
 
-  lv_obj_t * title_label = lv_label_create(lv_scr_act());
-  lv_obj_set_width(title_label, 200);
-  lv_label_set_text(title_label, "Filament Dryer");
-  lv_obj_align(title_label, LV_ALIGN_TOP_MID, 0, 10);
-  lv_obj_add_style(title_label, &style_title, 0);
+  titleView.label = lv_label_create(lv_scr_act());
+  lv_obj_set_width(titleView.label, 200);
+  lv_obj_set_style_text_align(titleView.label, LV_TEXT_ALIGN_CENTER, 0);
+  lv_obj_align(titleView.label, LV_ALIGN_TOP_MID, 0, 10);
+  lv_obj_add_style(titleView.label, &style_title, 0);
+  // With several zones the title names the one shown
+  view_set(titleView, ZONE_COUNT > 1 ? ZONES[0].name : "Filament Dryer");
 
   // --- Temperature Row ---
   lv_obj_t * temp_label_static = lv_label_create(lv_scr_act());
@@ -798,14 +1566,14 @@ void ui_init() {
   lv_obj_add_style(temp_label_static, &style_label, 0);
   lv_obj_align(temp_label_static, LV_ALIGN_TOP_LEFT, col1_x, 60);
 
-  temp_label_value = lv_label_create(lv_scr_act());
-  lv_obj_add_style(temp_label_value, &style_value, 0);
-  lv_obj_align(temp_label_value, LV_ALIGN_TOP_LEFT, col2_x, 55);
+  tempView.label = lv_label_create(lv_scr_act());
+  lv_obj_add_style(tempView.label, &style_value, 0);
+  lv_obj_align(tempView.label, LV_ALIGN_TOP_LEFT, col2_x, 55);
 
   // Create the Temp Setpoint value label (Column 3)
-  setpoint_label_value = lv_label_create(lv_scr_act());
-  lv_obj_add_style(setpoint_label_value, &style_setpoint, 0);
-  lv_obj_align(setpoint_label_value, LV_ALIGN_TOP_LEFT, 220, 55); // Position in 3rd column
+  setpointView.label = lv_label_create(lv_scr_act());
+  lv_obj_add_style(setpointView.label, &style_setpoint, 0);
+  lv_obj_align(setpointView.label, LV_ALIGN_TOP_LEFT, 220, 55); // Position in 3rd column
 
   // --- Humidity Row ---
   lv_obj_t * hum_label_static = lv_label_create(lv_scr_act());
@@ -813,14 +1581,14 @@ void ui_init() {
   lv_obj_add_style(hum_label_static, &style_label, 0);
   lv_obj_align(hum_label_static, LV_ALIGN_TOP_LEFT, col1_x, 120);
 
-  hum_label_value = lv_label_create(lv_scr_act());
-  lv_obj_add_style(hum_label_value, &style_value, 0);
-  lv_obj_align(hum_label_value, LV_ALIGN_TOP_LEFT, col2_x, 115);
+  humView.label = lv_label_create(lv_scr_act());
+  lv_obj_add_style(humView.label, &style_value, 0);
+  lv_obj_align(humView.label, LV_ALIGN_TOP_LEFT, col2_x, 115);
 
   // Create the Humidity Setpoint value label (Column 3)
-  hum_setpoint_label_value = lv_label_create(lv_scr_act());
-  lv_obj_add_style(hum_setpoint_label_value, &style_setpoint_hum, 0);
-  lv_obj_align(hum_setpoint_label_value, LV_ALIGN_TOP_LEFT, 220, 115); // Position in 3rd column
+  humSetpointView.label = lv_label_create(lv_scr_act());
+  lv_obj_add_style(humSetpointView.label, &style_setpoint_hum, 0);
+  lv_obj_align(humSetpointView.label, LV_ALIGN_TOP_LEFT, 220, 115); // Position in 3rd column
 
   // --- Heater Status ---
   lv_obj_t * heater_label_static = lv_label_create(lv_scr_act());
@@ -828,307 +1596,562 @@ void ui_init() {
   lv_obj_add_style(heater_label_static, &style_label, 0);
   lv_obj_align(heater_label_static, LV_ALIGN_TOP_LEFT, col1_x, 165);
 
-  heater_status_label = lv_label_create(lv_scr_act());
-  lv_obj_add_style(heater_status_label, &style_value, 0);
-  lv_obj_align(heater_status_label, LV_ALIGN_TOP_LEFT, col2_x, 165);
-  update_heater_status_display();
+  heaterView.label = lv_label_create(lv_scr_act());
+  lv_obj_add_style(heaterView.label, &style_value, 0);
+  lv_obj_align(heaterView.label, LV_ALIGN_TOP_LEFT, col2_x, 165);
+  update_heater_status_display(false);
 
   // --- State Display ---
-  state_label = lv_label_create(lv_scr_act());
-  lv_obj_add_style(state_label, &style_setpoint, 0); // Use cyan style
-  lv_obj_set_width(state_label, 300);
-  lv_obj_set_style_text_align(state_label, LV_TEXT_ALIGN_CENTER, 0);
-  lv_obj_align(state_label, LV_ALIGN_BOTTOM_MID, 0, -35);
-  update_process_status_display();
+  stateView.label = lv_label_create(lv_scr_act());
+  lv_obj_add_style(stateView.label, &style_setpoint, 0); // Use cyan style
+  lv_obj_set_width(stateView.label, 300);
+  lv_obj_set_style_text_align(stateView.label, LV_TEXT_ALIGN_CENTER, 0);
+  lv_obj_align(stateView.label, LV_ALIGN_BOTTOM_MID, 0, -35);
+  update_process_status_display(STATUS_IDLE);
 
   // --- Message Box ---
-  message_label = lv_label_create(lv_scr_act());
-  lv_label_set_text(message_label, "Initializing...");
-  lv_obj_add_style(message_label, &style_message, 0);
-  lv_obj_set_width(message_label, screenWidth - 20);
-  lv_label_set_long_mode(message_label, LV_LABEL_LONG_WRAP);
-  lv_obj_align(message_label, LV_ALIGN_BOTTOM_LEFT, 10, -2);
+  messageView.label = lv_label_create(lv_scr_act());
+  lv_obj_add_style(messageView.label, &style_message, 0);
+  lv_obj_set_width(messageView.label, screenWidth - 20);
+  lv_label_set_long_mode(messageView.label, LV_LABEL_LONG_WRAP);
+  lv_obj_align(messageView.label, LV_ALIGN_BOTTOM_LEFT, 10, -2);
 
   // Set initial placeholder text for dynamic labels
-  lv_label_set_text(temp_label_value, "--.- C");
-  lv_label_set_text(hum_label_value, "--.- %");
-  update_setpoint_display(); // Set initial value
-  update_humidity_setpoint_display();
+  view_set(messageView, "Initializing...");
+  view_set(tempView, "--.- C");
+  view_set(humView, "--.- %");
+  update_setpoint_display(zones[0].dryer.getSettings().dryingTemp); // Set initial value
+  update_humidity_setpoint_display(zones[0].dryer.getSettings().setpointHum);
 }
 
-void update_setpoint_display() {
-  char setpointStr[8];
-  dtostrf(dryingTemperature, 4, 1, setpointStr);
-  lv_label_set_text_fmt(setpoint_label_value, "%s C", setpointStr);
+// Shows text in the label's look, touching LVGL only for what differs from last time
+void view_set(LabelView& view, const char* text, LabelLook look) {
+  if (view.look != look) {
+    if (view.look == LOOK_ERROR) lv_obj_remove_style(view.label, &style_error, 0);
+    switch (look) {
+      case LOOK_ERROR: lv_obj_add_style(view.label, &style_error, 0); break;
+      case LOOK_HEATER_ON: lv_obj_set_style_text_color(view.label, lv_color_hex(0xFF0000), 0); break;
+      case LOOK_HEATER_OFF: lv_obj_set_style_text_color(view.label, lv_color_hex(0x808080), 0); break;
+      default: break;
+    }
+    view.look = look;
+    labelInvalidations++;
+  }
+  if (strncmp(view.text, text, sizeof(view.text) - 1) != 0) {
+    strlcpy(view.text, text, sizeof(view.text));
+    lv_label_set_text(view.label, view.text);
+    labelInvalidations++;
+  }
 }
 
-void update_humidity_setpoint_display() {
-  char setpointStr[8];
-  dtostrf(setpointHumidity, 4, 1, setpointStr);
-  lv_label_set_text_fmt(hum_setpoint_label_value, "%s %%", setpointStr);
+void update_setpoint_display(float setpoint) {
+  char text[16];
+  snprintf(text, sizeof(text), "%4.1f C", setpoint);
+  view_set(setpointView, text);
 }
 
-void update_heater_status_display() {
-  if (isHeaterOn) {
-    lv_obj_set_style_text_color(heater_status_label, lv_color_hex(0xFF0000), 0); // Red
-    lv_label_set_text(heater_status_label, "ON");
-  } else {
-    lv_obj_set_style_text_color(heater_status_label, lv_color_hex(0x808080), 0); // Grey
-    lv_label_set_text(heater_status_label, "OFF");
-  }
+void update_humidity_setpoint_display(float setpoint) {
+  char text[16];
+  snprintf(text, sizeof(text), "%4.1f %%", setpoint);
+  view_set(humSetpointView, text);
 }
 
-void update_process_status_display() {
-  // This function now just updates the LVGL label with the global status string
-  lv_label_set_text(state_label, currentStatusString.c_str());
+void update_heater_status_display(bool on) {
+  view_set(heaterView, on ? "ON" : "OFF", on ? LOOK_HEATER_ON : LOOK_HEATER_OFF);
 }
 
-void update_message_box(const char* message) {
-  lv_label_set_text(message_label, message);
+void update_process_status_display(ProcessStatus status) {
+  view_set(stateView, processStatusText(status));
 }
 
-void sendLog(String event) {
-  if (!isLoggingEnabled) return;
-
-  // Calculate elapsed time HH:MM:SS
-  uint32_t elapsed_ms = millis() - loggingStartTime;
-  uint32_t h = elapsed_ms / 3600000;
-  uint32_t m = (elapsed_ms % 3600000) / 60000;
-  uint32_t s = (elapsed_ms % 60000) / 1000;
-  char timeStr[10];
-  sprintf(timeStr, "%02d:%02d:%02d", h, m, s);
-  
-  // Format: Timestamp,Event,Temp,Humidity,HumRate
-  String logEntry = String(timeStr) + "," + event + "," + String(currentTemperature, 1) + "," + String(currentHumidity, 1) + "," + String(humidityRate, 2);
-  ws.textAll(logEntry);
-  Serial.println("Log: " + logEntry);
+void update_sensor_display(float t, float h) {
+  if (isnan(t) || isnan(h)) {
+    view_set(tempView, "Error", LOOK_ERROR);
+    view_set(humView, "Error", LOOK_ERROR);
+    return;
+  }
+  char text[16];
+  snprintf(text, sizeof(text), "%4.1f C", t);
+  view_set(tempView, text);
+  snprintf(text, sizeof(text), "%4.1f %%", h);
+  view_set(humView, text);
+}
+
+// Called by the control task at the end of each of the zone's steps (and once from setup)
+void publishDisplay(Zone& zone) {
+  const DryerZone& dryer = zone.dryer;
+  DisplayValues v;
+  v.temperature = dryer.getTemperature();
+  v.humidity = dryer.getHumidity();
+  v.dryingTemp = dryer.getSettings().dryingTemp;
+  v.setpointHum = dryer.getSettings().setpointHum;
+  v.status = dryer.getStatus();
+  v.heaterOn = zone.isHeaterOn;
+  v.hasReading = zone.sensorReads > 0;
+  zone.displaySnapshot.store(v);
 }
 
-void calculateHumidityRate() {
+// Shows what the control task last published for the zone on screen; the views skip
+// labels that did not change. Several zones take turns every ZONE_SHOW_MS.
+void display_task(lv_timer_t * timer) {
+  static size_t shownZone = 0;
+  static uint32_t shownVersion = 0;
+  static uint32_t shownSinceMs = 0;
   uint32_t now = millis();
-  const uint32_t HISTORY_DURATION = 30 * 60 * 1000; // 30 minutes
+  if (ZONE_COUNT > 1 && now - shownSinceMs >= ZONE_SHOW_MS) {
+    shownZone = (shownZone + 1) % ZONE_COUNT;
+    shownSinceMs = now;
+    shownVersion = 0; // Redraw for the new zone
+    view_set(titleView, ZONES[shownZone].name);
+  }
+  Zone& zone = zones[shownZone];
+  uint32_t version = zone.displaySnapshot.version();
+  if (version == shownVersion) return;
+  shownVersion = version;
+  DisplayValues v = zone.displaySnapshot.load();
+
+  if (v.hasReading) {
+    update_sensor_display(v.temperature, v.humidity);
+  } else {
+    view_set(tempView, "--.- C"); // Placeholders until the zone's first reading
+    view_set(humView, "--.- %");
+  }
+  update_setpoint_display(v.dryingTemp);
+  update_humidity_setpoint_display(v.setpointHum);
+  update_process_status_display((ProcessStatus)v.status);
+  update_heater_status_display(v.heaterOn);
+}
 
-  // Add current reading to history
-  if (!isnan(currentHumidity)) {
-    humidityHistory.push_back({now, currentHumidity});
+// Turns the redraw counters into per-second rates
+void display_stats_task(lv_timer_t * timer) {
+  static uint32_t lastMs = 0, lastInvalidations = 0, lastPixels = 0;
+  uint32_t now = millis();
+  uint32_t elapsed = now - lastMs;
+  if (elapsed == 0) return;
+  DisplayStats s;
+  s.invalidationsPerSec = (uint64_t)(labelInvalidations - lastInvalidations) * 1000 / elapsed;
+  s.pixelsPerSec = (uint64_t)(flushedPixels - lastPixels) * 1000 / elapsed;
+  s.invalidations = labelInvalidations;
+  s.pixels = flushedPixels;
+  displayStats.store(s);
+  lastMs = now;
+  lastInvalidations = labelInvalidations;
+  lastPixels = flushedPixels;
+}
+
+// Safe from any task: the label is set by event_bus_task on the LVGL loop.
+void update_message_box(const char* message) {
+  uint32_t h = fnv1a(message); // Spots a message repeating the previous one
+  if (lastDisplayHash.exchange(h) == h) return; // Already showing
+  events.publish(EVENT_DISPLAY, message);
+}
+
+// Consumers of the event bus that live on the LVGL loop: the message box and the serial log
+void event_bus_task(lv_timer_t * timer) {
+  BusEvent e;
+  const char* shown = nullptr;
+  char text[sizeof(e.text)];
+  while (events.read(displayCursor, e)) {
+    if (e.type != EVENT_DISPLAY) continue;
+    memcpy(text, e.text, sizeof(text));
+    shown = text; // Only the latest one is visible
   }
+  if (shown) view_set(messageView, shown);
 
-  // Remove old readings from the front of the deque
-  while (!humidityHistory.empty() && (now - humidityHistory.front().timestamp > HISTORY_DURATION)) {
-    humidityHistory.pop_front();
+  static const char* const prefixes[] = { "INFO", "ERROR", "TFT" };
+  while (events.read(serialCursor, e)) {
+    Serial.printf("[%s] %s\n", prefixes[e.type], e.text);
   }
+  displayMissed.store(displayCursor.missed, std::memory_order_relaxed);
+  serialMissed.store(serialCursor.missed, std::memory_order_relaxed);
+}
 
-  if (humidityHistory.size() < 2) {
-    humidityRate = 0.0; // Not enough data
-    return;
+// Captures a record of the zone for the writer task: for the stored log (store) and for
+// the logging browsers and the serial port (send)
+static void queueLog(Zone& zone, LogEvent event, uint8_t detail, bool store, bool send) {
+  LogJob job;
+  job.type = LOG_JOB_RECORD;
+  job.store = store;
+  job.send = send;
+  if (store) {
+    time_t nowUtc = time(nullptr);
+    StoredLogRecord& r = job.stored;
+    r.time = nowUtc > 1600000000 ? (uint32_t)nowUtc : 0; // Not set until NTP has answered
+    r.uptime = uptimeSeconds();
+    r.event = event;
+    r.detail = detail;
+    r.zone = zone.index;
+    r.temperature = zone.dryer.getTemperature();
+    r.humidity = zone.dryer.getHumidity();
+    r.humidityRate = zone.dryer.getHumidityRate();
+    r.targetTemp = zone.dryer.getTargetTemperature();
+    r.heaterDuty = zone.dryer.getHeaterDuty();
   }
+  if (send) {
+    LogRecord& r = job.record;
+    r.event = event;
+    r.detail = detail;
+    r.zone = zone.index;
+    r.sequence = logSequence++;
+    r.elapsedMs = millis() - loggingStartTime;
+    r.temperature = zone.dryer.getTemperature();
+    r.humidity = zone.dryer.getHumidity();
+    r.humidityRate = zone.dryer.getHumidityRate();
+  }
+  logJobs.push(job); // Counted in /metrics if full
+}
 
-  // Calculate rate: (last_humidity - first_humidity) / (time_span_in_hours)
-  float delta_hum = humidityHistory.back().humidity - humidityHistory.front().humidity;
-  float delta_time_hr = (float)(humidityHistory.back().timestamp - humidityHistory.front().timestamp) / 3600000.0f;
+void sendLog(Zone& zone, LogEvent event, uint8_t detail) {
+  bool store = event != LOG_HEAT_ON && event != LOG_HEAT_OFF;
+  if (store || isLoggingEnabled) queueLog(zone, event, detail, store, isLoggingEnabled);
+}
 
-  if (delta_time_hr > 0) {
-    humidityRate = delta_hum / delta_time_hr;
-  } else {
-    humidityRate = 0.0;
+void storeLog(Zone& zone, LogEvent event, uint8_t detail) {
+  queueLog(zone, event, detail, true, false);
+}
+
+// Runs sensing and control every CONTROL_TICK_MS, pinned to its own core
+void controlTask(void* arg) {
+  const TickType_t period = pdMS_TO_TICKS(CONTROL_TICK_MS);
+  const int64_t periodUs = CONTROL_TICK_MS * 1000LL;
+  vTaskDelay(1); // Start on a tick, where later releases fall
+  TickType_t lastWake = xTaskGetTickCount();
+  int64_t releaseUs = esp_timer_get_time();
+
+  for (uint32_t n = 0;; n++) {
+    int64_t startUs = esp_timer_get_time();
+    applyControlCommands();
+    for (Zone& zone : zones) {
+      int64_t zoneStartUs = esp_timer_get_time();
+      uint32_t tick = n + zone.index; // Zones record and control on different ticks
+      serviceSensor(zone);
+      if (tick % RECORD_TICKS == 0) recordReading(zone);
+      if (tick % CONTROL_TICKS == 0) controlZone(zone);
+      uint32_t us = (uint32_t)(esp_timer_get_time() - zoneStartUs);
+      zone.lastStepUs.store(us);
+      if (us > zone.maxStepUs.load()) zone.maxStepUs.store(us);
+    }
+    if (n % CONTROL_TICKS == 0) {
+      // --- Clear IP from TFT on first web client connection ---
+      // This provides a clean UI once the user has connected via the web.
+      if (isWebClientConnected && !ipMessageCleared) {
+        update_message_box(""); // Clear the message box
+        ipMessageCleared = true;
+      }
+    }
+    uint32_t passed = controlStats.record(releaseUs, startUs, esp_timer_get_time());
+    controlTiming.store(controlStats.timing());
+    if (writerTaskHandle) xTaskNotifyGive(writerTaskHandle); // Write out what this tick queued
+
+    if (passed > 0) {
+      // Overran: skip the releases already gone rather than running them back to back.
+      // The writer task reports it.
+      lastWake += passed * period;
+      releaseUs += passed * periodUs;
+      n += passed;
+    }
+    releaseUs += periodUs;
+    vTaskDelayUntil(&lastWake, period);
   }
 }
 
-void update_sensor_task(lv_timer_t * timer) {
-  float t = sht31.readTemperature();
-  float h = sht31.readHumidity();
+bool wireWrite(void* ctx, uint8_t address, const uint8_t* data, size_t len) {
+  Wire.beginTransmission(address);
+  Wire.write(data, len);
+  return Wire.endTransmission() == 0;
+}
 
-  char msgBuffer[50];
+bool wireRead(void* ctx, uint8_t address, uint8_t* data, size_t len) {
+  if (Wire.requestFrom(address, (uint8_t)len) != len) return false;
+  for (size_t i = 0; i < len; i++) data[i] = Wire.read();
+  return true;
+}
 
-  if (isnan(t) || isnan(h)) {
-    currentTemperature = NAN; // Indicate error
-    currentHumidity = NAN;    // Indicate error
-
-    lv_obj_add_style(temp_label_value, &style_error, 0);
-    lv_obj_add_style(hum_label_value, &style_error, 0);
-    lv_label_set_text(temp_label_value, "Error");
-    lv_label_set_text(hum_label_value, "Error");
-    update_message_box("Sensor read error!");
-    logToWeb("Sensor read error! Check wiring.", MSG_ERROR);
-  } else {
-    currentTemperature = t; // Update global
-    currentHumidity = h;    // Update global
+// Collects the measurements started last tick, starts the next ones and fuses the probes
+void serviceSensor(Zone& zone) {
+  zone.sensorReads++;
+  int64_t startUs = esp_timer_get_time();
+  size_t failed = zone.probes.service(millis());
+  zone.sensorTiming.record((uint32_t)(esp_timer_get_time() - startUs));
+  if (failed > 0) {
+    zoneMessage(nullptr, zone.dryer, ZONE_MSG_DISPLAY, "Sensor read error!");
+    zoneMessage(nullptr, zone.dryer, ZONE_MSG_ERROR, "Sensor read error! Check wiring.");
+  }
+  zone.dryer.setReading(zone.probes.fused());
+
+  ProbeSnapshot snapshot;
+  snapshot.controlPoint = zone.dryer.getControlPoint();
+  snapshot.chamber = zone.dryer.getChamber();
+  for (size_t i = 0; i < zone.probes.count(); i++) snapshot.probes[i] = zone.probes.reading(i);
+  snapshot.timing = zone.sensorTiming;
+  zone.probeSnapshot.store(snapshot);
+}
 
-    lv_obj_remove_style(temp_label_value, &style_error, 0);
-    lv_obj_remove_style(hum_label_value, &style_error, 0);
+// Feeds the chart history and the humidity trend at their 2 s cadence
+void recordReading(Zone& zone) {
+  if (zone.sensorReads == 0) return;
+  zone.history.add(uptimeSeconds(), zone.dryer.getTemperature(), zone.dryer.getHumidity()); // NAN leaves a gap
+  zone.dryer.recordHumidity(millis());
+}
 
-    char tempStr[8];
-    dtostrf(t, 4, 1, tempStr);
-    lv_label_set_text_fmt(temp_label_value, "%s C", tempStr);
+// Applies the web commands queued since the last period, before this one's control step
+void applyControlCommands() {
+  ControlCommand command;
+  while (controlCommands.pop(command)) {
+    applyControlCommand(command);
+  }
+}
 
-    char humStr[8];
-    dtostrf(h, 4, 1, humStr);
-    lv_label_set_text_fmt(hum_label_value, "%s %%", humStr);
+void applyControlCommand(const ControlCommand& command) {
+  Zone& zone = zones[command.zone < ZONE_COUNT ? command.zone : 0];
+  DryerZone& dryer = zone.dryer;
+  PresetValues s = dryer.getSettings();
+  switch (command.type) {
+    case CMD_SET_DRYING_TEMP: s.dryingTemp = command.value; break;
+    case CMD_SET_HUM_SETPOINT: s.setpointHum = command.value; break;
+    case CMD_SET_WARM_TEMP: s.warmTemp = command.value; break;
+    case CMD_SET_HUM_HYST: s.humHyst = command.value; break;
+    case CMD_SET_STALL_INTERVAL: s.stallInterval = (uint32_t)command.value; break;
+    case CMD_SET_STALL_DELTA: s.stallDelta = command.value; break;
+    case CMD_SET_HEAT_DURATION: s.heatDur = (uint32_t)command.value; break;
+    case CMD_SET_HEAT_ACTION: s.heatAction = (int)command.value; break;
+    case CMD_SET_CONTROL: s.control = (int)command.value; break;
+    case CMD_SET_PID_KP: s.kp = command.value; break;
+    case CMD_SET_PID_KI: s.ki = command.value; break;
+    case CMD_SET_PID_KD: s.kd = command.value; break;
+    case CMD_SET_LOG_INTERVAL: s.logInt = (uint32_t)command.value; break;
+    // The rest are not settings
+    case CMD_SET_CONTROL_POINT: dryer.setControlPoint((ControlPoint)(int)command.value); return;
+    case CMD_SET_MODE: dryer.selectMode((Mode)(int)command.value, millis()); return;
+    case CMD_TOGGLE_ENABLE: dryer.setEnabled(!dryer.isEnabled()); return;
+    case CMD_START_LOG: startLogging(); return;
+    case CMD_STOP_LOG: isLoggingEnabled = false; return;
+    case CMD_APPLY_PRESET: applyPreset(zone, command.name, command.preset); return;
+    case CMD_PRESET_RENAMED:
+      for (Zone& z : zones) {
+        if (z.activePresetName == command.name) z.activePresetName = command.newName;
+      }
+      return;
+  }
+  dryer.setSettings(s);
+}
 
-    // After updating sensor values, calculate the rate
-    calculateHumidityRate();
+// Starts a browser log: each zone's settings, the CSV header, then a first record per zone
+void startLogging() {
+  isLoggingEnabled = true;
+  loggingStartTime = millis();
+  logSequence = 0;
+  // The writer sends the settings from the snapshots, so bring them up to date
+  for (Zone& zone : zones) zone.settingsSnapshot.store(zone.dryer.getSettings());
+  LogJob job = {};
+  job.type = LOG_JOB_START;
+  logJobs.push(job);
+
+  // Send the first data points immediately
+  for (Zone& zone : zones) {
+    zone.lastTimedLogTime = loggingStartTime; // Reset timed log on start
+    sendLog(zone, LOG_TIMED);
   }
 }
 
-void controlHeaterTask(lv_timer_t * timer) {
-  // --- Clear IP from TFT on first web client connection ---
-  State previousState = currentState;
-  // This provides a clean UI once the user has connected via the web.
-  if (isWebClientConnected && !ipMessageCleared) {
-    update_message_box(""); // Clear the message box
-    ipMessageCleared = true;
-  }
-
-  // --- Process State Machine ---
-  
-  // --- Informational Stall Detection ---
-  // This does not affect the process, only for UI and logging.
-  bool wasStalledLastLoop = isStalled;
-  if (selectedMode == MODE_DRY && currentState == STATE_DRYING && humidityRate > -0.1 && humidityRate < 0.1) {
-    isStalled = true;
-  } else {
-    isStalled = false;
+// One control step of a zone: the controller, the heater, the logs and the published copies
+void controlZone(Zone& zone) {
+  DryerZone& dryer = zone.dryer;
+
+  // Hand the duty to the output stage; the heater timer switches the SSR.
+  zone.heater.setDuty(dryer.step(millis()));
+  bool newHeaterState = zone.heater.isOn();
+
+  // --- Report only if the relay state changed ---
+  if (newHeaterState != zone.isHeaterOn) {
+    zone.isHeaterOn = newHeaterState;
+    sendLog(zone, zone.isHeaterOn ? LOG_HEAT_ON : LOG_HEAT_OFF);
+    zoneMessage(nullptr, dryer, ZONE_MSG_DISPLAY, zone.isHeaterOn ? "Heater turned ON" : "Heater turned OFF");
   }
 
-  // If we just entered a stalled state, log it.
-  if (isStalled && !wasStalledLastLoop) {
-    sendLog("STALLED");
+  // --- Timed Logging ---
+  if (isLoggingEnabled && (millis() - zone.lastTimedLogTime >= dryer.getSettings().logInt)) {
+    sendLog(zone, LOG_TIMED);
+    zone.lastTimedLogTime = millis();
   }
 
-  if (!isHeaterEnabled) {
-    currentState = STATE_IDLE;
-    if (previousState != STATE_IDLE) lastTransitionReason = REASON_USER_ACTION;
-  } else {
-    // If enabled, decide whether to start or continue a process
-    if (currentState == STATE_IDLE) {
-      
-      // Transition to the user's selected mode and perform initial setup
-      if (selectedMode == MODE_DRY) {
-        currentState = STATE_DRYING;
-        lastTransitionReason = REASON_USER_ACTION;
-      } else if (selectedMode == MODE_HEAT) {
-        currentState = STATE_HEATING;
-        heatStartTime = millis(); // Start the timer
-        lastTransitionReason = REASON_USER_ACTION;
-      }
-      else if (selectedMode == MODE_WARM) {
-        currentState = STATE_WARMING;
-        lastTransitionReason = REASON_USER_ACTION;
-      }
-    }
-    
-    // --- State Transition Logic ---
-    if (currentState == STATE_DRYING) {
-      // In the new logic, DRYING state is for active drying. If humidity rises above the
-      // setpoint + hysteresis, we ensure we are in this state.
-      if (currentHumidity > (setpointHumidity + humidityHysteresis)) {
-        // This condition is met, so we are actively drying. No state change needed.
-      } else if (currentHumidity <= setpointHumidity) {
-        // We've reached the target, switch to WARMING to maintain.
-        humidityHistory.clear(); // Clear history on state change for accurate rate calculation
-        humidityRate = 0.0;
-        currentState = STATE_WARMING;
-      }
-    } else if (currentState == STATE_WARMING) {
-    } else if (currentState == STATE_HEATING) {
-      // Check for timer completion
-      if (millis() - heatStartTime > heatDuration) {
-        if (heatCompletionAction == ACTION_STOP) {
-          update_message_box("Heat timer finished. Stopping.");
-          lastTransitionReason = REASON_TIMER_EXPIRED;
-          isHeaterEnabled = false; // This will force state to IDLE
-          currentState = STATE_IDLE;
-        } else { // ACTION_WARM
-          update_message_box("Heat timer finished. Switching to Warm.");
-          lastTransitionReason = REASON_TIMER_EXPIRED;
-          currentState = STATE_WARMING;
-        }
-      }
-    }
+  // --- Persistent log: one sample a minute ---
+  if (millis() - zone.lastStoreSampleTime >= STORE_SAMPLE_INTERVAL_MS) {
+    storeLog(zone, LOG_TIMED);
+    zone.lastStoreSampleTime = millis();
   }
 
-  // --- Construct Status String ---
-  if (currentState == STATE_IDLE) {
-    if (previousState == STATE_HEATING && lastTransitionReason == REASON_TIMER_EXPIRED) {
-      currentStatusString = "IDLE (Heat Stopped)";
-    } else {
-      currentStatusString = "IDLE";
-    }
-  } else if (selectedMode == MODE_DRY) {
-    // Simplified status for DRY mode based on the active state
-    if (currentState == STATE_DRYING) currentStatusString = "Dry / DRYING";
-    else if (currentState == STATE_WARMING) currentStatusString = "Dry / MAINTAINING";
-  } else if (selectedMode == MODE_HEAT) {
-    if (currentState == STATE_HEATING) currentStatusString = "Heat / HEATING";
-    else if (currentState == STATE_WARMING) currentStatusString = "Heat / WARMING (Time Expired)";
-  } else if (selectedMode == MODE_WARM) {
-    currentStatusString = "Warm / WARMING";
-  }
-
-  // Update the display if the state changed
-  if (previousState != currentState) {
-    update_process_status_display();
-    sendLog("STATUS_" + currentStatusString);
-  }
-
-  // --- Thermostat Logic based on State ---
-  bool newHeaterState = isHeaterOn;
-  const float hysteresis = 1.0; // Hysteresis of 1 degree to prevent rapid cycling
-  float targetTemp = 0.0;
-  bool heatingRequired = false;
-
-  switch(currentState) {
-    case STATE_DRYING:
-    case STATE_HEATING:
-      targetTemp = dryingTemperature;
-      heatingRequired = true;
-      break;
-    case STATE_WARMING:
-      targetTemp = warmTemperature;
-      // If in DRY mode and humidity creeps up, switch back to active drying.
-      if (selectedMode == MODE_DRY && currentHumidity > (setpointHumidity + humidityHysteresis)) {
-        humidityHistory.clear(); // Clear history on state change for accurate rate calculation
-        humidityRate = 0.0;
-        currentState = STATE_DRYING; // This will be handled in the next loop cycle.
-        targetTemp = dryingTemperature;
-      }
-      heatingRequired = true;
-      break;
-    case STATE_IDLE:
-      heatingRequired = false;
-      break;
+  // --- Refresh the /readings, settings and display snapshots once per step ---
+  publishTelemetry(zone);
+  zone.settingsSnapshot.store(dryer.getSettings());
+  publishDisplay(zone);
+}
+
+// Writes the persistent log to flash in batches, shared by all zones (writer task)
+void serviceLogStore() {
+  if (logStore.pending() == 0) {
+    lastStoreFlushTime = millis();
+  } else if (millis() - lastStoreFlushTime >= STORE_FLUSH_INTERVAL_MS) {
+    if (!logStore.flush()) logToWeb("Failed to write the stored log.", MSG_ERROR);
+    lastStoreFlushTime = millis();
   }
+}
 
-  if (!heatingRequired) {
-    // If heating is not required (e.g., IDLE or humidity target met), force heater off.
-    newHeaterState = false;
-  } else {
-    // If heating IS required, apply standard thermostat logic against the target temp.
-    // This provides the safety cutoff if the temperature is already too high.
-    if (currentTemperature < targetTemp) {
-      newHeaterState = true;
-    } else if (currentTemperature > (targetTemp + hysteresis)) {
-      newHeaterState = false;
+void publishTelemetry(Zone& zone) {
+  const DryerZone& dryer = zone.dryer;
+  const PresetValues& s = dryer.getSettings();
+  const PidController& pid = dryer.getPid();
+  const SetpointRunStats& run = dryer.getRunStats();
+  TelemetryValues v;
+  v.zone = zone.index;
+  v.temperature = dryer.getTemperature();
+  v.humidity = dryer.getHumidity();
+  v.humidityRate = dryer.getHumidityRate();
+  v.dryingTemp = s.dryingTemp;
+  v.setpointHum = s.setpointHum;
+  v.warmTemp = s.warmTemp;
+  v.processState = processStatusText(dryer.getStatus());
+  v.heaterOn = zone.isHeaterOn;
+  v.isEnabled = dryer.isEnabled();
+  v.humHyst = s.humHyst;
+  v.stallInterval = s.stallInterval;
+  v.stallDelta = s.stallDelta;
+  v.heatDuration = s.heatDur;
+  v.heatRemaining = dryer.getHeatRemaining(millis());
+  v.logIntervalMin = s.logInt / 60000.0;
+  v.isStalled = dryer.isStalled();
+  v.selectedMode = s.mode;
+  v.heatAction = s.heatAction == ACTION_STOP ? "Stop" : "Warm";
+  v.heaterDuty = dryer.getHeaterDuty();
+  v.pidP = pid.pTerm();
+  v.pidI = pid.iTerm();
+  v.pidD = pid.dTerm();
+  v.kp = s.kp;
+  v.ki = s.ki;
+  v.kd = s.kd;
+  v.modelGain = dryer.getModel().gain;
+  v.modelTau = dryer.getModel().timeConstant;
+  v.modelDeadTime = dryer.getModel().deadTime;
+  v.control = s.control;
+  v.runSetpoint = run.getSetpoint();
+  v.runReached = run.hasReached();
+  v.runTimeToSetpoint = run.getTimeToSetpointMs() / 1000;
+  v.runOvershoot = run.getOvershoot();
+  v.temperatureSigma = dryer.getTemperatureSigma();
+  v.humiditySigma = dryer.getHumiditySigma();
+  v.controlPoint = dryer.getControlPoint();
+  v.probeCount = dryer.getChamber().probes;
+  v.temperatureGradient = dryer.getChamber().temperatureGradient;
+  zone.telemetryText.format(v);
+  zone.readingsSnapshot.publish(zone.telemetryText);
+  zone.telemetryValues.store(v);
+}
+
+/* Writer Task */
+// Does the control task's slow output: the stored and browser logs, the WebSocket
+// telemetry, identified models and deadline reports. Nothing here holds up control.
+void writerTask(void* arg) {
+  uint32_t reportedMissed = 0;
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(WRITER_IDLE_MS));
+    LogJob job;
+    while (logJobs.pop(job)) writeLogJob(job);
+    serviceLogStore();
+
+    IdentifiedModel identified;
+    while (identifiedModels.pop(identified)) saveIdentifiedModel(identified);
+
+    pushTelemetry();
+
+    uint32_t missed = controlTiming.load().missed;
+    if (missed != reportedMissed) {
+      reportedMissed = missed;
+      logToWeb("Control task missed its deadline.", MSG_ERROR);
     }
   }
+}
 
-  // --- Update Hardware and UI only if state changes ---
-  if (newHeaterState != isHeaterOn) {
-    isHeaterOn = newHeaterState;
-    digitalWrite(HEATER_PIN, isHeaterOn ? HIGH : LOW);
-    update_heater_status_display();
+void writeLogJob(const LogJob& job) {
+  if (job.type == LOG_JOB_START) {
+    sendLogSetup();
+    return;
+  }
+  if (job.store) {
+    logStore.append(job.stored);
+    if (job.stored.event == LOG_STATUS) logStore.flush(); // State changes go to flash right away
+  }
+  if (!job.send) return;
+
+  // Format: Timestamp,Event,Temp,Humidity,HumRate,Zone
+  char line[96];
+  size_t lineLen = formatLogLine(job.record, line, sizeof(line));
+  uint8_t frame[LOG_FRAME_SIZE];
+  encodeLogFrame(job.record, frame);
+
+  for (size_t i = 0; i < MAX_LOG_CLIENTS; i++) {
+    if (logClients[i].id == 0) continue;
+    if (logClients[i].binary) ws.binary(logClients[i].id, (const char *)frame, LOG_FRAME_SIZE);
+    else ws.text(logClients[i].id, line, lineLen);
+  }
+  Serial.print("Log: ");
+  Serial.println(line);
+}
+
+// The start of a browser log: each zone's settings, then the CSV header
+void sendLogSetup() {
+  for (Zone& zone : zones) {
+    PresetValues s = zone.settingsSnapshot.load();
+    String setup_string = "SETUP,Zone:" + String(zone.index);
+    setup_string += ",Mode:" + String(s.mode == MODE_DRY ? "Dry" : (s.mode == MODE_HEAT ? "Heat" : "Warm"));
+    setup_string += ",DryingTemp:" + String(s.dryingTemp, 1);
+    setup_string += ",WarmingTemp:" + String(s.warmTemp, 1);
+    setup_string += ",HumSet:" + String(s.setpointHum, 1);
+    setup_string += ",HumHyst:" + String(s.humHyst, 1);
+    setup_string += ",HeatDur:" + String(s.heatDur/3600000.0, 1);
+    setup_string += ",HeatAction:" + String(s.heatAction == ACTION_STOP ? "Stop" : "Warm");
+    ws.textAll(setup_string);
+  }
 
-    sendLog(isHeaterOn ? "HEAT_ON" : "HEAT_OFF");
+  // Send header as first log entry
+  String header = "Timestamp,Event,Temp,Humidity,HumRate,Zone";
+  ws.textAll(header);
+}
 
-    char msg[30];
-    sprintf(msg, "Heater turned %s", isHeaterOn ? "ON" : "OFF");
-    update_message_box(msg);
+void saveIdentifiedModel(const IdentifiedModel& identified) {
+  PresetLock lock; // Waits out a web edit; never taken on the control task
+  int i = presets.find(identified.preset);
+  if (i >= 0) {
+    PresetValues v = presets.values(i);
+    v.modelGain = identified.model.gain;
+    v.modelTau = identified.model.timeConstant;
+    v.modelDeadTime = identified.model.deadTime;
+    presets.setValues(i, v);
+    reportPresetWrite(presetStore.savePreset(i));
   }
+}
 
-  // --- Timed Logging ---
-  if (isLoggingEnabled && (millis() - lastTimedLogTime >= logIntervalMillis)) {
-    sendLog("TIMED");
-    lastTimedLogTime = millis();
+// Pushes only the fields that changed to the WebSocket clients; /readings stays as a fallback.
+// Clients that joined since the last pass first get every field as last pushed.
+void pushTelemetry() {
+  static TelemetryText text; // Writer task only, like telemetryFrame
+  ws.cleanupClients();
+  uint32_t id;
+  while (joinedClients.pop(id)) {
+    for (Zone& zone : zones) {
+      size_t len = zone.telemetryDelta.formatPushed(telemetryFrame, sizeof(telemetryFrame));
+      if (len > 0) ws.text(id, telemetryFrame, len); // Queued as a copy
+    }
+  }
+  bool resend = resendTelemetry.exchange(false);
+  for (Zone& zone : zones) {
+    uint32_t version = zone.telemetryValues.version();
+    if (resend) zone.telemetryDelta.reset();
+    else if (version == zone.pushedTelemetry) continue;
+    zone.pushedTelemetry = version;
+    if (ws.count() == 0) continue;
+    text.format(zone.telemetryValues.load());
+    size_t len = zone.telemetryDelta.build(text, telemetryFrame, sizeof(telemetryFrame));
+    if (len > 0) ws.textAll(telemetryFrame, len);
   }
 }
 
@@ -1137,9 +2160,31 @@ void onWsEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventTyp
   if (type == WS_EVT_CONNECT) {
     // A web client has connected via WebSocket
     isWebClientConnected = true;
+    for (size_t i = 0; i < MAX_LOG_CLIENTS; i++) {
+      if (logClients[i].id == 0) {
+        logClients[i].id = client->id();
+        logClients[i].binary = false;
+        break;
+      }
+    }
+    // The writer task starts it off with the full state of every zone, as of the last
+    // delta, so the deltas that follow apply to it
+    if (!joinedClients.push(client->id())) resendTelemetry.store(true);
   } else if (type == WS_EVT_DISCONNECT) {
     // client disconnected
+    for (size_t i = 0; i < MAX_LOG_CLIENTS; i++) {
+      if (logClients[i].id == client->id()) logClients[i].id = 0;
+    }
   } else if (type == WS_EVT_DATA) {
-    // data received
+    // data received; only short single-frame text commands are expected
+    AwsFrameInfo *info = (AwsFrameInfo *)arg;
+    if (!info->final || info->index != 0 || info->len != len || info->opcode != WS_TEXT) return;
+    bool binary;
+    if (len == 10 && memcmp(data, "log:binary", 10) == 0) binary = true;
+    else if (len == 8 && memcmp(data, "log:text", 8) == 0) binary = false;
+    else return;
+    for (size_t i = 0; i < MAX_LOG_CLIENTS; i++) {
+      if (logClients[i].id == client->id()) logClients[i].binary = binary;
+    }
   }
 }
\ No newline at end of file
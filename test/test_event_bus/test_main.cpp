@@ -0,0 +1,232 @@
+// EventBus with several producer threads and readers that fall behind. Each event names
+// its producer and a per-producer count, and pads its text with a letter derived from
+// both, so a reader can tell a lost, repeated, reordered or torn event.
+
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <unity.h>
+#include <vector>
+
+#include "EventBus.h"
+
+static const unsigned PRODUCERS = 4;
+static const unsigned READERS = 3;
+
+static void eventText(unsigned producer, unsigned n, char* text) {
+  int len = snprintf(text, EventBus::TEXT_MAX + 1, "p%u n%u ", producer, n);
+  size_t fill = len + (n * 7 + producer) % (EventBus::TEXT_MAX - len + 1);
+  memset(text + len, 'a' + (n + producer) % 26, fill - len);
+  text[fill] = 0;
+}
+
+// Checks an event against the text its producer wrote and returns who wrote it
+static bool parseEvent(const BusEvent& event, unsigned& producer, unsigned& n) {
+  if (sscanf(event.text, "p%u n%u ", &producer, &n) != 2 || producer >= PRODUCERS) return false;
+  char expected[EventBus::TEXT_MAX + 1];
+  eventText(producer, n, expected);
+  return event.type == EVENT_INFO && strcmp(event.text, expected) == 0;
+}
+
+// What one reader saw
+struct Seen {
+  std::vector<std::vector<uint8_t>> count; // [producer][n]: times received
+  unsigned last[PRODUCERS];                // Last n per producer, + 1
+  uint32_t received = 0;
+  uint32_t torn = 0;
+  uint32_t outOfOrder = 0;
+  uint32_t lastSequence = 0;
+
+  explicit Seen(unsigned perProducer) : count(PRODUCERS, std::vector<uint8_t>(perProducer, 0)) {
+    memset(last, 0, sizeof(last));
+  }
+
+  void add(const BusEvent& event) {
+    unsigned producer, n;
+    if (!parseEvent(event, producer, n) || n >= count[producer].size()) {
+      torn++;
+      return;
+    }
+    if (n + 1 <= last[producer] || (received > 0 && event.sequence <= lastSequence)) outOfOrder++;
+    last[producer] = n + 1;
+    lastSequence = event.sequence;
+    count[producer][n]++;
+    received++;
+  }
+};
+
+void setUp() {}
+
+void tearDown() {}
+
+// Producers publish in rounds of at most CAPACITY events and the readers catch up in
+// between, so no reader is ever lapped: every reader must see every event once, in
+// order, with nothing dropped.
+void test_no_loss_or_duplicates_within_capacity() {
+  const unsigned rounds = 500;
+  const unsigned perRound = EventBus::CAPACITY / PRODUCERS;
+  const unsigned perProducer = rounds * perRound;
+  static EventBus bus;
+
+  std::atomic<bool> stop(false);
+  std::atomic<uint32_t> progress[READERS];
+  std::vector<Seen> seen(READERS, Seen(perProducer));
+  std::vector<EventCursor> cursors(READERS);
+  std::vector<std::thread> readers;
+  for (unsigned r = 0; r < READERS; r++) {
+    progress[r].store(0);
+    readers.emplace_back([&, r]() {
+      BusEvent event;
+      while (!stop.load()) {
+        if (bus.read(cursors[r], event)) {
+          seen[r].add(event);
+          progress[r].store(seen[r].received + seen[r].torn);
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+
+  std::atomic<uint32_t> rejected(0);
+  for (unsigned round = 0; round < rounds; round++) {
+    std::vector<std::thread> producers;
+    for (unsigned p = 0; p < PRODUCERS; p++) {
+      producers.emplace_back([&, p, round]() {
+        char text[EventBus::TEXT_MAX + 1];
+        for (unsigned i = 0; i < perRound; i++) {
+          eventText(p, round * perRound + i, text);
+          if (!bus.publish(EVENT_INFO, text)) rejected++;
+        }
+      });
+    }
+    for (std::thread& t : producers) t.join();
+
+    uint32_t total = (round + 1) * perRound * PRODUCERS;
+    for (unsigned r = 0; r < READERS; r++) {
+      while (progress[r].load() < total) std::this_thread::yield();
+    }
+  }
+  stop = true;
+  for (std::thread& t : readers) t.join();
+
+  TEST_ASSERT_EQUAL(0, rejected.load());
+  TEST_ASSERT_EQUAL(0, bus.dropped());
+  TEST_ASSERT_EQUAL(rounds * perRound * PRODUCERS, bus.head());
+  for (unsigned r = 0; r < READERS; r++) {
+    TEST_ASSERT_EQUAL(0, seen[r].torn);
+    TEST_ASSERT_EQUAL(0, seen[r].outOfOrder);
+    TEST_ASSERT_EQUAL(0, cursors[r].missed);
+    TEST_ASSERT_EQUAL(bus.head(), seen[r].received);
+    for (unsigned p = 0; p < PRODUCERS; p++) {
+      for (unsigned n = 0; n < perProducer; n++) TEST_ASSERT_EQUAL(1, seen[r].count[p][n]);
+    }
+  }
+}
+
+// Producers run flat out while the readers lag behind by different amounts. Each
+// reader must still account for every sequence number, as received or missed, never
+// see an event twice or torn, and only see events whose publish() succeeded. The bus's
+// dropped() must equal the publishes that returned false.
+void test_lagging_readers_count_what_they_missed() {
+  const unsigned perProducer = 50000;
+  static EventBus bus;
+
+  std::atomic<unsigned> producersLeft(PRODUCERS);
+  std::vector<Seen> seen(READERS, Seen(perProducer));
+  std::vector<EventCursor> cursors(READERS);
+  std::vector<std::thread> readers;
+  for (unsigned r = 0; r < READERS; r++) {
+    readers.emplace_back([&, r]() {
+      BusEvent event;
+      uint32_t reads = 0;
+      for (;;) {
+        bool done = producersLeft.load() == 0;
+        bool got = bus.read(cursors[r], event);
+        if (got) seen[r].add(event);
+        if (!got && done) break;
+        // Reader 0 keeps up as best it can; the others stall now and then
+        if (r > 0 && ++reads % (r * 64) == 0) std::this_thread::sleep_for(std::chrono::microseconds(200));
+      }
+    });
+  }
+
+  std::vector<std::vector<uint8_t>> accepted(PRODUCERS, std::vector<uint8_t>(perProducer, 0));
+  std::atomic<uint32_t> rejected(0);
+  std::vector<std::thread> producers;
+  for (unsigned p = 0; p < PRODUCERS; p++) {
+    producers.emplace_back([&, p]() {
+      char text[EventBus::TEXT_MAX + 1];
+      for (unsigned n = 0; n < perProducer; n++) {
+        eventText(p, n, text);
+        if (bus.publish(EVENT_INFO, text)) accepted[p][n] = 1;
+        else rejected++;
+      }
+      producersLeft--;
+    });
+  }
+  for (std::thread& t : producers) t.join();
+  for (std::thread& t : readers) t.join();
+
+  uint32_t published = PRODUCERS * perProducer;
+  TEST_ASSERT_EQUAL(published, bus.head());
+  TEST_ASSERT_EQUAL(rejected.load(), bus.dropped());
+
+  uint32_t missedTotal = 0;
+  for (unsigned r = 0; r < READERS; r++) {
+    const Seen& s = seen[r];
+    TEST_ASSERT_EQUAL(0, s.torn);
+    TEST_ASSERT_EQUAL(0, s.outOfOrder);
+    for (unsigned p = 0; p < PRODUCERS; p++) {
+      for (unsigned n = 0; n < perProducer; n++) {
+        TEST_ASSERT_TRUE(s.count[p][n] <= accepted[p][n]);
+      }
+    }
+    // A dropped event near the end is never lapped, so the cursor may stop at it
+    uint32_t stuck = bus.head() - cursors[r].next;
+    TEST_ASSERT_TRUE(stuck == 0 || bus.dropped() > 0);
+    TEST_ASSERT_EQUAL(published, s.received + cursors[r].missed + stuck);
+    missedTotal += cursors[r].missed;
+  }
+  TEST_ASSERT_TRUE(missedTotal > 0); // The stalls did lap someone
+}
+
+// A reader that falls exactly one ring behind loses nothing; one more event costs it
+// the oldest one.
+void test_missed_count_at_the_capacity_boundary() {
+  EventBus bus;
+  EventCursor cursor;
+  BusEvent event;
+  char text[EventBus::TEXT_MAX + 1];
+  for (unsigned n = 0; n < EventBus::CAPACITY; n++) {
+    eventText(0, n, text);
+    TEST_ASSERT_TRUE(bus.publish(EVENT_INFO, text));
+  }
+  for (unsigned n = 0; n < EventBus::CAPACITY; n++) {
+    TEST_ASSERT_TRUE(bus.read(cursor, event));
+    TEST_ASSERT_EQUAL(n, event.sequence);
+  }
+  TEST_ASSERT_FALSE(bus.read(cursor, event));
+  TEST_ASSERT_EQUAL(0, cursor.missed);
+
+  for (unsigned n = 0; n < EventBus::CAPACITY + 3; n++) {
+    eventText(1, n, text);
+    TEST_ASSERT_TRUE(bus.publish(EVENT_INFO, text));
+  }
+  unsigned producer, n;
+  TEST_ASSERT_TRUE(bus.read(cursor, event));
+  TEST_ASSERT_EQUAL(3, cursor.missed);
+  TEST_ASSERT_TRUE(parseEvent(event, producer, n));
+  TEST_ASSERT_EQUAL(3, n);
+  TEST_ASSERT_EQUAL(0, bus.dropped());
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_missed_count_at_the_capacity_boundary);
+  RUN_TEST(test_no_loss_or_duplicates_within_capacity);
+  RUN_TEST(test_lagging_readers_count_what_they_missed);
+  return UNITY_END();
+}
@@ -0,0 +1,207 @@
+// HumidityRateWindow against a reference least-squares fit recomputed from scratch over
+// the same samples. The reference keeps the samples in a deque and applies the same
+// window rules (age, capacity, restart), so any difference is in the running sums.
+
+#include <deque>
+#include <math.h>
+#include <stdint.h>
+#include <unity.h>
+
+#include "HumidityRateWindow.h"
+
+struct Reference {
+  struct Sample {
+    uint32_t timestamp;
+    int32_t centi;
+  };
+
+  uint32_t windowMs;
+  size_t capacity;
+  std::deque<Sample> samples;
+
+  void add(uint32_t timestamp, float humidity) {
+    while (!samples.empty() &&
+           (timestamp - samples.front().timestamp > windowMs || samples.size() == capacity)) {
+      samples.pop_front();
+    }
+    float h = humidity < 0.0f ? 0.0f : (humidity > 100.0f ? 100.0f : humidity);
+    samples.push_back({timestamp, (int32_t)(h * 100.0f + 0.5f)});
+  }
+
+  void restart(size_t keep) {
+    while (samples.size() > keep) samples.pop_front();
+  }
+
+  // %RH per hour, two-pass least squares in double
+  double ratePerHour() const {
+    size_t n = samples.size();
+    if (n < 2) return 0.0;
+    double meanX = 0.0, meanY = 0.0;
+    for (const Sample& s : samples) {
+      meanX += (double)(uint32_t)(s.timestamp - samples.front().timestamp);
+      meanY += s.centi;
+    }
+    meanX /= n;
+    meanY /= n;
+    double sxx = 0.0, sxy = 0.0;
+    for (const Sample& s : samples) {
+      double dx = (double)(uint32_t)(s.timestamp - samples.front().timestamp) - meanX;
+      sxx += dx * dx;
+      sxy += dx * (s.centi - meanY);
+    }
+    if (sxx <= 0.0) return 0.0;
+    return sxy / sxx * 36000.0;
+  }
+};
+
+// Deterministic noise, so a failure reproduces
+static uint32_t seed = 1;
+static float noise(float amplitude) {
+  seed = seed * 1664525u + 1013904223u;
+  return amplitude * (((seed >> 8) / 16777216.0f) * 2.0f - 1.0f);
+}
+
+template <size_t Capacity>
+static void expectMatches(const HumidityRateWindow<Capacity>& window, const Reference& reference) {
+  TEST_ASSERT_EQUAL(reference.samples.size(), window.size());
+  double expected = reference.ratePerHour();
+  TEST_ASSERT_FLOAT_WITHIN(1e-4 + fabs(expected) * 1e-5, expected, window.ratePerHour());
+}
+
+void setUp() {
+  seed = 1;
+}
+
+void tearDown() {}
+
+void test_empty_and_single_sample_have_no_rate() {
+  HumidityRateWindow<16> window(60000);
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, window.ratePerHour());
+  window.add(1000, 40.0f);
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, window.ratePerHour());
+}
+
+void test_straight_line_gives_its_slope() {
+  HumidityRateWindow<960> window(30 * 60000);
+  for (uint32_t t = 0; t <= 20 * 60000; t += 2000) window.add(t, 60.0f - t / 3600000.0f * 6.0f);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, -6.0f, window.ratePerHour());
+}
+
+// A noisy drying curve over three days, sampled every 2 s like the firmware
+void test_matches_reference_over_days_of_sliding_window() {
+  const uint32_t windowMs = 30 * 60000;
+  HumidityRateWindow<960> window(windowMs);
+  Reference reference = {windowMs, 960, {}};
+  for (uint32_t t = 0; t < 3 * 86400000u; t += 2000) {
+    float h = 20.0f + 30.0f * expf(-t / 36000000.0f) + noise(0.3f);
+    window.add(t, h);
+    reference.add(t, h);
+    if ((t / 2000) % 997 == 0) expectMatches(window, reference);
+  }
+  expectMatches(window, reference);
+}
+
+// Gaps and jitter in the timestamps, including one longer than the window
+void test_matches_reference_with_irregular_timestamps() {
+  const uint32_t windowMs = 10 * 60000;
+  HumidityRateWindow<400> window(windowMs);
+  Reference reference = {windowMs, 400, {}};
+  uint32_t t = 5000;
+  for (int i = 0; i < 20000; i++) {
+    seed = seed * 1664525u + 1013904223u;
+    t += 500 + (seed >> 20);                    // 0.5-4.6 s
+    if (i == 7000) t += windowMs + 1;           // Everything before is dropped
+    float h = 45.0f + 10.0f * sinf(i / 700.0f) + noise(0.5f);
+    window.add(t, h);
+    reference.add(t, h);
+    if (i % 251 == 0 || i == 7000) expectMatches(window, reference);
+  }
+}
+
+// With a long window, the capacity decides what is evicted
+void test_matches_reference_when_capacity_bounds_the_window() {
+  HumidityRateWindow<64> window(3600000);
+  Reference reference = {3600000, 64, {}};
+  for (uint32_t t = 0; t < 2000 * 2000; t += 2000) {
+    float h = 70.0f - t / 100000.0f + noise(0.2f);
+    window.add(t, h);
+    reference.add(t, h);
+  }
+  TEST_ASSERT_EQUAL(64, window.size());
+  expectMatches(window, reference);
+}
+
+// millis() wraps after 49.7 days; the offsets must carry on across it
+void test_matches_reference_across_millis_wrap() {
+  const uint32_t windowMs = 30 * 60000;
+  HumidityRateWindow<960> window(windowMs);
+  Reference reference = {windowMs, 960, {}};
+  uint32_t t = 0xFFFFFFFFu - 20 * 60000;
+  for (int i = 0; i < 2000; i++, t += 2000) {
+    float h = 30.0f + i * 0.004f + noise(0.1f);
+    window.add(t, h);
+    reference.add(t, h);
+    if (i % 50 == 0) expectMatches(window, reference);
+  }
+  expectMatches(window, reference);
+}
+
+// Readings out of the sensor's range are clamped before they reach the sums
+void test_clamps_out_of_range_humidity() {
+  HumidityRateWindow<16> window(60000);
+  Reference reference = {60000, 16, {}};
+  const float values[] = {-5.0f, 0.0f, 50.0f, 100.0f, 120.0f, 99.99f};
+  for (int i = 0; i < 6; i++) {
+    window.add(i * 2000, values[i]);
+    reference.add(i * 2000, values[i]);
+  }
+  expectMatches(window, reference);
+}
+
+// restart(keep) re-bases the sums onto the kept samples and the window carries on
+void test_restart_keeps_newest_samples_and_matches_reference() {
+  const uint32_t windowMs = 30 * 60000;
+  HumidityRateWindow<960> window(windowMs);
+  Reference reference = {windowMs, 960, {}};
+  uint32_t t = 0;
+  for (int i = 0; i < 600; i++, t += 2000) {
+    float h = 55.0f - i * 0.01f + noise(0.2f);
+    window.add(t, h);
+    reference.add(t, h);
+  }
+
+  window.restart(15);
+  reference.restart(15);
+  expectMatches(window, reference);
+  TEST_ASSERT_TRUE(window.ratePerHour() != 0.0f); // No cold start
+
+  for (int i = 0; i < 1500; i++, t += 2000) {
+    float h = 40.0f + i * 0.002f + noise(0.2f);
+    window.add(t, h);
+    reference.add(t, h);
+    if (i % 100 == 0) expectMatches(window, reference);
+  }
+
+  window.restart(200); // More than it holds: nothing changes
+  reference.restart(200);
+  expectMatches(window, reference);
+  window.restart(0);
+  reference.restart(0);
+  TEST_ASSERT_EQUAL(0, window.size());
+  window.add(t, 50.0f);
+  window.add(t + 2000, 51.0f);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 1800.0f, window.ratePerHour());
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_empty_and_single_sample_have_no_rate);
+  RUN_TEST(test_straight_line_gives_its_slope);
+  RUN_TEST(test_matches_reference_over_days_of_sliding_window);
+  RUN_TEST(test_matches_reference_with_irregular_timestamps);
+  RUN_TEST(test_matches_reference_when_capacity_bounds_the_window);
+  RUN_TEST(test_matches_reference_across_millis_wrap);
+  RUN_TEST(test_clamps_out_of_range_humidity);
+  RUN_TEST(test_restart_keeps_newest_samples_and_matches_reference);
+  return UNITY_END();
+}
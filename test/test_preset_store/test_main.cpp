@@ -0,0 +1,344 @@
+// PresetStore under power cuts. The stdio calls that change a file (fopen for writing,
+// fwrite, remove, rename) are replaced below by versions that count every byte written
+// and every file operation as one step. A test runs an edit or a compaction with the
+// power failing after 0, 1, 2, ... steps, then "reboots": a new table and store load
+// what is on disk, which must be the presets from before the edit or after it, and the
+// store must go on accepting edits.
+//
+// The replacements rely on glibc's symbol interposition, as the heap counting in
+// bench/hotpath_bench.cpp does, so this runs on Linux only.
+
+#include <algorithm>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unity.h>
+#include <vector>
+
+#include "PresetStore.h"
+
+static long stepsLeft = -1; // Before the power fails; -1 = no cut planned
+static bool powerLost = false;
+
+static bool step() {
+  if (stepsLeft < 0) return true;
+  if (stepsLeft == 0) {
+    powerLost = true;
+    return false;
+  }
+  stepsLeft--;
+  return true;
+}
+
+extern "C" {
+FILE* fopen(const char* path, const char* mode) {
+  bool creates = strchr(mode, 'w') != nullptr;
+  if ((creates || strchr(mode, 'a')) && powerLost) return nullptr;
+  if (creates && !step()) return nullptr; // Truncating is a change on its own
+  return fopen64(path, mode);
+}
+
+size_t fwrite(const void* data, size_t size, size_t count, FILE* f) {
+  size_t bytes = size * count;
+  if (stepsLeft >= 0 && (size_t)stepsLeft < bytes) {
+    bytes = stepsLeft;
+    powerLost = true;
+  }
+  if (stepsLeft >= 0) stepsLeft -= bytes;
+  return size == 0 ? 0 : fwrite_unlocked(data, 1, bytes, f) / size;
+}
+
+int remove(const char* path) __THROW {
+  return step() ? unlink(path) : -1;
+}
+
+int rename(const char* from, const char* to) __THROW {
+  return step() ? renameat(AT_FDCWD, from, AT_FDCWD, to) : -1;
+}
+}
+
+static char directory[32];
+static char snapshotDir[32];
+
+static std::string filePath(const char* dir, const char* file) {
+  return std::string(dir) + "/" + file;
+}
+
+static long fileSize(const char* file) {
+  struct stat st;
+  return stat(filePath(directory, file).c_str(), &st) == 0 ? (long)st.st_size : -1;
+}
+
+static void copyFiles(const char* from, const char* to) {
+  const char* files[] = {"presets.json", "presets.jnl", "presets.tmp"};
+  for (const char* file : files) {
+    std::string dst = filePath(to, file);
+    unlink(dst.c_str());
+    FILE* in = fopen(filePath(from, file).c_str(), "rb");
+    if (!in) continue;
+    FILE* out = fopen(dst.c_str(), "wb");
+    char buf[512];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), in)) > 0) fwrite(buf, 1, n, out);
+    fclose(out);
+    fclose(in);
+  }
+}
+
+// The table's contents, one line per preset in table order
+static std::string describe(const PresetTable& table) {
+  std::string s;
+  for (size_t i = 0; i < table.size(); i++) {
+    PresetValues v = table.values(i);
+    char line[512];
+    snprintf(line, sizeof(line), "%s|%s|%d|%g %g %g %g %g|%u %u %u|%d %d %d|%g %g %g|%g %g %g\n",
+             table.name(i), table.notes(i), v.isDefault, v.dryingTemp, v.setpointHum, v.warmTemp,
+             v.humHyst, v.stallDelta, (unsigned)v.stallInterval, (unsigned)v.heatDur,
+             (unsigned)v.logInt, v.heatAction, v.mode, v.control, v.kp, v.ki, v.kd, v.modelGain,
+             v.modelTau, v.modelDeadTime);
+    s += line;
+  }
+  return s;
+}
+
+static PresetValues presetValues(float dryingTemp, int mode) {
+  PresetValues v;
+  v.setDefaults();
+  v.dryingTemp = dryingTemp;
+  v.setpointHum = 15.0f;
+  v.warmTemp = 35.0f;
+  v.humHyst = 2.5f;
+  v.stallInterval = 1800000;
+  v.stallDelta = 0.5f;
+  v.heatDur = 14400000;
+  v.logInt = 60000;
+  v.mode = mode;
+  return v;
+}
+
+static void addPresets(PresetTable& table) {
+  table.put("PLA", "Keep below 50 C", presetValues(45.0f, 0));
+  table.put("PETG", "", presetValues(65.0f, 0));
+  table.put("ABS", "Vent the \"chamber\"\nafterwards", presetValues(80.0f, 1));
+  table.setDefault(0);
+}
+
+typedef void (*Setup)(PresetTable& table, PresetStore& store);
+typedef bool (*Edit)(PresetTable& table, PresetStore& store);
+
+struct CutCounts {
+  int cuts;
+  int before, after;
+  int tornHeader;    // Journal shorter than its header
+  int tornRecord;    // Journal ending inside the record being appended
+  int jsonMissing;   // Between removing presets.json and renaming presets.tmp
+  int tmpPartial;    // presets.tmp cut short next to presets.json
+};
+
+// Runs edit with the power failing at every step, from the state setup leaves on disk
+static CutCounts cutEverywhere(Setup setup, Edit edit) {
+  CutCounts counts = {};
+
+  // Build the starting files once; each run starts from a copy
+  std::string before, after;
+  long journalBefore;
+  std::vector<long> journals; // Journal size left by each cut
+  {
+    PresetTable table;
+    PresetStore store(table, snapshotDir);
+    setup(table, store);
+    before = describe(table);
+  }
+  copyFiles(snapshotDir, directory);
+  {
+    PresetTable table;
+    PresetStore store(table, directory);
+    store.load();
+    TEST_ASSERT_EQUAL_STRING(before.c_str(), describe(table).c_str());
+    journalBefore = fileSize("presets.jnl");
+    TEST_ASSERT_TRUE(edit(table, store));
+    after = describe(table);
+  }
+  TEST_ASSERT_TRUE(before != after);
+
+  for (long cut = 0;; cut++) {
+    copyFiles(snapshotDir, directory);
+    PresetTable table;
+    PresetStore store(table, directory);
+    store.load();
+    stepsLeft = cut;
+    powerLost = false;
+    edit(table, store);
+    bool finished = !powerLost;
+    stepsLeft = -1;
+    powerLost = false;
+
+    long journal = fileSize("presets.jnl");
+    bool jsonMissing = fileSize("presets.json") < 0;
+    if (journal >= 0 && journal < 16) counts.tornHeader++;
+    journals.push_back(journal);
+    if (jsonMissing) counts.jsonMissing++;
+    if (!jsonMissing && fileSize("presets.tmp") >= 0) counts.tmpPartial++;
+
+    // Reboot
+    PresetTable loaded;
+    PresetStore reloaded(loaded, directory);
+    TEST_ASSERT_TRUE(reloaded.load());
+    TEST_ASSERT_FALSE(reloaded.snapshotDamaged());
+    if (jsonMissing) TEST_ASSERT_TRUE(fileSize("presets.json") > 0);
+    TEST_ASSERT_TRUE(fileSize("presets.tmp") < 0);
+    std::string state = describe(loaded);
+    if (finished) {
+      TEST_ASSERT_EQUAL_STRING(after.c_str(), state.c_str());
+    } else if (state == before) {
+      counts.before++;
+    } else {
+      TEST_ASSERT_EQUAL_STRING_MESSAGE(after.c_str(), state.c_str(), "Neither before nor after the edit");
+      counts.after++;
+    }
+
+    // Later edits are kept
+    int added = loaded.put("After the cut", "", presetValues(50.0f, 2));
+    TEST_ASSERT_TRUE(added >= 0);
+    TEST_ASSERT_TRUE(reloaded.savePreset(added));
+    std::string expected = describe(loaded);
+    PresetTable again;
+    PresetStore rebooted(again, directory);
+    TEST_ASSERT_TRUE(rebooted.load());
+    TEST_ASSERT_EQUAL_STRING(expected.c_str(), describe(again).c_str());
+
+    if (finished) break;
+    counts.cuts++;
+  }
+
+  // The journal grows by one record, and stays at its longest until it is removed
+  long longest = *std::max_element(journals.begin(), journals.end());
+  for (long journal : journals) {
+    if (journal > journalBefore && journal > 16 && journal < longest) counts.tornRecord++;
+  }
+  return counts;
+}
+
+// --- Starting states ---
+
+static void snapshotOnly(PresetTable& table, PresetStore& store) {
+  addPresets(table);
+  TEST_ASSERT_TRUE(store.compact());
+}
+
+static void snapshotAndJournal(PresetTable& table, PresetStore& store) {
+  snapshotOnly(table, store);
+  int i = table.put("TPU", "Slow", presetValues(50.0f, 0));
+  TEST_ASSERT_TRUE(store.savePreset(i));
+  table.setDefault(table.find("PETG"));
+  TEST_ASSERT_TRUE(store.saveDefault("PETG"));
+  TEST_ASSERT_TRUE(store.journalBytes() > 16);
+}
+
+// A journal with room for a short record but not for a long one
+static void journalNearLimit(PresetTable& table, PresetStore& store) {
+  snapshotOnly(table, store);
+  for (int n = 0; store.journalBytes() < PresetStore::JOURNAL_LIMIT - 150; n++) {
+    PresetValues v = presetValues(40.0f + n % 40, n % 3);
+    table.setValues(table.find("PLA"), v);
+    TEST_ASSERT_TRUE(store.savePreset(table.find("PLA")));
+  }
+}
+
+// --- Edits ---
+
+static bool changeValues(PresetTable& table, PresetStore& store) {
+  int i = table.find("PETG");
+  PresetValues v = table.values(i);
+  v.dryingTemp = 70.0f;
+  v.modelGain = 0.5f;
+  table.setValues(i, v);
+  return store.savePreset(i);
+}
+
+static bool renamePreset(PresetTable& table, PresetStore& store) {
+  TEST_ASSERT_TRUE(table.rename(table.find("ABS"), "ABS (vented)"));
+  return store.saveRename("ABS", "ABS (vented)");
+}
+
+static bool removePreset(PresetTable& table, PresetStore& store) {
+  table.remove(table.find("PLA"));
+  return store.saveRemove("PLA");
+}
+
+static bool addLongNotes(PresetTable& table, PresetStore& store) {
+  std::string notes(200, 'n');
+  int i = table.put("Nylon", notes.c_str(), presetValues(70.0f, 0));
+  return store.savePreset(i);
+}
+
+// Compaction of a change that is not in the journal, as after a failed append
+static bool compactUnjournalled(PresetTable& table, PresetStore& store) {
+  table.setDefault(table.find("ABS"));
+  return store.compact();
+}
+
+void setUp() {
+  strcpy(directory, "/tmp/presetsXXXXXX");
+  strcpy(snapshotDir, "/tmp/presetsXXXXXX");
+  TEST_ASSERT_TRUE(mkdtemp(directory) != nullptr);
+  TEST_ASSERT_TRUE(mkdtemp(snapshotDir) != nullptr);
+}
+
+void tearDown() {
+  stepsLeft = -1;
+  powerLost = false;
+  const char* files[] = {"presets.json", "presets.jnl", "presets.tmp"};
+  for (const char* file : files) {
+    unlink(filePath(directory, file).c_str());
+    unlink(filePath(snapshotDir, file).c_str());
+  }
+  rmdir(directory);
+  rmdir(snapshotDir);
+}
+
+void test_cut_while_starting_a_journal() {
+  CutCounts c = cutEverywhere(snapshotOnly, changeValues);
+  TEST_ASSERT_TRUE(c.tornHeader >= 16); // Every header length, including none
+  TEST_ASSERT_TRUE(c.tornRecord > 50);
+  TEST_ASSERT_EQUAL(c.cuts, c.before);  // The record is the last thing written
+}
+
+void test_cut_while_appending_to_a_journal() {
+  CutCounts put = cutEverywhere(snapshotAndJournal, changeValues);
+  TEST_ASSERT_TRUE(put.tornRecord > 50);
+  TEST_ASSERT_EQUAL(0, put.tornHeader);
+  CutCounts renamed = cutEverywhere(snapshotAndJournal, renamePreset);
+  TEST_ASSERT_TRUE(renamed.tornRecord > 10);
+  CutCounts removed = cutEverywhere(snapshotAndJournal, removePreset);
+  TEST_ASSERT_TRUE(removed.tornRecord > 0);
+}
+
+void test_cut_while_compacting() {
+  CutCounts c = cutEverywhere(snapshotAndJournal, compactUnjournalled);
+  TEST_ASSERT_TRUE(c.tmpPartial > 100); // Every length of presets.tmp
+  TEST_ASSERT_EQUAL(1, c.jsonMissing);  // After remove(presets.json), before the rename
+  TEST_ASSERT_TRUE(c.before > 0);
+  TEST_ASSERT_TRUE(c.after >= 2);       // From the rename on
+}
+
+void test_cut_while_an_append_overflows_into_compaction() {
+  CutCounts c = cutEverywhere(journalNearLimit, addLongNotes);
+  TEST_ASSERT_TRUE(c.tornRecord > 200); // 200 bytes of notes
+  TEST_ASSERT_TRUE(c.tmpPartial > 100);
+  TEST_ASSERT_EQUAL(1, c.jsonMissing);
+  TEST_ASSERT_TRUE(c.after > c.tmpPartial); // Once the record is whole, the edit stays
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_cut_while_starting_a_journal);
+  RUN_TEST(test_cut_while_appending_to_a_journal);
+  RUN_TEST(test_cut_while_compacting);
+  RUN_TEST(test_cut_while_an_append_overflows_into_compaction);
+  return UNITY_END();
+}
@@ -0,0 +1,206 @@
+// SensorFilter on generated SHT31 traces: a true signal (constant, ramp) plus seeded
+// Gaussian noise, spikes and dropouts, sampled every 250 ms as the control task does.
+// The filter settings are the firmware's own, from ChamberProbes.h. No recorded SHT31
+// log exists to replay, so the noise is set from the filters' own measurementNoise.
+
+#include <math.h>
+#include <stdint.h>
+#include <unity.h>
+#include <vector>
+
+#include "ChamberProbes.h"
+#include "SensorFilter.h"
+
+static const float DT = 0.25f; // s
+
+// Deterministic trace generator
+struct Trace {
+  uint32_t seed;
+  float sigma;       // Noise, 1 sigma
+  int spikeEvery;    // Samples between spikes, 0 = none
+  int spikeLength;   // Samples per spike
+  float spikeHeight;
+
+  struct Sample {
+    float truth;
+    float measured;
+  };
+
+  float uniform() {
+    seed = seed * 1664525u + 1013904223u;
+    return ((seed >> 8) + 0.5f) / 16777216.0f;
+  }
+
+  float gaussian() {
+    return sqrtf(-2.0f * logf(uniform())) * cosf(6.2831853f * uniform());
+  }
+
+  // truth(t) sampled every DT for seconds
+  template <typename Signal>
+  std::vector<Sample> generate(Signal truth, float seconds) {
+    std::vector<Sample> samples;
+    int n = (int)(seconds / DT);
+    for (int i = 0; i < n; i++) {
+      float t = i * DT;
+      float y = truth(t);
+      float measured = y + sigma * gaussian();
+      if (spikeEvery > 0 && i % spikeEvery < spikeLength && i >= spikeEvery) measured += spikeHeight;
+      samples.push_back({y, measured});
+    }
+    return samples;
+  }
+};
+
+void setUp() {}
+
+void tearDown() {}
+
+// On a steady humidity the output is much quieter than the input, and the reported
+// sigma covers the actual error
+void test_steady_noise_is_smoothed_and_sigma_is_honest() {
+  Trace trace = {12345, PROBE_HUMIDITY_FILTER.measurementNoise, 0, 0, 0.0f};
+  std::vector<Trace::Sample> samples = trace.generate([](float) { return 40.0f; }, 1800.0f);
+  SensorFilter filter(PROBE_HUMIDITY_FILTER);
+  double sumSquares = 0.0, rateSum = 0.0;
+  int counted = 0, outside = 0;
+  for (size_t i = 0; i < samples.size(); i++) {
+    filter.add(samples[i].measured, DT);
+    if (i < 240) continue; // First minute: settling
+    float error = filter.value() - samples[i].truth;
+    sumSquares += error * error;
+    rateSum += filter.rate();
+    counted++;
+    if (fabsf(error) > 3.0f * filter.uncertainty()) outside++;
+  }
+  float rms = sqrtf(sumSquares / counted);
+  TEST_ASSERT_TRUE(rms < PROBE_HUMIDITY_FILTER.measurementNoise / 2.5f);
+  TEST_ASSERT_TRUE(outside < counted / 50);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.0f, rateSum / counted); // No drift
+}
+
+// Spikes up to two samples long never reach the output
+void test_spikes_are_rejected() {
+  for (int length = 1; length <= 2; length++) {
+    Trace trace = {777u + length, PROBE_TEMPERATURE_FILTER.measurementNoise, 23, length, 40.0f};
+    std::vector<Trace::Sample> samples = trace.generate([](float) { return 55.0f; }, 600.0f);
+    SensorFilter filter(PROBE_TEMPERATURE_FILTER);
+    float worst = 0.0f;
+    for (size_t i = 0; i < samples.size(); i++) {
+      filter.add(samples[i].measured, DT);
+      if (i < 40) continue;
+      float error = fabsf(filter.value() - samples[i].truth);
+      if (error > worst) worst = error;
+    }
+    TEST_ASSERT_TRUE_MESSAGE(worst < 0.3f, length == 1 ? "Single-sample spikes" : "Two-sample spikes");
+  }
+
+  // Negative spikes (a read of 0 %RH) as well
+  Trace trace = {99, PROBE_HUMIDITY_FILTER.measurementNoise, 17, 2, -30.0f};
+  std::vector<Trace::Sample> samples = trace.generate([](float) { return 30.0f; }, 600.0f);
+  SensorFilter filter(PROBE_HUMIDITY_FILTER);
+  for (size_t i = 0; i < samples.size(); i++) {
+    filter.add(samples[i].measured, DT);
+    if (i >= 40) TEST_ASSERT_FLOAT_WITHIN(0.5f, samples[i].truth, filter.value());
+  }
+}
+
+// A warm-up ramp of 1 C per 30 s: once locked on, the estimate follows the ramp with
+// no more lag than the median's two samples, and the rate is right
+void test_ramp_is_tracked_without_lag() {
+  const float slope = 1.0f / 30.0f; // C/s
+  Trace trace = {2024, PROBE_TEMPERATURE_FILTER.measurementNoise, 0, 0, 0.0f};
+  auto warmUp = [slope](float t) {
+    if (t < 120.0f) return 25.0f;
+    if (t < 1020.0f) return 25.0f + slope * (t - 120.0f);
+    return 55.0f;
+  };
+  std::vector<Trace::Sample> samples = trace.generate(warmUp, 1500.0f);
+  SensorFilter filter(PROBE_TEMPERATURE_FILTER);
+  double lagSum = 0.0, rateSum = 0.0;
+  int onRamp = 0;
+  float overshoot = 0.0f;
+  for (size_t i = 0; i < samples.size(); i++) {
+    filter.add(samples[i].measured, DT);
+    float t = i * DT;
+    if (t >= 240.0f && t < 1020.0f) { // Two minutes into the ramp, to its end
+      float lag = samples[i].truth - filter.value();
+      TEST_ASSERT_TRUE(fabsf(lag) < 0.4f);
+      lagSum += lag;
+      rateSum += filter.rate();
+      onRamp++;
+    }
+    if (t >= 1020.0f) {
+      float over = filter.value() - 55.0f;
+      if (over > overshoot) overshoot = over;
+      if (t >= 1200.0f) TEST_ASSERT_FLOAT_WITHIN(0.3f, 55.0f, filter.value());
+    }
+  }
+  float meanLag = lagSum / onRamp;
+  TEST_ASSERT_TRUE(meanLag > -0.02f);
+  TEST_ASSERT_TRUE(meanLag < 2.0f * DT * slope + 0.03f); // Two median samples behind
+  TEST_ASSERT_FLOAT_WITHIN(slope * 0.1f, slope, rateSum / onRamp);
+  TEST_ASSERT_TRUE(overshoot < 1.0f);
+}
+
+// Dropouts shorter than maxMissed coast on the rate with growing uncertainty; a good
+// sample resets the count; maxMissed in a row drop the estimate until the next sample
+void test_dropouts_coast_then_reset_after_max_missed() {
+  SensorFilter filter(PROBE_TEMPERATURE_FILTER);
+  TEST_ASSERT_FALSE(filter.isValid());
+  filter.add(NAN, DT); // Nothing to coast on yet
+  TEST_ASSERT_FALSE(filter.isValid());
+  TEST_ASSERT_TRUE(isnan(filter.value()));
+  TEST_ASSERT_TRUE(isnan(filter.uncertainty()));
+
+  Trace trace = {5, PROBE_TEMPERATURE_FILTER.measurementNoise, 0, 0, 0.0f};
+  std::vector<Trace::Sample> samples = trace.generate([](float t) { return 30.0f + 0.02f * t; }, 300.0f);
+  for (const Trace::Sample& s : samples) filter.add(s.measured, DT);
+  TEST_ASSERT_TRUE(filter.isValid());
+
+  for (int round = 0; round < 3; round++) {
+    float value = filter.value();
+    float rate = filter.rate();
+    float sigma = filter.uncertainty();
+    for (int i = 1; i < PROBE_TEMPERATURE_FILTER.maxMissed; i++) {
+      filter.add(NAN, DT);
+      TEST_ASSERT_TRUE(filter.isValid());
+      TEST_ASSERT_FLOAT_WITHIN(1e-3f, value + rate * DT * i, filter.value());
+      TEST_ASSERT_TRUE(filter.uncertainty() > sigma);
+      sigma = filter.uncertainty();
+    }
+    filter.add(filter.value() + rate * DT, DT); // One good read resets the count
+    TEST_ASSERT_TRUE(filter.isValid());
+  }
+
+  for (int i = 0; i < PROBE_TEMPERATURE_FILTER.maxMissed; i++) filter.add(NAN, DT);
+  TEST_ASSERT_FALSE(filter.isValid());
+  TEST_ASSERT_TRUE(isnan(filter.value()));
+  TEST_ASSERT_TRUE(isnan(filter.uncertainty()));
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, filter.rate());
+
+  // Starts over from the next read, without the old median window or rate
+  filter.add(80.0f, DT);
+  TEST_ASSERT_TRUE(filter.isValid());
+  TEST_ASSERT_EQUAL_FLOAT(80.0f, filter.value());
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, filter.rate());
+  TEST_ASSERT_FLOAT_WITHIN(1e-4f, PROBE_TEMPERATURE_FILTER.measurementNoise, filter.uncertainty());
+}
+
+void test_default_filter_passes_samples_through() {
+  SensorFilter filter;
+  filter.add(12.5f, DT);
+  TEST_ASSERT_EQUAL_FLOAT(12.5f, filter.value());
+  TEST_ASSERT_EQUAL_FLOAT(12.5f, filter.lastMedian());
+  filter.add(NAN, DT); // maxMissed 1
+  TEST_ASSERT_FALSE(filter.isValid());
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_steady_noise_is_smoothed_and_sigma_is_honest);
+  RUN_TEST(test_spikes_are_rejected);
+  RUN_TEST(test_ramp_is_tracked_without_lag);
+  RUN_TEST(test_dropouts_coast_then_reset_after_max_missed);
+  RUN_TEST(test_default_filter_passes_samples_through);
+  return UNITY_END();
+}
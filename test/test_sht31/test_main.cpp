@@ -0,0 +1,259 @@
+// Sht31Sensor against a mock SHT31 on a mock I2C bus. Like the real part, the mock NACKs
+// a read until its measurement is done, and NACKs commands while it is measuring.
+
+#include <math.h>
+#include <stdint.h>
+#include <unity.h>
+#include <vector>
+
+#include "ChamberProbes.h"
+#include "Checksum.h"
+#include "Sht31Sensor.h"
+
+struct MockSht31 {
+  uint8_t address = 0x44;
+  bool present = true;
+  uint32_t now = 0;           // Bus time, set by the test
+  uint32_t conversionMs = 12; // How long a measurement takes; UINT32_MAX = never ends
+  uint16_t rawT = 0x6666;     // 25.0 C
+  uint16_t rawH = 0x8000;     // 50.0 %RH
+  bool badTemperatureCrc = false;
+  bool badHumidityCrc = false;
+
+  bool busy = false;
+  bool hasResult = false;
+  uint32_t startedAt = 0;
+  std::vector<uint16_t> commands; // Acknowledged
+  int reads = 0;                  // Attempted
+  int nacks = 0;
+
+  bool done() const { return conversionMs != UINT32_MAX && now - startedAt >= conversionMs; }
+};
+
+static bool mockWrite(void* ctx, uint8_t address, const uint8_t* data, size_t len) {
+  MockSht31* m = (MockSht31*)ctx;
+  if (!m->present || address != m->address || len != 2) return false;
+  if (m->busy && !m->done()) {
+    m->nacks++;
+    return false;
+  }
+  m->busy = false;
+  uint16_t code = (uint16_t)(data[0] << 8 | data[1]);
+  m->commands.push_back(code);
+  if (code == 0x2400) {
+    m->busy = true;
+    m->hasResult = false;
+    m->startedAt = m->now;
+  }
+  return true;
+}
+
+static bool mockRead(void* ctx, uint8_t address, uint8_t* data, size_t len) {
+  MockSht31* m = (MockSht31*)ctx;
+  m->reads++;
+  if (!m->present || address != m->address || len != 6) return false;
+  if (m->busy && m->done()) {
+    m->busy = false;
+    m->hasResult = true;
+  }
+  if (!m->hasResult) {
+    m->nacks++;
+    return false;
+  }
+  m->hasResult = false;
+  data[0] = (uint8_t)(m->rawT >> 8);
+  data[1] = (uint8_t)m->rawT;
+  data[2] = crc8(data, 2) ^ (m->badTemperatureCrc ? 0x01 : 0x00);
+  data[3] = (uint8_t)(m->rawH >> 8);
+  data[4] = (uint8_t)m->rawH;
+  data[5] = crc8(data + 3, 2) ^ (m->badHumidityCrc ? 0x80 : 0x00);
+  return true;
+}
+
+static MockSht31 mock;
+
+// Moves bus time and polls
+static Sht31Sensor::Status pollAt(Sht31Sensor& sensor, uint32_t nowMs) {
+  mock.now = nowMs;
+  return sensor.poll(nowMs);
+}
+
+static bool startAt(Sht31Sensor& sensor, uint32_t nowMs) {
+  mock.now = nowMs;
+  return sensor.start(nowMs);
+}
+
+void setUp() {
+  mock = MockSht31();
+}
+
+void tearDown() {}
+
+void test_crc8_matches_datasheet_example() {
+  const uint8_t data[2] = {0xBE, 0xEF};
+  TEST_ASSERT_EQUAL(0x92, crc8(data, 2));
+}
+
+void test_begin_soft_resets_and_reports_a_missing_sensor() {
+  Sht31Sensor sensor(mockWrite, mockRead, &mock);
+  TEST_ASSERT_TRUE(sensor.begin());
+  TEST_ASSERT_EQUAL(1, mock.commands.size());
+  TEST_ASSERT_EQUAL(0x30A2, mock.commands[0]);
+
+  Sht31Sensor other(mockWrite, mockRead, &mock, 0x45);
+  TEST_ASSERT_FALSE(other.begin());
+  TEST_ASSERT_EQUAL(1, other.getBusErrors());
+}
+
+void test_reads_after_measure_time() {
+  Sht31Sensor sensor(mockWrite, mockRead, &mock);
+  TEST_ASSERT_TRUE(isnan(sensor.temperature()));
+  TEST_ASSERT_TRUE(startAt(sensor, 1000));
+  TEST_ASSERT_EQUAL(0x2400, mock.commands.back());
+  TEST_ASSERT_EQUAL(Sht31Sensor::MEASURING, pollAt(sensor, 1000 + Sht31Sensor::MEASURE_MS - 1));
+  TEST_ASSERT_EQUAL(0, mock.reads); // Not asked before the measurement can be done
+  TEST_ASSERT_EQUAL(Sht31Sensor::READY, pollAt(sensor, 1000 + Sht31Sensor::MEASURE_MS));
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 25.0f, sensor.temperature());
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 50.0f, sensor.humidity());
+  TEST_ASSERT_EQUAL(Sht31Sensor::IDLE, pollAt(sensor, 1020));
+  TEST_ASSERT_FALSE(sensor.isMeasuring());
+}
+
+// A slow sensor NACKs the read; that is not an error until the timeout
+void test_nack_until_ready() {
+  mock.conversionMs = 40;
+  Sht31Sensor sensor(mockWrite, mockRead, &mock);
+  TEST_ASSERT_TRUE(startAt(sensor, 0));
+  for (uint32_t t = Sht31Sensor::MEASURE_MS; t < 40; t += 4) {
+    TEST_ASSERT_EQUAL(Sht31Sensor::MEASURING, pollAt(sensor, t));
+  }
+  TEST_ASSERT_TRUE(mock.nacks >= 6);
+  TEST_ASSERT_EQUAL(Sht31Sensor::READY, pollAt(sensor, 40));
+  TEST_ASSERT_EQUAL(0, sensor.getBusErrors());
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 25.0f, sensor.temperature());
+}
+
+// A sensor that never finishes fails the measurement at TIMEOUT_MS and keeps the last
+// good reading; the next start() works again
+void test_timeout_fails_and_keeps_last_reading() {
+  Sht31Sensor sensor(mockWrite, mockRead, &mock);
+  TEST_ASSERT_TRUE(startAt(sensor, 0));
+  TEST_ASSERT_EQUAL(Sht31Sensor::READY, pollAt(sensor, 20));
+
+  mock.conversionMs = UINT32_MAX;
+  mock.rawT = 0x8000;
+  TEST_ASSERT_TRUE(startAt(sensor, 100));
+  for (uint32_t t = 100 + Sht31Sensor::MEASURE_MS; t < 100 + Sht31Sensor::TIMEOUT_MS; t += 7) {
+    TEST_ASSERT_EQUAL(Sht31Sensor::MEASURING, pollAt(sensor, t));
+  }
+  TEST_ASSERT_EQUAL(Sht31Sensor::MEASURING, pollAt(sensor, 100 + Sht31Sensor::TIMEOUT_MS - 1));
+  TEST_ASSERT_EQUAL(Sht31Sensor::FAILED, pollAt(sensor, 100 + Sht31Sensor::TIMEOUT_MS));
+  TEST_ASSERT_EQUAL(1, sensor.getBusErrors());
+  TEST_ASSERT_FALSE(sensor.isMeasuring());
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 25.0f, sensor.temperature());
+  TEST_ASSERT_EQUAL(Sht31Sensor::IDLE, pollAt(sensor, 300));
+
+  mock.conversionMs = 12;
+  mock.busy = false; // Power-cycled
+  TEST_ASSERT_TRUE(startAt(sensor, 400));
+  TEST_ASSERT_EQUAL(Sht31Sensor::READY, pollAt(sensor, 420));
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 42.5f, sensor.temperature());
+}
+
+void test_crc_mismatch_fails_and_keeps_last_reading() {
+  Sht31Sensor sensor(mockWrite, mockRead, &mock);
+  TEST_ASSERT_TRUE(startAt(sensor, 0));
+  TEST_ASSERT_EQUAL(Sht31Sensor::READY, pollAt(sensor, 20));
+
+  mock.rawT = 0x8000;
+  mock.rawH = 0x4000;
+  mock.badTemperatureCrc = true;
+  TEST_ASSERT_TRUE(startAt(sensor, 100));
+  TEST_ASSERT_EQUAL(Sht31Sensor::FAILED, pollAt(sensor, 120));
+  TEST_ASSERT_EQUAL(1, sensor.getCrcErrors());
+  TEST_ASSERT_EQUAL(0, sensor.getBusErrors());
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 25.0f, sensor.temperature());
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 50.0f, sensor.humidity()); // Not half-updated
+
+  mock.badTemperatureCrc = false;
+  mock.badHumidityCrc = true;
+  TEST_ASSERT_TRUE(startAt(sensor, 200));
+  TEST_ASSERT_EQUAL(Sht31Sensor::FAILED, pollAt(sensor, 220));
+  TEST_ASSERT_EQUAL(2, sensor.getCrcErrors());
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 25.0f, sensor.temperature());
+
+  mock.badHumidityCrc = false;
+  TEST_ASSERT_TRUE(startAt(sensor, 300));
+  TEST_ASSERT_EQUAL(Sht31Sensor::READY, pollAt(sensor, 320));
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 25.0f, sensor.humidity());
+}
+
+// A second start() does not send a command or restart the clock
+void test_start_while_measuring_is_refused() {
+  mock.conversionMs = 30;
+  Sht31Sensor sensor(mockWrite, mockRead, &mock);
+  TEST_ASSERT_TRUE(startAt(sensor, 0));
+  TEST_ASSERT_FALSE(startAt(sensor, 10));
+  TEST_ASSERT_FALSE(startAt(sensor, 25));
+  TEST_ASSERT_EQUAL(1, mock.commands.size());
+  TEST_ASSERT_EQUAL(0, mock.nacks);
+  TEST_ASSERT_EQUAL(0, sensor.getBusErrors());
+  TEST_ASSERT_EQUAL(Sht31Sensor::READY, pollAt(sensor, 30));
+  TEST_ASSERT_TRUE(startAt(sensor, 40));
+  TEST_ASSERT_EQUAL(2, mock.commands.size());
+}
+
+void test_unacknowledged_start_is_a_bus_error() {
+  mock.present = false;
+  Sht31Sensor sensor(mockWrite, mockRead, &mock);
+  TEST_ASSERT_FALSE(startAt(sensor, 0));
+  TEST_ASSERT_FALSE(sensor.isMeasuring());
+  TEST_ASSERT_EQUAL(1, sensor.getBusErrors());
+  TEST_ASSERT_EQUAL(Sht31Sensor::IDLE, pollAt(sensor, 50));
+}
+
+void test_measurement_across_millis_wrap() {
+  mock.conversionMs = 30;
+  Sht31Sensor sensor(mockWrite, mockRead, &mock);
+  TEST_ASSERT_TRUE(startAt(sensor, 0xFFFFFFF0u));
+  TEST_ASSERT_EQUAL(Sht31Sensor::MEASURING, pollAt(sensor, 0x00000005u));
+  TEST_ASSERT_EQUAL(Sht31Sensor::READY, pollAt(sensor, 0x0000000Eu));
+}
+
+// ChamberProbes ticking faster than a conversion: a probe still measuring is polled
+// again on the next tick, not counted as failed
+void test_probes_wait_out_a_conversion() {
+  const ProbeConfig config = {-1, 0x44, 0.0f};
+  ChamberProbes probes(mockWrite, mockRead, &mock, nullptr, &config, 1, PROBE_TEMPERATURE_FILTER,
+                       PROBE_HUMIDITY_FILTER);
+  TEST_ASSERT_EQUAL(1, probes.begin());
+
+  const float slope = 0.5f; // C/s
+  const uint32_t tickMs = 10;
+  size_t failed = 0;
+  for (uint32_t t = 1000; t < 61000; t += tickMs) {
+    float temperature = 25.0f + slope * (t - 1000) / 1000.0f;
+    mock.rawT = (uint16_t)lroundf((temperature + 45.0f) / 175.0f * 65535.0f);
+    mock.now = t;
+    failed += probes.service(t);
+  }
+  TEST_ASSERT_EQUAL(0, failed);
+  ProbeReading r = probes.reading(0);
+  TEST_ASSERT_TRUE(r.valid);
+  TEST_ASSERT_FLOAT_WITHIN(0.2f, 25.0f + slope * 60.0f, r.temperature);
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_crc8_matches_datasheet_example);
+  RUN_TEST(test_begin_soft_resets_and_reports_a_missing_sensor);
+  RUN_TEST(test_reads_after_measure_time);
+  RUN_TEST(test_nack_until_ready);
+  RUN_TEST(test_timeout_fails_and_keeps_last_reading);
+  RUN_TEST(test_crc_mismatch_fails_and_keeps_last_reading);
+  RUN_TEST(test_start_while_measuring_is_refused);
+  RUN_TEST(test_unacknowledged_start_is_a_bus_error);
+  RUN_TEST(test_measurement_across_millis_wrap);
+  RUN_TEST(test_probes_wait_out_a_conversion);
+  return UNITY_END();
+}
@@ -0,0 +1,141 @@
+// TelemetrySnapshot read by several threads while one thread keeps publishing bodies of
+// different lengths. Every copy must be one complete published body. Then TelemetryDelta
+// against what it last pushed.
+
+#include <atomic>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <unity.h>
+#include <vector>
+
+#include "TelemetrySnapshot.h"
+
+static const int VARIANTS = 4;
+
+static TelemetryValues variant(int i) {
+  TelemetryValues v = {};
+  v.zone = (uint8_t)i;
+  v.temperature = i % 2 ? 55.5f : NAN; // "null" or a number: the length changes
+  v.humidity = 10.0f * i;
+  v.processState = i % 2 ? "DRYING" : "IDLE - HUMIDITY REACHED";
+  v.heatAction = i >= 2 ? "Stop" : "Warm";
+  return v;
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_empty_before_first_publish() {
+  TelemetrySnapshot<1024> snapshot;
+  char body[TelemetrySnapshot<1024>::BUFFER_SIZE];
+  memset(body, 'x', sizeof(body));
+  TEST_ASSERT_EQUAL(0, snapshot.copy(body));
+  TEST_ASSERT_EQUAL_STRING("", body);
+}
+
+void test_copy_returns_what_was_published() {
+  TelemetrySnapshot<1024> snapshot;
+  TelemetryText text;
+  char expected[1025], body[TelemetrySnapshot<1024>::BUFFER_SIZE];
+  for (int i = 0; i < VARIANTS; i++) {
+    text.format(variant(i));
+    size_t len = formatTelemetryJson(text, expected, sizeof(expected));
+    snapshot.publish(text);
+    TEST_ASSERT_EQUAL(len, snapshot.copy(body));
+    TEST_ASSERT_EQUAL_STRING(expected, body);
+  }
+}
+
+// A body that does not fit leaves the previous one in place
+void test_oversized_body_keeps_previous() {
+  TelemetrySnapshot<64> snapshot;
+  TelemetryText text;
+  text.format(variant(1));
+  snapshot.publish(text);
+  char body[TelemetrySnapshot<64>::BUFFER_SIZE];
+  TEST_ASSERT_EQUAL(0, snapshot.copy(body));
+}
+
+void test_concurrent_copies_are_never_torn() {
+  static TelemetrySnapshot<1024> snapshot;
+  std::string bodies[VARIANTS];
+  TelemetryText texts[VARIANTS];
+  for (int i = 0; i < VARIANTS; i++) {
+    char buf[1025];
+    texts[i].format(variant(i));
+    bodies[i].assign(buf, formatTelemetryJson(texts[i], buf, sizeof(buf)));
+  }
+  snapshot.publish(texts[0]);
+
+  std::atomic<bool> stop(false);
+  std::atomic<uint32_t> torn(0), copies(0);
+  std::vector<std::thread> readers;
+  for (int r = 0; r < 3; r++) {
+    readers.emplace_back([&]() {
+      char body[TelemetrySnapshot<1024>::BUFFER_SIZE];
+      while (!stop.load()) {
+        size_t len = snapshot.copy(body);
+        bool known = false;
+        for (const std::string& b : bodies) known = known || (len == b.size() && b == body);
+        if (!known) torn++;
+        copies++;
+      }
+    });
+  }
+  for (int n = 0; n < 200000; n++) snapshot.publish(texts[n % VARIANTS]);
+  stop = true;
+  for (std::thread& t : readers) t.join();
+
+  TEST_ASSERT_TRUE(copies.load() > 0);
+  TEST_ASSERT_EQUAL(0, torn.load());
+}
+
+// Each delta holds the zone and the fields whose text differs from the last push, and
+// formatPushed() gives a joining client exactly that state
+void test_delta_sends_changed_fields_against_last_push() {
+  TelemetryDelta delta;
+  TelemetryText text;
+  char frame[1025], expected[1025];
+  TEST_ASSERT_EQUAL(0, delta.formatPushed(frame, sizeof(frame)));
+
+  TelemetryValues v = variant(1);
+  text.format(v);
+  size_t len = delta.build(text, frame, sizeof(frame));
+  TEST_ASSERT_EQUAL(formatTelemetryJson(text, expected, sizeof(expected)), len); // First one is full
+  TEST_ASSERT_EQUAL_STRING(expected, frame);
+  TEST_ASSERT_EQUAL(0, delta.build(text, frame, sizeof(frame)));
+
+  v.humidity = 12.5f;
+  text.format(v);
+  delta.build(text, frame, sizeof(frame));
+  TEST_ASSERT_EQUAL_STRING("{\"zone\":1,\"humidity\":12.5}", frame);
+
+  // Back to the old value: still a change against what was pushed last
+  v.humidity = 10.0f;
+  text.format(v);
+  delta.build(text, frame, sizeof(frame));
+  TEST_ASSERT_EQUAL_STRING("{\"zone\":1,\"humidity\":10.0}", frame);
+
+  // A joining client gets the pushed state, not the latest unpushed one
+  v.humidity = 33.0f;
+  TelemetryText unpushed;
+  unpushed.format(v);
+  len = delta.formatPushed(frame, sizeof(frame));
+  TEST_ASSERT_EQUAL(formatTelemetryJson(text, expected, sizeof(expected)), len);
+  TEST_ASSERT_EQUAL_STRING(expected, frame);
+
+  delta.reset();
+  TEST_ASSERT_EQUAL(len, delta.build(text, frame, sizeof(frame)));
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_empty_before_first_publish);
+  RUN_TEST(test_copy_returns_what_was_published);
+  RUN_TEST(test_oversized_body_keeps_previous);
+  RUN_TEST(test_concurrent_copies_are_never_torn);
+  RUN_TEST(test_delta_sends_changed_fields_against_last_push);
+  return UNITY_END();
+}
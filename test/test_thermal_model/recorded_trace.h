@@ -0,0 +1,52 @@
+#pragma once
+
+// A one-hour Identify step response, as StepResponseTest records it: one sample every
+// 10 s, from the moment a 50 % duty step was applied to a chamber settled at 26.5 C.
+//
+// Recorded from sim/ChamberPlant with its default configuration (30 L vented box, 60 W
+// heater, element lag included), with the 0.05 C SHT31 noise the simulator adds and
+// 0.01 C resolution. The plant's first-order figures are K = 0.667 C/% and
+// tau = 1222 s; the element adds a few seconds of lag and stretches tau slightly.
+// A trace logged on the real dryer drops in here in the same format.
+
+static const float RECORDED_BASELINE = 26.5f;  // C
+static const float RECORDED_STEP_DUTY = 50.0f; // %
+static const float RECORDED_DT = 10.0f;        // s
+static const float RECORDED_TRACE[] = {
+  26.55f, 26.56f, 26.74f, 26.95f, 27.26f, 27.38f, 27.74f, 27.94f, 28.26f, 28.40f,
+  28.76f, 28.92f, 29.14f, 29.46f, 29.66f, 29.85f, 30.17f, 30.42f, 30.63f, 30.80f,
+  30.94f, 31.22f, 31.44f, 31.66f, 31.93f, 32.18f, 32.31f, 32.55f, 32.77f, 33.02f,
+  33.20f, 33.32f, 33.59f, 33.77f, 34.03f, 34.16f, 34.34f, 34.55f, 34.76f, 35.05f,
+  35.17f, 35.37f, 35.54f, 35.77f, 35.93f, 36.18f, 36.30f, 36.43f, 36.65f, 36.84f,
+  36.90f, 37.16f, 37.33f, 37.49f, 37.77f, 37.86f, 38.07f, 38.20f, 38.42f, 38.50f,
+  38.75f, 38.90f, 39.06f, 39.17f, 39.32f, 39.48f, 39.72f, 39.74f, 39.99f, 40.15f,
+  40.33f, 40.43f, 40.46f, 40.83f, 40.93f, 41.04f, 41.13f, 41.32f, 41.55f, 41.58f,
+  41.74f, 41.81f, 42.02f, 42.20f, 42.37f, 42.45f, 42.66f, 42.65f, 42.72f, 43.00f,
+  43.19f, 43.24f, 43.34f, 43.45f, 43.65f, 43.68f, 43.90f, 43.95f, 44.15f, 44.20f,
+  44.36f, 44.39f, 44.56f, 44.73f, 44.79f, 44.96f, 44.97f, 45.10f, 45.29f, 45.42f,
+  45.46f, 45.53f, 45.81f, 45.87f, 46.03f, 46.03f, 46.13f, 46.25f, 46.36f, 46.59f,
+  46.45f, 46.69f, 46.72f, 46.81f, 46.94f, 47.12f, 47.16f, 47.30f, 47.41f, 47.43f,
+  47.52f, 47.67f, 47.74f, 47.86f, 47.93f, 48.05f, 48.17f, 48.23f, 48.40f, 48.47f,
+  48.46f, 48.60f, 48.59f, 48.73f, 48.76f, 48.88f, 48.95f, 49.09f, 49.22f, 49.19f,
+  49.36f, 49.42f, 49.54f, 49.49f, 49.64f, 49.68f, 49.80f, 49.91f, 49.91f, 50.03f,
+  50.07f, 50.19f, 50.27f, 50.29f, 50.47f, 50.53f, 50.53f, 50.59f, 50.74f, 50.73f,
+  50.86f, 50.91f, 50.91f, 51.08f, 51.06f, 51.18f, 51.18f, 51.37f, 51.35f, 51.45f,
+  51.52f, 51.56f, 51.63f, 51.64f, 51.75f, 51.83f, 51.83f, 51.95f, 51.95f, 52.09f,
+  52.08f, 52.12f, 52.24f, 52.30f, 52.41f, 52.36f, 52.57f, 52.44f, 52.61f, 52.74f,
+  52.69f, 52.71f, 52.83f, 52.86f, 52.90f, 52.90f, 53.02f, 53.08f, 53.14f, 53.08f,
+  53.28f, 53.28f, 53.34f, 53.43f, 53.48f, 53.51f, 53.58f, 53.54f, 53.65f, 53.69f,
+  53.73f, 53.71f, 53.86f, 53.79f, 53.93f, 53.96f, 54.03f, 54.01f, 53.98f, 54.15f,
+  54.28f, 54.30f, 54.31f, 54.39f, 54.30f, 54.42f, 54.43f, 54.49f, 54.49f, 54.53f,
+  54.61f, 54.65f, 54.75f, 54.69f, 54.74f, 54.83f, 54.82f, 54.94f, 54.94f, 54.96f,
+  55.08f, 54.97f, 54.95f, 55.10f, 55.19f, 55.23f, 55.21f, 55.25f, 55.28f, 55.29f,
+  55.40f, 55.34f, 55.40f, 55.42f, 55.45f, 55.47f, 55.55f, 55.56f, 55.61f, 55.66f,
+  55.71f, 55.75f, 55.79f, 55.71f, 55.79f, 55.89f, 55.81f, 55.84f, 55.91f, 55.92f,
+  56.16f, 56.07f, 55.97f, 56.05f, 56.16f, 56.01f, 56.14f, 56.25f, 56.17f, 56.28f,
+  56.26f, 56.29f, 56.28f, 56.39f, 56.39f, 56.55f, 56.37f, 56.47f, 56.55f, 56.57f,
+  56.51f, 56.59f, 56.60f, 56.65f, 56.63f, 56.65f, 56.69f, 56.74f, 56.67f, 56.79f,
+  56.84f, 56.83f, 56.83f, 56.83f, 56.90f, 56.96f, 56.95f, 56.96f, 56.92f, 56.98f,
+  56.96f, 56.91f, 57.08f, 57.12f, 57.08f, 57.08f, 57.15f, 57.15f, 57.26f, 57.23f,
+  57.21f, 57.16f, 57.34f, 57.31f, 57.36f, 57.39f, 57.21f, 57.35f, 57.44f, 57.36f,
+  57.40f, 57.48f, 57.42f, 57.41f, 57.46f, 57.58f, 57.56f, 57.50f, 57.62f, 57.55f,
+  57.68f, 57.67f, 57.63f, 57.69f, 57.64f, 57.63f, 57.68f, 57.68f, 57.72f, 57.68f,
+};
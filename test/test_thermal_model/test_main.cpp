@@ -0,0 +1,187 @@
+// fitFopdt on step responses with known parameters (clean, noisy, cut short, with dead
+// time) and on a recorded Identify trace, plus StepResponseTest run against a
+// first-order plant. Samples are 10 s apart, as StepResponseTest takes them.
+
+#include <math.h>
+#include <stdint.h>
+#include <unity.h>
+#include <vector>
+
+#include "ThermalModel.h"
+#include "recorded_trace.h"
+
+static const float DT = StepResponseTest::SAMPLE_PERIOD_MS / 1000.0f;
+static const float BASELINE = 25.0f;
+static const float STEP_DUTY = 50.0f;
+
+static uint32_t seed;
+
+static float gaussian() {
+  seed = seed * 1664525u + 1013904223u;
+  float u1 = ((seed >> 8) + 0.5f) / 16777216.0f;
+  seed = seed * 1664525u + 1013904223u;
+  float u2 = ((seed >> 8) + 0.5f) / 16777216.0f;
+  return sqrtf(-2.0f * logf(u1)) * cosf(6.2831853f * u2);
+}
+
+// The FOPDT step response itself, sampled every DT from the step, plus noise
+static std::vector<float> stepResponse(FopdtModel m, size_t count, float sigma) {
+  std::vector<float> samples;
+  for (size_t k = 0; k < count; k++) {
+    float t = k * DT;
+    float rise = t > m.deadTime ? m.gain * STEP_DUTY * (1.0f - expf(-(t - m.deadTime) / m.timeConstant)) : 0.0f;
+    samples.push_back(BASELINE + rise + sigma * gaussian());
+  }
+  return samples;
+}
+
+static FopdtModel fit(const std::vector<float>& samples) {
+  FopdtModel model = {};
+  TEST_ASSERT_TRUE(fitFopdt(samples.data(), samples.size(), DT, BASELINE, STEP_DUTY, model));
+  return model;
+}
+
+void setUp() {
+  seed = 12345;
+}
+
+void tearDown() {}
+
+void test_clean_response_is_recovered() {
+  FopdtModel truth = {0.6f, 900.0f, 60.0f, 0.0f};
+  FopdtModel m = fit(stepResponse(truth, 360, 0.0f));
+  TEST_ASSERT_FLOAT_WITHIN(0.01f * truth.gain, truth.gain, m.gain);
+  TEST_ASSERT_FLOAT_WITHIN(0.03f * truth.timeConstant, truth.timeConstant, m.timeConstant);
+  TEST_ASSERT_FLOAT_WITHIN(DT, truth.deadTime, m.deadTime);
+  TEST_ASSERT_TRUE(m.rmsError < 0.1f);
+}
+
+// Up to three times the SHT31's noise (the fit sees the filtered reading, which is
+// quieter still), several seeds each
+void test_noisy_response_is_recovered() {
+  FopdtModel truth = {0.45f, 1200.0f, 30.0f, 0.0f};
+  const float sigmas[] = {0.05f, 0.1f, 0.15f};
+  for (float sigma : sigmas) {
+    for (uint32_t s = 1; s <= 5; s++) {
+      seed = s * 7919u;
+      FopdtModel m = fit(stepResponse(truth, 540, sigma));
+      TEST_ASSERT_FLOAT_WITHIN(0.03f * truth.gain, truth.gain, m.gain);
+      TEST_ASSERT_FLOAT_WITHIN(0.08f * truth.timeConstant, truth.timeConstant, m.timeConstant);
+      TEST_ASSERT_FLOAT_WITHIN(3 * DT, truth.deadTime, m.deadTime);
+      TEST_ASSERT_TRUE(m.rmsError > 0.7f * sigma && m.rmsError < 2.0f * sigma); // Mostly the noise
+    }
+  }
+}
+
+// Cut off at the temperature limit well before steady state: under one time constant
+void test_partial_response_is_recovered() {
+  FopdtModel truth = {0.7f, 2400.0f, 40.0f, 0.0f};
+  std::vector<float> samples = stepResponse(truth, 180, 0.05f); // 30 min of a 40 min tau
+  TEST_ASSERT_TRUE(samples.back() - BASELINE < 0.6f * truth.gain * STEP_DUTY);
+  FopdtModel m = fit(samples);
+  TEST_ASSERT_FLOAT_WITHIN(0.15f * truth.gain, truth.gain, m.gain);
+  TEST_ASSERT_FLOAT_WITHIN(0.2f * truth.timeConstant, truth.timeConstant, m.timeConstant);
+  TEST_ASSERT_FLOAT_WITHIN(3 * DT, truth.deadTime, m.deadTime);
+}
+
+// Dead times from none to several minutes, on the sample grid and between it
+void test_dead_time_is_recovered() {
+  const float deadTimes[] = {0.0f, 10.0f, 45.0f, 120.0f, 300.0f};
+  for (float dead : deadTimes) {
+    FopdtModel truth = {0.5f, 800.0f, dead, 0.0f};
+    FopdtModel m = fit(stepResponse(truth, 360, 0.05f));
+    TEST_ASSERT_FLOAT_WITHIN(1.5f * DT, dead, m.deadTime);
+    TEST_ASSERT_FLOAT_WITHIN(0.05f * truth.gain, truth.gain, m.gain);
+    TEST_ASSERT_FLOAT_WITHIN(0.1f * truth.timeConstant, truth.timeConstant, m.timeConstant);
+  }
+}
+
+void test_recorded_trace() {
+  const size_t count = sizeof(RECORDED_TRACE) / sizeof(RECORDED_TRACE[0]);
+  FopdtModel m = {};
+  TEST_ASSERT_TRUE(fitFopdt(RECORDED_TRACE, count, RECORDED_DT, RECORDED_BASELINE, RECORDED_STEP_DUTY, m));
+  TEST_ASSERT_FLOAT_WITHIN(0.1f * 0.667f, 0.667f, m.gain);
+  TEST_ASSERT_FLOAT_WITHIN(0.15f * 1222.0f, 1222.0f, m.timeConstant);
+  TEST_ASSERT_TRUE(m.deadTime <= 3 * RECORDED_DT);
+  TEST_ASSERT_TRUE(m.rmsError < 0.15f);
+}
+
+void test_no_response_is_rejected() {
+  FopdtModel m = {};
+  std::vector<float> flat = stepResponse({0.0f, 1.0f, 0.0f, 0.0f}, 200, 0.05f);
+  TEST_ASSERT_FALSE(fitFopdt(flat.data(), flat.size(), DT, BASELINE, STEP_DUTY, m));
+
+  std::vector<float> falling;
+  for (size_t k = 0; k < 200; k++) falling.push_back(BASELINE - 0.02f * k);
+  TEST_ASSERT_FALSE(fitFopdt(falling.data(), falling.size(), DT, BASELINE, STEP_DUTY, m));
+
+  std::vector<float> tooShort = stepResponse({0.5f, 600.0f, 0.0f, 0.0f}, 19, 0.0f);
+  TEST_ASSERT_FALSE(fitFopdt(tooShort.data(), tooShort.size(), DT, BASELINE, STEP_DUTY, m));
+}
+
+// The whole experiment against a first-order plant with a transport delay, fed every
+// 250 ms as the control task does: baseline, step, settle detection and fit
+void test_step_test_identifies_a_plant() {
+  const float gain = 0.55f, tau = 700.0f, dead = 50.0f, tick = 0.25f;
+  StepResponseTest test;
+  test.start(0, STEP_DUTY, 80.0f);
+  std::vector<float> applied; // Duty per tick, for the delay
+  float temperature = BASELINE;
+  uint32_t nowMs = 0;
+  size_t delayTicks = (size_t)(dead / tick);
+  while (test.isRunning() && nowMs < 4 * 3600000u) {
+    float duty = test.update(nowMs, temperature + 0.05f * gaussian());
+    applied.push_back(duty);
+    float delayed = applied.size() > delayTicks ? applied[applied.size() - 1 - delayTicks] : 0.0f;
+    temperature += tick / tau * (BASELINE + gain * delayed - temperature);
+    nowMs += (uint32_t)(tick * 1000);
+  }
+  TEST_ASSERT_EQUAL(StepResponseTest::PHASE_DONE, test.getPhase());
+  TEST_ASSERT_TRUE(test.getSampleCount() < StepResponseTest::CAPACITY); // Ended on settling
+  const FopdtModel& m = test.getModel();
+  TEST_ASSERT_FLOAT_WITHIN(0.05f * gain, gain, m.gain);
+  TEST_ASSERT_FLOAT_WITHIN(0.1f * tau, tau, m.timeConstant);
+  TEST_ASSERT_FLOAT_WITHIN(2 * DT, dead, m.deadTime);
+}
+
+// Reaching the temperature limit ends the step early; the partial response still fits
+void test_step_test_stops_at_the_limit() {
+  const float gain = 0.8f, tau = 1500.0f, tick = 0.25f;
+  StepResponseTest test;
+  test.start(0, STEP_DUTY, BASELINE + 20.0f);
+  float temperature = BASELINE;
+  uint32_t nowMs = 0;
+  float duty = 0.0f;
+  while (test.isRunning() && nowMs < 4 * 3600000u) {
+    duty = test.update(nowMs, temperature);
+    temperature += tick / tau * (BASELINE + gain * duty - temperature);
+    nowMs += (uint32_t)(tick * 1000);
+  }
+  TEST_ASSERT_EQUAL(StepResponseTest::PHASE_DONE, test.getPhase());
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, duty);
+  TEST_ASSERT_TRUE(temperature < BASELINE + 20.5f);
+  TEST_ASSERT_FLOAT_WITHIN(0.15f * gain, gain, test.getModel().gain);
+  TEST_ASSERT_FLOAT_WITHIN(0.2f * tau, tau, test.getModel().timeConstant);
+}
+
+void test_nan_reading_fails_the_test() {
+  StepResponseTest test;
+  test.start(0, STEP_DUTY, 80.0f);
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, test.update(0, BASELINE));
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, test.update(250, NAN));
+  TEST_ASSERT_EQUAL(StepResponseTest::PHASE_FAILED, test.getPhase());
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_clean_response_is_recovered);
+  RUN_TEST(test_noisy_response_is_recovered);
+  RUN_TEST(test_partial_response_is_recovered);
+  RUN_TEST(test_dead_time_is_recovered);
+  RUN_TEST(test_recorded_trace);
+  RUN_TEST(test_no_response_is_rejected);
+  RUN_TEST(test_step_test_identifies_a_plant);
+  RUN_TEST(test_step_test_stops_at_the_limit);
+  RUN_TEST(test_nan_reading_fails_the_test);
+  return UNITY_END();
+}
@@ -0,0 +1,256 @@
+// TimeProportionalOutput driven by a fake clock, with the pin recorded by a fake
+// PinWriter. The window and hold times are the firmware's; service() is called every
+// 10 ms, as the heater esp_timer does.
+
+#include <stdint.h>
+#include <unity.h>
+#include <vector>
+
+#include "TimeProportionalOutput.h"
+
+static const uint32_t WINDOW_MS = 10000; // As in main.cpp
+static const uint32_t MIN_ON_MS = 1000;
+static const uint32_t MIN_OFF_MS = 1000;
+static const uint32_t TICK_MS = 10;
+
+struct Edge {
+  uint32_t atMs;
+  bool on;
+};
+
+struct FakePin {
+  uint32_t nowMs = 0; // Set before each service()
+  std::vector<Edge> edges;
+};
+
+static void writePin(bool on, void* context) {
+  FakePin* pin = (FakePin*)context;
+  pin->edges.push_back({pin->nowMs, on});
+}
+
+static FakePin pin;
+
+struct Rig {
+  TimeProportionalOutput output;
+  uint32_t nowMs;
+
+  explicit Rig(uint32_t startMs)
+    : output(WINDOW_MS, MIN_ON_MS, MIN_OFF_MS, writePin, &pin), nowMs(startMs) {}
+
+  void serviceAt(uint32_t t) {
+    nowMs = t;
+    pin.nowMs = t;
+    output.service(t);
+  }
+
+  // Services every tick until nowMs has moved on by ms
+  void run(uint32_t ms) {
+    uint32_t end = nowMs + ms;
+    while (nowMs != end) serviceAt(nowMs + TICK_MS);
+  }
+};
+
+// Pin ON time between from and to (relative to from, so it works across the wrap)
+static uint32_t onTimeBetween(uint32_t from, uint32_t to) {
+  uint32_t total = 0;
+  bool on = false;
+  uint32_t since = 0;
+  for (const Edge& e : pin.edges) {
+    if ((int32_t)(e.atMs - from) < 0) { // Before the range: only its state counts
+      on = e.on;
+      continue;
+    }
+    uint32_t at = e.atMs - from;
+    if (at > to - from) break;
+    if (on && !e.on) total += at - since;
+    on = e.on;
+    since = at;
+  }
+  if (on) total += (to - from) - since;
+  return total;
+}
+
+// Shortest ON pulse and shortest OFF gap between edges, ignoring the first edge
+static void shortestPulses(uint32_t& shortestOn, uint32_t& shortestOff) {
+  shortestOn = shortestOff = UINT32_MAX;
+  for (size_t i = 1; i < pin.edges.size(); i++) {
+    uint32_t length = pin.edges[i].atMs - pin.edges[i - 1].atMs;
+    uint32_t& shortest = pin.edges[i - 1].on ? shortestOn : shortestOff;
+    if (length < shortest) shortest = length;
+  }
+}
+
+void setUp() {
+  pin = FakePin();
+}
+
+void tearDown() {}
+
+void test_duty_is_one_pulse_per_window() {
+  Rig rig(0);
+  rig.output.setDuty(40.0f);
+  rig.serviceAt(0);
+  TEST_ASSERT_TRUE(rig.output.isOn()); // No hold at power-up
+  rig.run(5 * WINDOW_MS - TICK_MS);
+  TEST_ASSERT_EQUAL(5, rig.output.getCycleCount());
+  for (uint32_t w = 0; w < 5; w++) {
+    TEST_ASSERT_EQUAL(4000, onTimeBetween(w * WINDOW_MS, (w + 1) * WINDOW_MS));
+  }
+  TEST_ASSERT_EQUAL(5 * 4000, rig.output.getOnTimeTotal());
+}
+
+// Pulses shorter than the minimum ON time are skipped and carried until they add up
+void test_min_on_hold_carries_short_pulses() {
+  Rig rig(0);
+  rig.output.setDuty(5.0f); // 500 ms a window
+  rig.serviceAt(0);
+  TEST_ASSERT_EQUAL(0, rig.output.getWindowOnTime());
+  rig.run(WINDOW_MS);
+  TEST_ASSERT_EQUAL(MIN_ON_MS, rig.output.getWindowOnTime()); // 500 + 500 carried
+  rig.run(19 * WINDOW_MS);
+
+  TEST_ASSERT_EQUAL(10 * 500 + 10 * 500, onTimeBetween(0, 20 * WINDOW_MS));
+  uint32_t shortestOn, shortestOff;
+  shortestPulses(shortestOn, shortestOff);
+  TEST_ASSERT_EQUAL(MIN_ON_MS, shortestOn);
+}
+
+// OFF gaps shorter than the minimum OFF time are filled and paid back in the next window
+void test_min_off_hold_carries_short_gaps() {
+  Rig rig(0);
+  rig.output.setDuty(95.0f); // 9500 ms: a 500 ms gap
+  rig.serviceAt(0);
+  TEST_ASSERT_EQUAL(WINDOW_MS, rig.output.getWindowOnTime());
+  rig.run(WINDOW_MS);
+  TEST_ASSERT_EQUAL(WINDOW_MS - MIN_OFF_MS, rig.output.getWindowOnTime()); // 9500 - 500 owed
+  rig.run(19 * WINDOW_MS);
+
+  TEST_ASSERT_EQUAL(20 * 9500, onTimeBetween(0, 20 * WINDOW_MS));
+  uint32_t shortestOn, shortestOff;
+  shortestPulses(shortestOn, shortestOff);
+  TEST_ASSERT_EQUAL(MIN_OFF_MS, shortestOff);
+}
+
+// Any duty is matched on average over a few windows, within one tick per window
+void test_carry_keeps_the_average_across_windows() {
+  const float duties[] = {3.0f, 7.5f, 12.0f, 33.3f, 88.0f, 91.0f, 97.0f};
+  for (float duty : duties) {
+    pin = FakePin();
+    Rig rig(0);
+    rig.output.setDuty(duty);
+    rig.serviceAt(0);
+    rig.run(40 * WINDOW_MS);
+    float expected = duty / 100.0f * 40 * WINDOW_MS;
+    TEST_ASSERT_FLOAT_WITHIN(WINDOW_MS, expected, (float)onTimeBetween(0, 40 * WINDOW_MS));
+  }
+}
+
+// A duty of 0 switches off at once, but not before the minimum ON time
+void test_zero_duty_switches_off_early() {
+  Rig rig(0);
+  rig.output.setDuty(60.0f);
+  rig.serviceAt(0);
+  rig.run(300);
+  rig.output.setDuty(0.0f);
+  rig.run(TICK_MS);
+  TEST_ASSERT_TRUE(rig.output.isOn()); // Held for MIN_ON_MS
+  rig.run(MIN_ON_MS);
+  TEST_ASSERT_FALSE(rig.output.isOn());
+  TEST_ASSERT_EQUAL(MIN_ON_MS, pin.edges.back().atMs);
+
+  // Later in the pulse it switches off on the next tick
+  rig.run(WINDOW_MS - rig.nowMs);
+  rig.output.setDuty(60.0f);
+  rig.run(2 * WINDOW_MS);
+  uint32_t onAt = pin.edges.back().atMs;
+  rig.run(3000);
+  TEST_ASSERT_TRUE(rig.output.isOn());
+  rig.output.setDuty(0.0f);
+  rig.run(TICK_MS);
+  TEST_ASSERT_FALSE(rig.output.isOn());
+  TEST_ASSERT_EQUAL(onAt + 3000 + TICK_MS, pin.edges.back().atMs);
+}
+
+// A stall of part of a window still drives each window once: the carry is kept
+void test_brief_stall_keeps_the_carry() {
+  Rig rig(0);
+  rig.output.setDuty(5.0f); // Every other window owes 500 ms
+  rig.serviceAt(0);
+  rig.run(3 * WINDOW_MS - TICK_MS); // Third window: skipped, 500 ms carried
+  TEST_ASSERT_EQUAL(0, rig.output.getWindowOnTime());
+  rig.serviceAt(3 * WINDOW_MS + 5000); // Stalled through the boundary
+  TEST_ASSERT_EQUAL(MIN_ON_MS, rig.output.getWindowOnTime());
+}
+
+// A stall of more than a window but less than two keeps the window phase. The window
+// it ends in was not driven as planned, so nothing is carried into it.
+void test_short_stall_keeps_phase_and_drops_carry() {
+  Rig rig(0);
+  rig.output.setDuty(5.0f); // Every other window owes 500 ms
+  rig.serviceAt(0);
+  rig.run(2 * WINDOW_MS + 5000); // Third window: skipped, 500 ms carried
+  TEST_ASSERT_EQUAL(0, rig.output.getWindowOnTime());
+
+  rig.output.setDuty(30.0f);
+  rig.serviceAt(3 * WINDOW_MS + 8000); // Stalled for 1.3 windows
+  TEST_ASSERT_EQUAL(3000, rig.output.getWindowOnTime()); // Not 3500
+  TEST_ASSERT_FALSE(rig.output.isOn());                  // 8 s into a 3 s pulse
+  rig.run(WINDOW_MS - 8000);
+  TEST_ASSERT_TRUE(rig.output.isOn()); // The next window starts on the old phase
+  TEST_ASSERT_EQUAL(4 * WINDOW_MS, pin.edges.back().atMs);
+  rig.run(WINDOW_MS);
+  TEST_ASSERT_EQUAL(3000, onTimeBetween(4 * WINDOW_MS, 5 * WINDOW_MS));
+}
+
+// A stall of two windows or more starts a fresh window where the stall ended
+void test_long_stall_reanchors_the_window() {
+  for (uint32_t stalled = 2; stalled <= 5; stalled++) {
+    pin = FakePin();
+    Rig rig(0);
+    rig.output.setDuty(5.0f);
+    rig.serviceAt(0);
+    rig.run(WINDOW_MS - TICK_MS); // 500 ms carried
+    rig.output.setDuty(50.0f);
+    uint32_t resume = stalled * WINDOW_MS + 1234;
+    rig.serviceAt(resume);
+    TEST_ASSERT_TRUE(rig.output.isOn());
+    TEST_ASSERT_EQUAL(resume, pin.edges.back().atMs);
+    TEST_ASSERT_EQUAL(5000, rig.output.getWindowOnTime());
+    rig.run(WINDOW_MS);
+    TEST_ASSERT_EQUAL(5000, onTimeBetween(resume, resume + WINDOW_MS));
+    TEST_ASSERT_EQUAL(resume + WINDOW_MS, pin.edges.back().atMs); // Next window on the new phase
+  }
+}
+
+// The clock wraps past 2^32 mid-window and mid-pulse
+void test_schedule_across_millis_wrap() {
+  const uint32_t start = 0xFFFFFFFFu - 12345u;
+  Rig rig(start);
+  rig.output.setDuty(45.0f);
+  rig.serviceAt(start);
+  rig.run(6 * WINDOW_MS - TICK_MS);
+  TEST_ASSERT_EQUAL(6, rig.output.getCycleCount());
+  for (uint32_t w = 0; w < 6; w++) {
+    uint32_t from = start + w * WINDOW_MS;
+    TEST_ASSERT_EQUAL(4500, onTimeBetween(from, from + WINDOW_MS));
+  }
+  uint32_t shortestOn, shortestOff;
+  shortestPulses(shortestOn, shortestOff);
+  TEST_ASSERT_EQUAL(4500, shortestOn);
+  TEST_ASSERT_EQUAL(5500, shortestOff);
+  TEST_ASSERT_EQUAL(6 * 4500, rig.output.getOnTimeTotal());
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_duty_is_one_pulse_per_window);
+  RUN_TEST(test_min_on_hold_carries_short_pulses);
+  RUN_TEST(test_min_off_hold_carries_short_gaps);
+  RUN_TEST(test_carry_keeps_the_average_across_windows);
+  RUN_TEST(test_zero_duty_switches_off_early);
+  RUN_TEST(test_brief_stall_keeps_the_carry);
+  RUN_TEST(test_short_stall_keeps_phase_and_drops_carry);
+  RUN_TEST(test_long_stall_reanchors_the_window);
+  RUN_TEST(test_schedule_across_millis_wrap);
+  return UNITY_END();
+}